@@ -1,23 +1,562 @@
 #include <stddef.h>
 #include <stdlib.h>
+#include <string.h> /* For memcpy(), memmove() and memset(). */
 
 #ifndef NS_API
 #define NS_API
 #endif
 
+#ifndef NS_INLINE
+#define NS_INLINE
+#endif
+
+#ifndef NS_COPY_MEMORY
+#define NS_COPY_MEMORY(dst, src, sz) memcpy((dst), (src), (sz))
+#endif
+
+#ifndef NS_MOVE_MEMORY
+#define NS_MOVE_MEMORY(dst, src, sz) memmove((dst), (src), (sz))
+#endif
+
+#ifndef NS_ZERO_MEMORY
+#define NS_ZERO_MEMORY(p, sz) memset((p), 0, (sz))
+#endif
+
+#ifndef NS_UNUSED
+#define NS_UNUSED(x) (void)(x)
+#endif
+
+/* A prefetch is only a hint so it's fine for this to do nothing. Define NS_NO_PREFETCH to disable prefetching. */
+#ifndef NS_PREFETCH
+    #if defined(NS_NO_PREFETCH)
+        #define NS_PREFETCH(p) ((void)(p))
+    #elif defined(__GNUC__) || defined(__clang__)
+        #define NS_PREFETCH(p) __builtin_prefetch(p)
+    #elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+        #include <xmmintrin.h>
+        #define NS_PREFETCH(p) _mm_prefetch((const char*)(p), _MM_HINT_T0)
+    #else
+        #define NS_PREFETCH(p) ((void)(p))
+    #endif
+#endif
+
+/* BEG sized_types.h */
+#include <stddef.h> /* For size_t. */
+
+#if defined(SIZE_MAX)
+    #define NS_SIZE_MAX     SIZE_MAX
+#else
+    #define NS_SIZE_MAX     0xFFFFFFFF  /* When SIZE_MAX is not defined by the standard library just default to the maximum 32-bit unsigned integer. */
+#endif
+
+#if defined(__LP64__) || defined(_WIN64) || (defined(__x86_64__) && !defined(__ILP32__)) || defined(_M_X64) || defined(__ia64) || defined(_M_IA64) || defined(__aarch64__) || defined(_M_ARM64) || defined(__powerpc64__)
+    #define NS_SIZEOF_PTR   8
+#else
+    #define NS_SIZEOF_PTR   4
+#endif
+
+#if defined(NS_USE_STDINT)
+    #include <stdint.h>
+    typedef int8_t                  ns_int8;
+    typedef uint8_t                 ns_uint8;
+    typedef int16_t                 ns_int16;
+    typedef uint16_t                ns_uint16;
+    typedef int32_t                 ns_int32;
+    typedef uint32_t                ns_uint32;
+    typedef int64_t                 ns_int64;
+    typedef uint64_t                ns_uint64;
+#else
+    typedef   signed char           ns_int8;
+    typedef unsigned char           ns_uint8;
+    typedef   signed short          ns_int16;
+    typedef unsigned short          ns_uint16;
+    typedef   signed int            ns_int32;
+    typedef unsigned int            ns_uint32;
+    #if defined(_MSC_VER) && !defined(__clang__)
+        typedef   signed __int64    ns_int64;
+        typedef unsigned __int64    ns_uint64;
+    #else
+        #if defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 6)))
+            #pragma GCC diagnostic push
+            #pragma GCC diagnostic ignored "-Wlong-long"
+            #if defined(__clang__)
+                #pragma GCC diagnostic ignored "-Wc++11-long-long"
+            #endif
+        #endif
+        typedef   signed long long  ns_int64;
+        typedef unsigned long long  ns_uint64;
+        #if defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 6)))
+            #pragma GCC diagnostic pop
+        #endif
+    #endif
+#endif  /* NS_USE_STDINT */
+
+#if NS_SIZEOF_PTR == 8
+    typedef ns_uint64 ns_uintptr;
+    typedef ns_int64  ns_intptr;
+#else
+    typedef ns_uint32 ns_uintptr;
+    typedef ns_int32  ns_intptr;
+#endif
+
+typedef unsigned char ns_bool8;
+typedef unsigned int  ns_bool32;
+#define NS_TRUE  1
+#define NS_FALSE 0
+
+#define NS_INT8_MIN   ((ns_int8 )0x80)
+#define NS_UINT8_MIN  ((ns_uint8)0x00)
+#define NS_INT16_MIN  ((ns_int16)0x8000)
+#define NS_UINT16_MIN ((ns_uint16)0x0000)
+#define NS_INT32_MIN  ((ns_int32 )0x80000000)
+#define NS_UINT32_MIN ((ns_uint32)0x00000000)
+#define NS_INT64_MIN  ((ns_int64 )(((ns_uint64)0x80000000 << 32) | 0x00000000))
+#define NS_UINT64_MIN ((ns_uint64)(((ns_uint64)0x00000000 << 32) | 0x00000000))
+
+#define NS_INT8_MAX   ((ns_int8 )0x7F)
+#define NS_UINT8_MAX  ((ns_uint8)0xFF)
+#define NS_INT16_MAX  ((ns_int16)0x7FFF)
+#define NS_UINT16_MAX ((ns_uint16)0xFFFF)
+#define NS_INT32_MAX  ((ns_int32 )0x7FFFFFFF)
+#define NS_UINT32_MAX ((ns_uint32)0xFFFFFFFF)
+#define NS_INT64_MAX  ((ns_int64 )(((ns_uint64)0x7FFFFFFF << 32) | 0xFFFFFFFF))
+#define NS_UINT64_MAX ((ns_uint64)(((ns_uint64)0xFFFFFFFF << 32) | 0xFFFFFFFF))
+/* END sized_types.h */
+
+/* BEG result.h */
+typedef enum
+{
+    NS_SUCCESS                       =  0,
+    NS_ERROR                         = -1,  /* Generic, unknown error. */
+    NS_INVALID_ARGS                  = -2,
+    NS_INVALID_OPERATION             = -3,
+    NS_OUT_OF_MEMORY                 = -4,
+    NS_OUT_OF_RANGE                  = -5,
+    NS_ACCESS_DENIED                 = -6,
+    NS_DOES_NOT_EXIST                = -7,
+    NS_ALREADY_EXISTS                = -8,
+    NS_TOO_MANY_OPEN_FILES           = -9,
+    NS_INVALID_FILE                  = -10,
+    NS_TOO_BIG                       = -11,
+    NS_PATH_TOO_LONG                 = -12,
+    NS_NAME_TOO_LONG                 = -13,
+    NS_NOT_DIRECTORY                 = -14,
+    NS_IS_DIRECTORY                  = -15,
+    NS_DIRECTORY_NOT_EMPTY           = -16,
+    NS_AT_END                        = -17,
+    NS_NO_SPACE                      = -18,
+    NS_BUSY                          = -19,
+    NS_IO_ERROR                      = -20,
+    NS_INTERRUPT                     = -21,
+    NS_UNAVAILABLE                   = -22,
+    NS_ALREADY_IN_USE                = -23,
+    NS_BAD_ADDRESS                   = -24,
+    NS_BAD_SEEK                      = -25,
+    NS_BAD_PIPE                      = -26,
+    NS_DEADLOCK                      = -27,
+    NS_TOO_MANY_LINKS                = -28,
+    NS_NOT_IMPLEMENTED               = -29,
+    NS_NO_MESSAGE                    = -30,
+    NS_BAD_MESSAGE                   = -31,
+    NS_NO_DATA_AVAILABLE             = -32,
+    NS_INVALID_DATA                  = -33,
+    NS_TIMEOUT                       = -34,
+    NS_NO_NETWORK                    = -35,
+    NS_NOT_UNIQUE                    = -36,
+    NS_NOT_SOCKET                    = -37,
+    NS_NO_ADDRESS                    = -38,
+    NS_BAD_PROTOCOL                  = -39,
+    NS_PROTOCOL_UNAVAILABLE          = -40,
+    NS_PROTOCOL_NOT_SUPPORTED        = -41,
+    NS_PROTOCOL_FAMILY_NOT_SUPPORTED = -42,
+    NS_ADDRESS_FAMILY_NOT_SUPPORTED  = -43,
+    NS_SOCKET_NOT_SUPPORTED          = -44,
+    NS_CONNECTION_RESET              = -45,
+    NS_ALREADY_CONNECTED             = -46,
+    NS_NOT_CONNECTED                 = -47,
+    NS_CONNECTION_REFUSED            = -48,
+    NS_NO_HOST                       = -49,
+    NS_IN_PROGRESS                   = -50,
+    NS_CANCELLED                     = -51,
+    NS_MEMORY_ALREADY_MAPPED         = -52,
+    NS_DIFFERENT_DEVICE              = -53,
+    NS_CHECKSUM_MISMATCH             = -100,
+    NS_NO_BACKEND                    = -101,
+
+    /* Non-Error Result Codes. */
+    NS_NEEDS_MORE_INPUT              = 100, /* Some stream needs more input data before it can be processed. */
+    NS_HAS_MORE_OUTPUT               = 102  /* Some stream has more output data to be read, but there's not enough room in the output buffer. */
+} ns_result;
+/* END result.h */
+
+/* BEG allocation_callbacks.h */
+typedef struct ns_allocation_callbacks
+{
+    void* pUserData;
+    void* (* onMalloc )(size_t sz, void* pUserData);
+    void* (* onRealloc)(void* p, size_t sz, void* pUserData);
+    void  (* onFree   )(void* p, void* pUserData);
+} ns_allocation_callbacks;
+
+NS_API void* ns_malloc(size_t sz, const ns_allocation_callbacks* pAllocationCallbacks);
+NS_API void* ns_calloc(size_t sz, const ns_allocation_callbacks* pAllocationCallbacks);
+NS_API void* ns_realloc(void* p, size_t sz, const ns_allocation_callbacks* pAllocationCallbacks);
+NS_API void  ns_free(void* p, const ns_allocation_callbacks* pAllocationCallbacks);
+NS_API void* ns_aligned_malloc(size_t sz, size_t alignment, const ns_allocation_callbacks* pAllocationCallbacks);
+NS_API void* ns_aligned_realloc(void* p, size_t sz, size_t alignment, const ns_allocation_callbacks* pAllocationCallbacks);
+NS_API void  ns_aligned_free(void* p, const ns_allocation_callbacks* pAllocationCallbacks);
+/* END allocation_callbacks.h */
+
 /* BEG binary_search.h */
 NS_API void* ns_binary_search(const void* pKey, const void* pList, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData);
 /* END binary_search.h */
 
+/* BEG binary_search_branchless.h */
+NS_API void* ns_binary_search_branchless(const void* pKey, const void* pList, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData);
+/* END binary_search_branchless.h */
+
+/* BEG gallop_search.h */
+NS_API size_t ns_gallop_search(const void* pKey, const void* pList, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData, size_t hintIndex);
+/* END gallop_search.h */
+
+/* BEG binary_search_batch.h */
+NS_API void ns_binary_search_batch(const void* pKeys, size_t keyCount, size_t keyStride, const void* pList, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData, void** ppResults);
+/* END binary_search_batch.h */
+
+/* BEG bounds.h */
+NS_API size_t ns_lower_bound(const void* pKey, const void* pList, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData);
+NS_API size_t ns_upper_bound(const void* pKey, const void* pList, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData);
+NS_API void ns_equal_range(const void* pKey, const void* pList, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData, size_t* pBeg, size_t* pEnd);
+/* END bounds.h */
+
+/* BEG interpolation_search.h */
+NS_API size_t ns_interpolation_search_u32(const ns_uint32* pList, size_t count, ns_uint32 key, size_t* pProbeCount);
+NS_API size_t ns_interpolation_search_u64(const ns_uint64* pList, size_t count, ns_uint64 key, size_t* pProbeCount);
+/* END interpolation_search.h */
+
+/* BEG eytzinger.h */
+NS_API void ns_eytzinger_build(const void* pSorted, size_t count, size_t stride, void* pOut);
+NS_API void* ns_eytzinger_search(const void* pKey, const void* pEytzinger, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData, size_t* pSortedIndex);
+/* END eytzinger.h */
+
+/* BEG static_btree.h */
+#define NS_STATIC_BTREE_MAX_LAYERS  32
+
+typedef struct
+{
+    void* pNodes;                                       /* Aligned to NS_STATIC_BTREE_NODE_SIZE. The root comes first, the leaves last. */
+    size_t count;
+    size_t keySize;                                     /* 4 for ns_uint32 keys, 8 for ns_uint64 keys. */
+    size_t layerCount;
+    size_t layerOffsets[NS_STATIC_BTREE_MAX_LAYERS];    /* In nodes. Layer 0 is the leaves. */
+    ns_allocation_callbacks allocationCallbacks;
+} ns_static_btree;
+
+NS_API ns_result ns_static_btree_init_u32(const ns_uint32* pSortedKeys, size_t count, const ns_allocation_callbacks* pAllocationCallbacks, ns_static_btree* pTree);
+NS_API ns_result ns_static_btree_init_u64(const ns_uint64* pSortedKeys, size_t count, const ns_allocation_callbacks* pAllocationCallbacks, ns_static_btree* pTree);
+NS_API void ns_static_btree_uninit(ns_static_btree* pTree);
+NS_API size_t ns_static_btree_lower_bound_u32(const ns_static_btree* pTree, ns_uint32 key);
+NS_API size_t ns_static_btree_lower_bound_u64(const ns_static_btree* pTree, ns_uint64 key);
+NS_API size_t ns_static_btree_find_u32(const ns_static_btree* pTree, ns_uint32 key);
+NS_API size_t ns_static_btree_find_u64(const ns_static_btree* pTree, ns_uint64 key);
+/* END static_btree.h */
+
+/* BEG static_hash_index.h */
+typedef struct
+{
+    const void* pList;
+    size_t count;
+    size_t stride;
+    ns_uint64 (* hashProc)(void* pUserData, const void* pKey);
+    int (* compareProc)(void* pUserData, const void* pKey, const void* pElement);
+    void* pUserData;
+    ns_uint64 seed;
+    size_t bucketCount;
+    const ns_uint32* pPilots;       /* One per bucket. */
+    const ns_uint32* pSlots;        /* One per element. The index in pList of the element that hashes to each slot. */
+    void* pAllocation;              /* NULL when initialized from a buffer, in which case pPilots and pSlots point into it. */
+    ns_allocation_callbacks allocationCallbacks;
+} ns_static_hash_index;
+
+NS_API ns_result ns_static_hash_index_init(const void* pList, size_t count, size_t stride, ns_uint64 (*hashProc)(void*, const void*), int (*compareProc)(void*, const void*, const void*), void* pUserData, const ns_allocation_callbacks* pAllocationCallbacks, ns_static_hash_index* pIndex);
+NS_API ns_result ns_static_hash_index_init_from_buffer(const void* pBuffer, size_t bufferSize, const void* pList, size_t count, size_t stride, ns_uint64 (*hashProc)(void*, const void*), int (*compareProc)(void*, const void*, const void*), void* pUserData, ns_static_hash_index* pIndex);
+NS_API void ns_static_hash_index_uninit(ns_static_hash_index* pIndex);
+NS_API void* ns_static_hash_index_find(const ns_static_hash_index* pIndex, const void* pKey);
+NS_API size_t ns_static_hash_index_get_serialized_size(const ns_static_hash_index* pIndex);
+NS_API ns_result ns_static_hash_index_serialize(const ns_static_hash_index* pIndex, void* pBuffer, size_t bufferSize);
+/* END static_hash_index.h */
+
 /* BEG linear_search.h */
 NS_API void* ns_linear_search(const void* pKey, const void* pList, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData);
+NS_API size_t ns_linear_search_u8(const ns_uint8* pList, size_t count, ns_uint8 key);
+NS_API size_t ns_linear_search_u16(const ns_uint16* pList, size_t count, ns_uint16 key);
+NS_API size_t ns_linear_search_u32(const ns_uint32* pList, size_t count, ns_uint32 key);
+NS_API size_t ns_linear_search_u64(const ns_uint64* pList, size_t count, ns_uint64 key);
+NS_API size_t ns_linear_search_f32(const float* pList, size_t count, float key);
 /* END linear_search.h */
 
 /* BEG sorted_search.h */
 NS_API void* ns_sorted_search(const void* pKey, const void* pList, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData);
 /* END sorted_search.h */
 
+/* BEG search_tuner.h */
+#define NS_SEARCH_TUNER_MAX_SIZES       14
+#define NS_SEARCH_TUNER_MAX_ENTRIES     16
+
+typedef struct
+{
+    size_t stride;
+    int (* compareProc)(void*, const void*, const void*);
+    size_t linearThreshold;                                 /* Linear search below this count. */
+    size_t branchlessThreshold;                             /* ns_binary_search_branchless() at or above this count, ns_binary_search() in between. */
+    size_t measuredSizeCount;                               /* 0 if the thresholds were set with ns_search_tuner_set(). */
+    size_t measuredSizes[NS_SEARCH_TUNER_MAX_SIZES];
+    double linearCosts[NS_SEARCH_TUNER_MAX_SIZES];          /* Nanoseconds per search, for each of the measured sizes. */
+    double binaryCosts[NS_SEARCH_TUNER_MAX_SIZES];
+    double branchlessCosts[NS_SEARCH_TUNER_MAX_SIZES];
+} ns_search_tuning;
+
+typedef struct
+{
+    ns_search_tuning entries[NS_SEARCH_TUNER_MAX_ENTRIES];
+    size_t entryCount;
+} ns_search_tuner;
+
+NS_API void ns_search_tuner_init(ns_search_tuner* pTuner);
+NS_API ns_result ns_search_tuner_measure(ns_search_tuner* pTuner, const void* pKeys, size_t keyCount, size_t keyStride, const void* pList, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData, const ns_search_tuning** ppTuning);
+NS_API ns_result ns_search_tuner_set(ns_search_tuner* pTuner, size_t stride, int (*compareProc)(void*, const void*, const void*), size_t linearThreshold, size_t branchlessThreshold);
+NS_API const ns_search_tuning* ns_search_tuner_get(const ns_search_tuner* pTuner, size_t stride, int (*compareProc)(void*, const void*, const void*));
+NS_API void* ns_sorted_search_tuned(const ns_search_tuner* pTuner, const void* pKey, const void* pList, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData);
+/* END search_tuner.h */
+
+
+
+/* BEG allocation_callbacks.c */
+#if !defined(NS_MALLOC) || !defined(NS_REALLOC) || !defined(NS_FREE)
+#include <stdlib.h> /* For malloc, realloc, free. */
+#endif
+
+#ifndef NS_MALLOC
+#define NS_MALLOC(sz) malloc(sz)
+#endif
+#ifndef NS_REALLOC
+#define NS_REALLOC(p, sz) realloc(p, sz)
+#endif
+#ifndef NS_FREE
+#define NS_FREE(p) free(p)
+#endif
+
+typedef struct
+{
+    void* pUnaligned;
+    size_t size;
+    size_t alignment;
+} ns_aligned_allocation_header;
+
+static void* ns_malloc_default(size_t sz, void* pUserData)
+{
+    NS_UNUSED(pUserData);
+    return NS_MALLOC(sz);
+}
+
+static void* ns_realloc_default(void* p, size_t sz, void* pUserData)
+{
+    NS_UNUSED(pUserData);
+    return NS_REALLOC(p, sz);
+}
+
+static void ns_free_default(void* p, void* pUserData)
+{
+    NS_UNUSED(pUserData);
+    NS_FREE(p);
+}
+
+
+NS_API ns_allocation_callbacks ns_allocation_callbacks_init_default(void)
+{
+    ns_allocation_callbacks allocationCallbacks;
+
+    allocationCallbacks.pUserData = NULL;
+    allocationCallbacks.onMalloc  = ns_malloc_default;
+    allocationCallbacks.onRealloc = ns_realloc_default;
+    allocationCallbacks.onFree    = ns_free_default;
+
+    return allocationCallbacks;
+}
+
+NS_API ns_allocation_callbacks ns_allocation_callbacks_init_copy(const ns_allocation_callbacks* pAllocationCallbacks)
+{
+    if (pAllocationCallbacks != NULL) {
+        return *pAllocationCallbacks;
+    } else {
+        return ns_allocation_callbacks_init_default();
+    }
+}
+
+
+NS_API void* ns_malloc(size_t sz, const ns_allocation_callbacks* pAllocationCallbacks)
+{
+    if (pAllocationCallbacks != NULL) {
+        if (pAllocationCallbacks->onMalloc != NULL) {
+            return pAllocationCallbacks->onMalloc(sz, pAllocationCallbacks->pUserData);
+        } else {
+            return NULL;    /* Do not fall back to the default implementation. */
+        }
+    } else {
+        return ns_malloc_default(sz, NULL);
+    }
+}
+
+NS_API void* ns_calloc(size_t sz, const ns_allocation_callbacks* pAllocationCallbacks)
+{
+    void* p = ns_malloc(sz, pAllocationCallbacks);
+    if (p != NULL) {
+        NS_ZERO_MEMORY(p, sz);
+    }
+
+    return p;
+}
+
+NS_API void* ns_realloc(void* p, size_t sz, const ns_allocation_callbacks* pAllocationCallbacks)
+{
+    if (pAllocationCallbacks != NULL) {
+        if (pAllocationCallbacks->onRealloc != NULL) {
+            return pAllocationCallbacks->onRealloc(p, sz, pAllocationCallbacks->pUserData);
+        } else {
+            return NULL;    /* Do not fall back to the default implementation. */
+        }
+    } else {
+        return ns_realloc_default(p, sz, NULL);
+    }
+}
+
+NS_API void ns_free(void* p, const ns_allocation_callbacks* pAllocationCallbacks)
+{
+    if (p == NULL) {
+        return;
+    }
+
+    if (pAllocationCallbacks != NULL) {
+        if (pAllocationCallbacks->onFree != NULL) {
+            pAllocationCallbacks->onFree(p, pAllocationCallbacks->pUserData);
+        } else {
+            return; /* Do no fall back to the default implementation. */
+        }
+    } else {
+        ns_free_default(p, NULL);
+    }
+}
+
+NS_API void* ns_aligned_malloc(size_t sz, size_t alignment, const ns_allocation_callbacks* pAllocationCallbacks)
+{
+    size_t extraBytes;
+    void* pUnaligned;
+    void* pAligned;
+    ns_aligned_allocation_header* pHeader;
+
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        return 0;
+    }
+
+    if (alignment - 1 > (size_t)-1 - sizeof(ns_aligned_allocation_header)) {
+        return NULL;
+    }
+
+    extraBytes = alignment-1 + sizeof(ns_aligned_allocation_header);
+
+    if (sz > (size_t)-1 - extraBytes) {
+        return NULL;
+    }
+
+    pUnaligned = ns_malloc(sz + extraBytes, pAllocationCallbacks);
+    if (pUnaligned == NULL) {
+        return NULL;
+    }
+
+    pAligned = (void*)(((ns_uintptr)pUnaligned + extraBytes) & ~((ns_uintptr)(alignment-1)));
+    pHeader = (ns_aligned_allocation_header*)((unsigned char*)pAligned - sizeof(*pHeader));
+    pHeader->pUnaligned = pUnaligned;
+    pHeader->size       = sz;
+    pHeader->alignment  = alignment;
+
+    return pAligned;
+}
+
+NS_API void* ns_aligned_realloc(void* p, size_t sz, size_t alignment, const ns_allocation_callbacks* pAllocationCallbacks)
+{
+    size_t extraBytes;
+    size_t oldAlignmentOffset;
+    size_t oldSize;
+    void* pOldUnaligned;
+    void* pNewUnaligned;
+    void* pNewAligned;
+    ns_aligned_allocation_header* pHeader;
+
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        return 0;
+    }
+
+    if (p == NULL) {
+        return ns_aligned_malloc(sz, alignment, pAllocationCallbacks);
+    }
+
+    pHeader = (ns_aligned_allocation_header*)((unsigned char*)p - sizeof(*pHeader));
+    pOldUnaligned = pHeader->pUnaligned;
+    oldSize = pHeader->size;
+
+    if (alignment != pHeader->alignment) {
+        return NULL;
+    }
+
+    oldAlignmentOffset = (size_t)((unsigned char*)p - (unsigned char*)pOldUnaligned);
+
+    if (alignment - 1 > (size_t)-1 - sizeof(ns_aligned_allocation_header)) {
+        return NULL;
+    }
+
+    extraBytes = alignment-1 + sizeof(ns_aligned_allocation_header);
+
+    if (oldAlignmentOffset > extraBytes) {
+        return NULL;
+    }
+
+    if (sz > (size_t)-1 - extraBytes) {
+        return NULL;
+    }
 
+    pNewUnaligned = ns_realloc(pOldUnaligned, sz + extraBytes, pAllocationCallbacks);
+    if (pNewUnaligned == NULL) {
+        return NULL;
+    }
+
+    pNewAligned = (void*)(((ns_uintptr)pNewUnaligned + extraBytes) & ~((ns_uintptr)(alignment-1)));
+
+    if (pNewAligned != (unsigned char*)pNewUnaligned + oldAlignmentOffset) {
+        void* pDst = pNewAligned;
+        void* pSrc = (unsigned char*)pNewUnaligned + oldAlignmentOffset;
+        NS_MOVE_MEMORY(pDst, pSrc, (oldSize < sz) ? oldSize : sz);
+    }
+
+    pHeader = (ns_aligned_allocation_header*)((unsigned char*)pNewAligned - sizeof(*pHeader));
+    pHeader->pUnaligned = pNewUnaligned;
+    pHeader->size       = sz;
+    pHeader->alignment  = alignment;
+
+    return pNewAligned;
+}
+
+NS_API void ns_aligned_free(void* p, const ns_allocation_callbacks* pAllocationCallbacks)
+{
+    ns_aligned_allocation_header* pHeader;
+
+    if (p == NULL) {
+        return;
+    }
+
+    pHeader = (ns_aligned_allocation_header*)((unsigned char*)p - sizeof(*pHeader));
+    ns_free(pHeader->pUnaligned, pAllocationCallbacks);
+}
+/* END allocation_callbacks.c */
 
 /* BEG binary_search.c */
 NS_API void* ns_binary_search(const void* pKey, const void* pList, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData)
@@ -40,6 +579,10 @@ NS_API void* ns_binary_search(const void* pKey, const void* pList, size_t count,
 
         compareResult = compareProc(pUserData, pKey, (char*)pList + (iMid * stride));
         if (compareResult < 0) {
+            if (iMid == 0) {
+                break;  /* The key is smaller than everything. Don't let iEnd wrap around. */
+            }
+
             iEnd = iMid - 1;
         } else if (compareResult > 0) {
             iStart = iMid + 1;
@@ -52,75 +595,2850 @@ NS_API void* ns_binary_search(const void* pKey, const void* pList, size_t count,
 }
 /* END binary_search.c */
 
-/* BEG linear_search.c */
-NS_API void* ns_linear_search(const void* pKey, const void* pList, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData)
+/* BEG binary_search_branchless.c */
+/*
+A binary search for large tables. The classic search branches on every comparison, and on a large table each of those branches
+is a coin flip that the CPU will mispredict half the time. This finds the lower bound instead, by halving the length of the range
+on every iteration and only moving the base when the key is in the upper half. The move is a select, which compilers turn into a
+conditional move, so the loop has a fixed trip count and no data dependent branches outside of compareProc. The exact match check
+is done once at the end. Like ns_binary_search(), compareProc is always given the key first.
+
+Because the CPU no longer speculates down one side, nothing is loaded until the comparison is done. To make up for it, both of the
+possible midpoints for the next iteration are prefetched. One of them is wasted, but the one that's needed arrives a step early.
+Define NS_NO_PREFETCH to disable this.
+
+This always does log2(count) + 1 comparisons, whereas the classic search can stop early on a match. For small tables, where
+everything is in cache and there are few branches to mispredict, ns_binary_search() is just as fast.
+*/
+NS_API void* ns_binary_search_branchless(const void* pKey, const void* pList, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData)
 {
-    size_t i;
+    const char* pBase = (const char*)pList;
+    size_t n = count;
+    int compareResult;
 
-    for (i = 0; i < count; i+= 1) {
-        int compareResult = compareProc(pUserData, pKey, (char*)pList + (i * stride));
-        if (compareResult == 0) {
-            return (void*)((char*)pList + (i * stride));
+    if (count == 0) {
+        return NULL;
+    }
+
+    while (n > 1) {
+        size_t half = n / 2;
+
+        NS_PREFETCH(pBase + ((n - half) / 2)*stride);
+        NS_PREFETCH(pBase + (half + (n - half) / 2)*stride);
+
+        pBase = (compareProc(pUserData, pKey, pBase + half*stride) > 0) ? pBase + half*stride : pBase;
+        n -= half;
+    }
+
+    /* The lower bound is either pBase or the element after it. */
+    compareResult = compareProc(pUserData, pKey, pBase);
+    if (compareResult > 0) {
+        pBase += stride;
+        if (pBase == (const char*)pList + count*stride) {
+            return NULL;
         }
+
+        compareResult = compareProc(pUserData, pKey, pBase);
+    }
+
+    if (compareResult == 0) {
+        return (void*)pBase;
     }
 
     return NULL;
 }
-/* END linear_search.c */
+/* END binary_search_branchless.c */
 
-/* BEG sorted_search.c */
-NS_API void* ns_sorted_search(const void* pKey, const void* pList, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData)
+/* BEG bounds.c */
+/*
+ns_lower_bound() returns the index of the first element that is not less than pKey, and ns_upper_bound() the index of the first
+element that is greater than pKey. Both return count if there is no such element. ns_equal_range() outputs both, so the elements
+equal to pKey are the ones from *pBeg up to but not including *pEnd, which is an empty range if there are none. A range query,
+like everything between A and B, is ns_lower_bound() of A and ns_upper_bound() of B.
+
+These use the same branchless loop as ns_binary_search_branchless(), so they always do log2(count) + 1 comparisons. compareProc is
+always given pKey first.
+*/
+static size_t ns_bound_internal(const void* pKey, const void* pList, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData, int threshold)
 {
-    const size_t threshold = 10;
+    const char* pBase = (const char*)pList;
+    size_t n = count;
 
-    if (count < threshold) {
-        return ns_linear_search(pKey, pList, count, stride, compareProc, pUserData);
-    } else {
-        return ns_binary_search(pKey, pList, count, stride, compareProc, pUserData);
+    if (pList == NULL || count == 0) {
+        return 0;
     }
-}
-/* END sorted_search.c */
 
+    /* The base moves past elements where compareProc returns more than the threshold. That's 0 for the lower bound and -1 for the upper. */
+    while (n > 1) {
+        size_t half = n / 2;
 
+        NS_PREFETCH(pBase + ((n - half) / 2)*stride);
+        NS_PREFETCH(pBase + (half + (n - half) / 2)*stride);
 
-#include <stdio.h>
-#include <string.h>
+        pBase = (compareProc(pUserData, pKey, pBase + half*stride) > threshold) ? pBase + half*stride : pBase;
+        n -= half;
+    }
 
-int compare_int(void* context, const void* a, const void* b)
+    return (size_t)(pBase - (const char*)pList) / stride + (compareProc(pUserData, pKey, pBase) > threshold);
+}
+
+NS_API size_t ns_lower_bound(const void* pKey, const void* pList, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData)
 {
-    (void)context;
-    return (*(int*)a - *(int*)b);
+    return ns_bound_internal(pKey, pList, count, stride, compareProc, pUserData, 0);
 }
 
-int compare_strings(void* context, const void* a, const void* b)
+NS_API size_t ns_upper_bound(const void* pKey, const void* pList, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData)
 {
-    (void)context;
-    return strcmp((const char*)a, *(const char**)b);
+    return ns_bound_internal(pKey, pList, count, stride, compareProc, pUserData, -1);
 }
 
-int main(void)
+NS_API void ns_equal_range(const void* pKey, const void* pList, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData, size_t* pBeg, size_t* pEnd)
 {
-    {
-        int arr[] = {1, 2, 3, 4, 5};
-        int key = 4;
-        int* result = ns_binary_search(&key, arr, 5, sizeof(int), compare_int, NULL);
-        if (result != NULL) {
-            printf("Key found at index %u\n", (unsigned int)(result - arr));
-        } else {
-            printf("Key not found\n");
+    size_t beg;
+    size_t end;
+
+    /* The upper bound can't come before the lower bound so it only needs to search what's left. */
+    beg = ns_lower_bound(pKey, pList, count, stride, compareProc, pUserData);
+    end = beg;
+    if (beg < count) {
+        end = beg + ns_upper_bound(pKey, (const char*)pList + beg*stride, count - beg, stride, compareProc, pUserData);
+    }
+
+    if (pBeg != NULL) {
+        *pBeg = beg;
+    }
+    if (pEnd != NULL) {
+        *pEnd = end;
+    }
+}
+/* END bounds.c */
+
+/* BEG gallop_search.c */
+/*
+Finds the lower bound of pKey, like ns_lower_bound(), starting from a guess. From hintIndex it probes 1, 2, 4, 8 and so on
+elements away in the direction of the key until it has gone past it, and then does a binary search between the last two probes.
+If the lower bound is d elements from the hint this takes about 2*log2(d) comparisons rather than log2(count), and the probes
+close to the hint are likely to still be in cache.
+
+This is for when consecutive searches are for keys that are close together, like advancing through a sorted table in a merge
+join. Pass the result of one search as the hint for the next. Any hint works, and one past the end is clamped to the end, but a
+bad hint can cost up to twice as many comparisons as ns_lower_bound(). compareProc is always given pKey first.
+*/
+NS_API size_t ns_gallop_search(const void* pKey, const void* pList, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData, size_t hintIndex)
+{
+    const char* pBase = (const char*)pList;
+    size_t lo;
+    size_t hi;
+    size_t step;
+
+    if (pList == NULL || count == 0) {
+        return 0;
+    }
+
+    if (hintIndex >= count) {
+        hintIndex = count - 1;
+    }
+
+    /* Narrow it down to [lo, hi], where everything before lo is less than the key and the element at hi, if any, is not. */
+    if (compareProc(pUserData, pKey, pBase + hintIndex*stride) > 0) {
+        lo = hintIndex + 1;
+        hi = count;
+
+        for (step = 1; step < count - hintIndex; step *= 2) {
+            size_t probe = hintIndex + step;
+
+            if (compareProc(pUserData, pKey, pBase + probe*stride) <= 0) {
+                hi = probe;
+                break;
+            }
+
+            lo = probe + 1;
+
+            if (step > (count - hintIndex) / 2) {
+                break;  /* The next step would be past the end. */
+            }
+        }
+    } else {
+        lo = 0;
+        hi = hintIndex;
+
+        for (step = 1; step <= hintIndex; step *= 2) {
+            size_t probe = hintIndex - step;
+
+            if (compareProc(pUserData, pKey, pBase + probe*stride) > 0) {
+                lo = probe + 1;
+                break;
+            }
+
+            hi = probe;
+
+            if (step > hintIndex / 2) {
+                break;
+            }
         }
     }
-    
-    {
-        char* list[] = {"apple", "banana", "cherry", "date"};
-        const char* key = "cherry";
-        char** result = ns_binary_search(key, list, 4, sizeof(char*), compare_strings, NULL);
-        if (result != NULL) {
-          printf("String found at index %u\n", (unsigned int)(result - list));
-        } else {
-          printf("String not found\n");
+
+    return lo + ns_lower_bound(pKey, pBase + lo*stride, hi - lo, stride, compareProc, pUserData);
+}
+/* END gallop_search.c */
+
+/* BEG binary_search_batch.c */
+/*
+Searches for many keys at once. pKeys is an array of keyCount keys, keyStride bytes apart, and each key is passed to compareProc
+the same way ns_binary_search() passes pKey. ppResults, which must have room for keyCount pointers, receives a pointer to the first
+element equal to each key, or NULL.
+
+Looking keys up one at a time on a large table stalls on a cache miss at almost every step, one miss at a time. Here the keys are
+searched in groups of NS_BINARY_SEARCH_BATCH_SIZE. Every key in a group does the same number of steps since they all search the
+same range, so the group moves down the table in lockstep, one step for every key before the next step for any of them. As soon
+as a key has moved, its next midpoint is prefetched, and by the time the rest of the group has had its turn it has arrived. The
+misses for the whole group overlap instead of being paid for one after the other.
+
+When the keys are sorted there's a shortcut. The next group's keys can't come before the last group's result, and the last key in
+the group is found by galloping forward from there, which gives a window that only covers that group. The whole group is then
+searched within the window, which is usually much smaller than the table and already in cache. The keys don't need to be declared
+sorted. Each group checks whether its results were in order, and a key that lands on the edge of the window, which means it may be
+outside of it, is searched again over the whole table. An unsorted group turns the shortcut off until the results are in order
+again, so unsorted keys cost one extra comparison per group at most.
+*/
+#define NS_BINARY_SEARCH_BATCH_SIZE 16
+
+/* Finds the lower bound of each key in the group within the window, relative to the start of the window. */
+static void ns_binary_search_batch_group(const char* pKeys, size_t keyCount, size_t keyStride, const char* pWindow, size_t n, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData, size_t* pLowerBounds)
+{
+    const char* pBases[NS_BINARY_SEARCH_BATCH_SIZE];
+    size_t iKey;
+
+    for (iKey = 0; iKey < keyCount; iKey += 1) {
+        pBases[iKey] = pWindow;
+    }
+
+    while (n > 1) {
+        size_t half = n / 2;
+        size_t nextHalf = (n - half) / 2;
+
+        for (iKey = 0; iKey < keyCount; iKey += 1) {
+            const char* pBase = pBases[iKey];
+
+            pBase = (compareProc(pUserData, pKeys + iKey*keyStride, pBase + half*stride) > 0) ? pBase + half*stride : pBase;
+            NS_PREFETCH(pBase + nextHalf*stride);
+
+            pBases[iKey] = pBase;
         }
+
+        n -= half;
     }
 
-    return 0;
+    for (iKey = 0; iKey < keyCount; iKey += 1) {
+        pLowerBounds[iKey] = (size_t)(pBases[iKey] - pWindow) / stride + (compareProc(pUserData, pKeys + iKey*keyStride, pBases[iKey]) > 0);
+    }
+}
+
+NS_API void ns_binary_search_batch(const void* pKeys, size_t keyCount, size_t keyStride, const void* pList, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData, void** ppResults)
+{
+    size_t lowerBounds[NS_BINARY_SEARCH_BATCH_SIZE];
+    size_t previousLowerBound = 0;
+    int sorted = 1;
+    size_t iGroup;
+
+    if (ppResults == NULL || (pKeys == NULL && keyCount > 0)) {
+        return;
+    }
+
+    if (pList == NULL || count == 0) {
+        for (iGroup = 0; iGroup < keyCount; iGroup += 1) {
+            ppResults[iGroup] = NULL;
+        }
+
+        return;
+    }
+
+    for (iGroup = 0; iGroup < keyCount; iGroup += NS_BINARY_SEARCH_BATCH_SIZE) {
+        const char* pGroupKeys = (const char*)pKeys + iGroup*keyStride;
+        size_t groupSize = keyCount - iGroup;
+        size_t windowBeg = 0;
+        size_t windowEnd = count;
+        int inOrder = 1;
+        size_t iKey;
+
+        if (groupSize > NS_BINARY_SEARCH_BATCH_SIZE) {
+            groupSize = NS_BINARY_SEARCH_BATCH_SIZE;
+        }
+
+        if (sorted) {
+            const char* pLastKey = pGroupKeys + (groupSize - 1)*keyStride;
+            size_t step = 1;
+            size_t probe = previousLowerBound;
+
+            /* The window starts one early so a key that belongs before it lands on its edge. */
+            windowBeg = (previousLowerBound > 0) ? previousLowerBound - 1 : 0;
+
+            while (probe < count && compareProc(pUserData, pLastKey, (const char*)pList + probe*stride) > 0) {
+                probe = (count - previousLowerBound > step) ? previousLowerBound + step : count;
+                step *= 2;
+            }
+
+            windowEnd = (probe < count) ? probe + 1 : count;
+        }
+
+        ns_binary_search_batch_group(pGroupKeys, groupSize, keyStride, (const char*)pList + windowBeg*stride, windowEnd - windowBeg, stride, compareProc, pUserData, lowerBounds);
+
+        for (iKey = 0; iKey < groupSize; iKey += 1) {
+            const void* pKey = pGroupKeys + iKey*keyStride;
+            size_t lowerBound = windowBeg + lowerBounds[iKey];
+
+            /* On the edge of a window that isn't the edge of the table means it might be outside of the window. */
+            if ((lowerBound == windowBeg && windowBeg > 0) || (lowerBound == windowEnd && windowEnd < count)) {
+                lowerBound = ns_lower_bound(pKey, pList, count, stride, compareProc, pUserData);
+                inOrder = 0;
+            }
+
+            if (lowerBound < previousLowerBound) {
+                inOrder = 0;
+            }
+
+            if (lowerBound < count && compareProc(pUserData, pKey, (const char*)pList + lowerBound*stride) == 0) {
+                ppResults[iGroup + iKey] = (void*)((const char*)pList + lowerBound*stride);
+            } else {
+                ppResults[iGroup + iKey] = NULL;
+            }
+
+            previousLowerBound = lowerBound;
+        }
+
+        sorted = inOrder;
+    }
+}
+/* END binary_search_batch.c */
+
+/* BEG interpolation_search.c */
+/*
+Interpolation search for sorted arrays of integer keys. Rather than probing the middle of the range, this guesses where the key
+should be from where it falls between the values at either end of the range, which for keys that are spread evenly is right or
+very close to it. A dense table of IDs needs two or three probes where a binary search would need log2(count).
+
+On a skewed distribution the guesses can be poor, so every step has to at least halve the range. If one doesn't, the next step is a
+plain bisection. This means it's never worse than about twice the probes of a binary search. Once the range is down to
+NS_INTERPOLATION_SEARCH_SEQUENTIAL_COUNT elements, they're scanned in order, which is cheaper than another guess.
+
+These return the index of the first element equal to the key, or count if there isn't one. If pProbeCount is not NULL it receives
+the number of elements that were read, including both ends and the final scan. Compare it against log2(count) to tell whether a
+table is a good fit.
+*/
+#define NS_INTERPOLATION_SEARCH_SEQUENTIAL_COUNT    8
+
+#define NS_INTERPOLATION_SEARCH_DEFINE(name, T) \
+NS_API size_t name(const T* pList, size_t count, T key, size_t* pProbeCount) \
+{ \
+    size_t probeCount = 0; \
+    size_t lo; \
+    size_t hi; \
+    size_t lowerBound; \
+    T loValue; \
+    T hiValue; \
+    int bisect = 0; \
+\
+    if (pProbeCount != NULL) { \
+        *pProbeCount = 0; \
+    } \
+\
+    if (pList == NULL || count == 0) { \
+        return count; \
+    } \
+\
+    /* The key is always greater than the value at lo and no greater than the value at hi, so the answer is in (lo, hi]. */ \
+    loValue = pList[0]; \
+    hiValue = pList[count - 1]; \
+    probeCount = 2; \
+\
+    if (key <= loValue) { \
+        lowerBound = 0; \
+    } else if (key > hiValue) { \
+        lowerBound = count; \
+    } else { \
+        lo = 0; \
+        hi = count - 1; \
+\
+        while (hi - lo > NS_INTERPOLATION_SEARCH_SEQUENTIAL_COUNT) { \
+            size_t range = hi - lo; \
+            size_t probe; \
+            T probeValue; \
+\
+            if (bisect) { \
+                probe = lo + range/2; \
+            } else { \
+                probe = lo + (size_t)(((double)(key - loValue) / (double)(hiValue - loValue)) * (double)range); \
+                if (probe <= lo) { \
+                    probe = lo + 1; \
+                } else if (probe >= hi) { \
+                    probe = hi - 1; \
+                } \
+            } \
+\
+            probeValue = pList[probe]; \
+            probeCount += 1; \
+\
+            if (probeValue < key) { \
+                lo = probe; \
+                loValue = probeValue; \
+            } else { \
+                hi = probe; \
+                hiValue = probeValue; \
+            } \
+\
+            bisect = !bisect && (hi - lo > range/2); \
+        } \
+\
+        lowerBound = lo + 1; \
+        while (lowerBound < hi) { \
+            probeCount += 1; \
+            if (pList[lowerBound] >= key) { \
+                break; \
+            } \
+            lowerBound += 1; \
+        } \
+    } \
+\
+    if (pProbeCount != NULL) { \
+        *pProbeCount = probeCount; \
+    } \
+\
+    if (lowerBound < count && pList[lowerBound] == key) { \
+        return lowerBound; \
+    } \
+\
+    return count; \
+}
+
+NS_INTERPOLATION_SEARCH_DEFINE(ns_interpolation_search_u32, ns_uint32)
+NS_INTERPOLATION_SEARCH_DEFINE(ns_interpolation_search_u64, ns_uint64)
+/* END interpolation_search.c */
+
+/* BEG eytzinger.c */
+/*
+The Eytzinger layout stores a sorted array in the order of a breadth first walk of the implicit binary search tree, the same way a
+binary heap is laid out. The root comes first, then its two children, then their four children and so on. A search walks down
+from the root, and the children of node k are at 2k and 2k+1 (counting from 1). This is better for the cache than a binary search
+on a sorted array in two ways. The first few levels of the tree, which every search touches, are packed together at the front.
+And the descendants of a node a few levels down are next to each other, so they can all be prefetched at once, well before
+they're needed. Going down a level is a multiply and an add of the comparison result, so there are no branches to mispredict
+either.
+
+ns_eytzinger_build() fills pOut, which must have room for count elements, from a sorted array. It's a one time cost, so this is
+for tables that are built once and searched many times.
+
+ns_eytzinger_search() finds the first element that isn't less than pKey, and returns a pointer to it if it's equal to pKey, or
+NULL otherwise. If pSortedIndex is not NULL, it receives the position of that element in the original sorted array, or count if
+every element is less than pKey. compareProc is always given pKey first, like ns_binary_search().
+*/
+static size_t ns_eytzinger_build_recursive(const char* pSorted, char* pOut, size_t count, size_t stride, size_t sortedIndex, size_t k)
+{
+    /* An in-order walk of the tree visits the nodes in sorted order. */
+    if (k <= count) {
+        sortedIndex = ns_eytzinger_build_recursive(pSorted, pOut, count, stride, sortedIndex, 2*k);
+        memcpy(pOut + (k - 1)*stride, pSorted + sortedIndex*stride, stride);
+        sortedIndex = ns_eytzinger_build_recursive(pSorted, pOut, count, stride, sortedIndex + 1, 2*k + 1);
+    }
+
+    return sortedIndex;
+}
+
+NS_API void ns_eytzinger_build(const void* pSorted, size_t count, size_t stride, void* pOut)
+{
+    if (pSorted == NULL || pOut == NULL) {
+        return;
+    }
+
+    ns_eytzinger_build_recursive((const char*)pSorted, (char*)pOut, count, stride, 0, 1);
+}
+
+static size_t ns_eytzinger_floor_log2(size_t x)
+{
+    size_t result = 0;
+
+#if defined(__GNUC__) || defined(__clang__)
+    if (sizeof(size_t) <= sizeof(unsigned long)) {
+        return (sizeof(unsigned long)*8 - 1) - (size_t)__builtin_clzl((unsigned long)x);
+    }
+#endif
+
+    while (x > 1) {
+        x >>= 1;
+        result += 1;
+    }
+
+    return result;
+}
+
+/*
+Maps node k, counting from 1, back to its position in the sorted array. If the tree were perfect this would just be the node's
+in-order position. The last level is only filled from the left though, so the missing slots on the last level that come before
+the node in order need to be subtracted. The slots on the last level are every second in-order position in the perfect tree.
+*/
+static size_t ns_eytzinger_to_sorted_index(size_t k, size_t count)
+{
+    size_t levels = ns_eytzinger_floor_log2(count) + 1;
+    size_t depth  = ns_eytzinger_floor_log2(k);
+    size_t perfectIndex = ((2*(k - ((size_t)1 << depth)) + 1) << (levels - 1 - depth)) - 1;
+    size_t lastLevelCount = count - (((size_t)1 << (levels - 1)) - 1);
+    size_t lastLevelSlotsBefore = (perfectIndex + 1) / 2;
+
+    if (lastLevelSlotsBefore > lastLevelCount) {
+        return perfectIndex - (lastLevelSlotsBefore - lastLevelCount);
+    } else {
+        return perfectIndex;
+    }
+}
+
+NS_API void* ns_eytzinger_search(const void* pKey, const void* pEytzinger, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData, size_t* pSortedIndex)
+{
+    const char* pBase = (const char*)pEytzinger;
+    size_t prefetchLevels = 1;
+    size_t prefetchBytes;
+    size_t levels;
+    size_t level;
+    size_t k = 1;
+
+    if (pSortedIndex != NULL) {
+        *pSortedIndex = count;
+    }
+
+    if (pEytzinger == NULL || count == 0) {
+        return NULL;
+    }
+
+    /*
+    Prefetch as many levels ahead as fit in the size of a cache line, but at least two, in which case it'll span a few lines.
+    Nodes are stored from k - 1, so even a block that's exactly a line in size straddles two lines unless pEytzinger happens to be
+    one element short of a line boundary. The line holding the last byte is always prefetched as well to cover that.
+    */
+    while (((size_t)2 << prefetchLevels) * stride <= 64) {
+        prefetchLevels += 1;
+    }
+    if (prefetchLevels < 2) {
+        prefetchLevels = 2;
+    }
+
+    prefetchBytes = ((size_t)1 << prefetchLevels) * stride;
+
+    /*
+    Every level but the last is full, so the loop has a fixed trip count and the exit is never mispredicted. The last level is
+    only partially filled. If the node isn't there, the comparison is done against the root instead, which will be in cache,
+    and the result is forced to a right turn which gets dropped below.
+    */
+    levels = ns_eytzinger_floor_log2(count) + 1;
+
+    for (level = 1; level < levels; level += 1) {
+        size_t descendant = k << prefetchLevels;
+
+        if (descendant <= count) {
+            const char* pDescendants = pBase + (descendant - 1)*stride;
+            size_t offset;
+
+            for (offset = 0; offset < prefetchBytes; offset += 64) {
+                NS_PREFETCH(pDescendants + offset);
+            }
+            NS_PREFETCH(pDescendants + prefetchBytes - 1);
+        }
+
+        k = 2*k + (compareProc(pUserData, pKey, pBase + (k - 1)*stride) > 0);
+    }
+
+    {
+        int exists = k <= count;
+        int goRight = compareProc(pUserData, pKey, pBase + ((exists ? k : 1) - 1)*stride) > 0;
+        k = 2*k + (size_t)(goRight || !exists);
+    }
+
+    /*
+    Every right turn in the path was to get past an element less than the key. The lower bound is the last node where we went
+    left, which is found by dropping the trailing right turns, and then the left turn itself. If there are none, every element
+    is less than the key.
+    */
+    while ((k & 1) != 0) {
+        k >>= 1;
+    }
+    k >>= 1;
+
+    if (k == 0) {
+        return NULL;
+    }
+
+    if (pSortedIndex != NULL) {
+        *pSortedIndex = ns_eytzinger_to_sorted_index(k, count);
+    }
+
+    if (compareProc(pUserData, pKey, pBase + (k - 1)*stride) == 0) {
+        return (void*)(pBase + (k - 1)*stride);
+    }
+
+    return NULL;
+}
+/* END eytzinger.c */
+
+/* BEG search_simd.c */
+/*
+Shared by the SIMD search kernels. SSE2 is assumed on x86/64, and AVX2 is detected at runtime. Define NS_NO_SIMD to force the
+scalar paths, or NS_NO_AVX2 to disable only the AVX2 paths.
+*/
+#if !defined(NS_NO_SIMD) && (defined(__x86_64__) || defined(_M_X64) || ((defined(__i386__) || defined(_M_IX86)) && (defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))))
+    #define NS_SEARCH_SSE2
+    #include <emmintrin.h>
+
+    #if !defined(NS_NO_AVX2) && ((defined(_MSC_VER) && _MSC_VER >= 1700) || defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+        #define NS_SEARCH_AVX2
+        #include <immintrin.h>
+
+        #if defined(_MSC_VER)
+            #include <intrin.h>
+            #define NS_SEARCH_TARGET_AVX2
+        #else
+            #define NS_SEARCH_TARGET_AVX2 __attribute__((target("avx2")))
+        #endif
+    #endif
+#endif
+
+#if defined(NS_SEARCH_AVX2)
+static void ns_search_cpuid(int info[4], int function)
+{
+#if defined(_MSC_VER)
+    __cpuidex(info, function, 0);
+#elif defined(__i386__) && defined(__PIC__)
+    /* ebx is reserved for the GOT pointer with -fPIC so save and restore it manually. */
+    __asm__ __volatile__ (
+        "xchg{l} {%%}ebx, %k1;"
+        "cpuid;"
+        "xchg{l} {%%}ebx, %k1;"
+        : "=a"(info[0]), "=&r"(info[1]), "=c"(info[2]), "=d"(info[3]) : "a"(function), "c"(0)
+    );
+#else
+    __asm__ __volatile__ (
+        "cpuid" : "=a"(info[0]), "=b"(info[1]), "=c"(info[2]), "=d"(info[3]) : "a"(function), "c"(0)
+    );
+#endif
+}
+
+static ns_uint64 ns_search_xgetbv(void)
+{
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    unsigned int lo;
+    unsigned int hi;
+
+    __asm__ __volatile__ (".byte 0x0f, 0x01, 0xd0" : "=a"(lo), "=d"(hi) : "c"(0));   /* xgetbv. Not all assemblers know the mnemonic. */
+    return ((ns_uint64)hi << 32) | lo;
+#endif
+}
+
+/* The result is cached. It's the same on every thread so the race on initialization is harmless. */
+static int ns_search_has_avx2(void)
+{
+    static int s_hasAVX2 = -1;
+
+    if (s_hasAVX2 < 0) {
+        int info[4];
+        int hasAVX2 = 0;
+
+        ns_search_cpuid(info, 0);
+        if (info[0] >= 7) {
+            ns_search_cpuid(info, 1);
+
+            /* The OS needs to be saving the YMM registers, otherwise AVX can't be used even if the CPU supports it. */
+            if ((info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (ns_search_xgetbv() & 6) == 6) {
+                ns_search_cpuid(info, 7);
+                hasAVX2 = (info[1] & (1 << 5)) != 0;
+            }
+        }
+
+        s_hasAVX2 = hasAVX2;
+    }
+
+    return s_hasAVX2;
+}
+#endif
+/* END search_simd.c */
+
+/* BEG static_btree.c */
+/*
+A static B+ tree over a sorted array of ns_uint32 or ns_uint64 keys, sometimes called an S+ tree. Every node is exactly one cache
+line and holds 16 ns_uint32 keys or 8 ns_uint64 keys. The leaves are the sorted keys themselves, padded out to a whole node with
+the largest key, and each node in the layer above holds, for each of its children bar the first, the smallest key under that
+child. So a node has one more child than it has keys. The layers are stored from the root down in a single aligned allocation.
+
+A binary search over 100M keys touches 27 elements, and all but the first few are cache misses. Here a search loads one line per
+layer, which is 7 for 100M ns_uint32 keys, and the first couple of layers are small enough to stay in cache. Within a node there's
+no searching at all. The keys are compared against the search key all at once with SIMD and the number of them that are less
+than the search key, found with a movemask and a popcount, is both the child to go down to and, at the leaf, the position in the
+sorted array. There are no branches that depend on the key.
+
+The tree is a copy of the keys. The original array isn't needed once the tree is built, and the indices returned by
+ns_static_btree_lower_bound_*() and ns_static_btree_find_*() are positions in that array. Both return count when there's no
+result. Keys are stored with their sign bit flipped so they can be compared with signed compares, which is all SSE2 and AVX2
+have.
+
+ns_uint32 nodes use SSE2 on x86/64, or AVX2 when it's detected at runtime. ns_uint64 nodes need AVX2 for the 64-bit compare,
+and fall back to a scalar loop without it. Everything else uses the scalar loop. Define NS_NO_SIMD to force the scalar path,
+or NS_NO_AVX2 to disable only the AVX2 path.
+*/
+#define NS_STATIC_BTREE_NODE_SIZE   64
+
+#if defined(NS_SEARCH_SSE2)
+static NS_INLINE size_t ns_static_btree_popcount(unsigned int x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (size_t)__builtin_popcount(x);
+#else
+    x = x - ((x >> 1) & 0x55555555);
+    x = (x & 0x33333333) + ((x >> 2) & 0x33333333);
+    x = (x + (x >> 4)) & 0x0F0F0F0F;
+    return (size_t)((x * 0x01010101) >> 24);
+#endif
+}
+#endif
+
+static NS_INLINE ns_int32 ns_static_btree_flip_u32(ns_uint32 key)
+{
+    return (ns_int32)(key ^ 0x80000000);
+}
+
+static NS_INLINE ns_int64 ns_static_btree_flip_u64(ns_uint64 key)
+{
+    return (ns_int64)(key ^ ((ns_uint64)0x80000000 << 32));
+}
+
+/* Each of these returns the number of keys in the node that are less than the key. */
+#if !defined(NS_SEARCH_SSE2)
+static NS_INLINE size_t ns_static_btree_rank_u32_scalar(const ns_int32* pNode, ns_int32 key)
+{
+    size_t rank = 0;
+    size_t i;
+
+    for (i = 0; i < 16; i += 1) {
+        rank += (size_t)(pNode[i] < key);
+    }
+
+    return rank;
+}
+#endif
+
+static NS_INLINE size_t ns_static_btree_rank_u64_scalar(const ns_int64* pNode, ns_int64 key)
+{
+    size_t rank = 0;
+    size_t i;
+
+    for (i = 0; i < 8; i += 1) {
+        rank += (size_t)(pNode[i] < key);
+    }
+
+    return rank;
+}
+
+#if defined(NS_SEARCH_SSE2)
+static NS_INLINE size_t ns_static_btree_rank_u32_sse2(const ns_int32* pNode, __m128i key)
+{
+    __m128i lt0 = _mm_cmpgt_epi32(key, _mm_load_si128((const __m128i*)pNode + 0));
+    __m128i lt1 = _mm_cmpgt_epi32(key, _mm_load_si128((const __m128i*)pNode + 1));
+    __m128i lt2 = _mm_cmpgt_epi32(key, _mm_load_si128((const __m128i*)pNode + 2));
+    __m128i lt3 = _mm_cmpgt_epi32(key, _mm_load_si128((const __m128i*)pNode + 3));
+    __m128i lt  = _mm_packs_epi16(_mm_packs_epi32(lt0, lt1), _mm_packs_epi32(lt2, lt3));
+
+    return ns_static_btree_popcount((unsigned int)_mm_movemask_epi8(lt));
+}
+#endif
+
+#if defined(NS_SEARCH_AVX2)
+NS_SEARCH_TARGET_AVX2
+static size_t ns_static_btree_lower_bound_u32_avx2(const ns_static_btree* pTree, ns_int32 key)
+{
+    const ns_int32* pNodes = (const ns_int32*)pTree->pNodes;
+    __m256i key8 = _mm256_set1_epi32(key);
+    size_t k = 0;
+    size_t layer;
+
+    for (layer = pTree->layerCount; layer > 0; layer -= 1) {
+        const ns_int32* pNode = pNodes + (pTree->layerOffsets[layer - 1] + k)*16;
+        __m256i lt0 = _mm256_cmpgt_epi32(key8, _mm256_load_si256((const __m256i*)pNode + 0));
+        __m256i lt1 = _mm256_cmpgt_epi32(key8, _mm256_load_si256((const __m256i*)pNode + 1));
+        unsigned int mask = (unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(lt0)) | ((unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(lt1)) << 8);
+
+        k = k*((layer > 1) ? 17 : 16) + ns_static_btree_popcount(mask);
+    }
+
+    return k;
+}
+
+NS_SEARCH_TARGET_AVX2
+static size_t ns_static_btree_lower_bound_u64_avx2(const ns_static_btree* pTree, ns_int64 key)
+{
+    const ns_int64* pNodes = (const ns_int64*)pTree->pNodes;
+    __m256i key4 = _mm256_set1_epi64x(key);
+    size_t k = 0;
+    size_t layer;
+
+    for (layer = pTree->layerCount; layer > 0; layer -= 1) {
+        const ns_int64* pNode = pNodes + (pTree->layerOffsets[layer - 1] + k)*8;
+        __m256i lt0 = _mm256_cmpgt_epi64(key4, _mm256_load_si256((const __m256i*)pNode + 0));
+        __m256i lt1 = _mm256_cmpgt_epi64(key4, _mm256_load_si256((const __m256i*)pNode + 1));
+        unsigned int mask = (unsigned int)_mm256_movemask_pd(_mm256_castsi256_pd(lt0)) | ((unsigned int)_mm256_movemask_pd(_mm256_castsi256_pd(lt1)) << 4);
+
+        k = k*((layer > 1) ? 9 : 8) + ns_static_btree_popcount(mask);
+    }
+
+    return k;
+}
+#endif
+
+/*
+Builds the layers. keysPerNode is 16 or 8 depending on the key size. The separators in the internal layers are the first key of
+the leftmost leaf under each child, or the padding key if the child doesn't exist.
+*/
+static ns_result ns_static_btree_init_internal(const void* pSortedKeys, size_t count, size_t keySize, const ns_allocation_callbacks* pAllocationCallbacks, ns_static_btree* pTree)
+{
+    size_t keysPerNode = NS_STATIC_BTREE_NODE_SIZE / keySize;
+    size_t layerSizes[NS_STATIC_BTREE_MAX_LAYERS];
+    size_t leafCount;
+    size_t nodeCount;
+    size_t layer;
+
+    if (pTree == NULL) {
+        return NS_INVALID_ARGS;
+    }
+
+    NS_ZERO_MEMORY(pTree, sizeof(*pTree));
+    pTree->count   = count;
+    pTree->keySize = keySize;
+    pTree->allocationCallbacks = ns_allocation_callbacks_init_copy(pAllocationCallbacks);
+
+    if (count == 0) {
+        return NS_SUCCESS;
+    }
+
+    if (pSortedKeys == NULL) {
+        return NS_INVALID_ARGS;
+    }
+
+    /* Leaves first. Every layer above has one node per keysPerNode + 1 nodes below it until there's only the root. */
+    leafCount = (count / keysPerNode) + ((count % keysPerNode) != 0);
+    layerSizes[0] = leafCount;
+    pTree->layerCount = 1;
+
+    while (layerSizes[pTree->layerCount - 1] > 1) {
+        size_t below = layerSizes[pTree->layerCount - 1];
+        layerSizes[pTree->layerCount] = (below / (keysPerNode + 1)) + ((below % (keysPerNode + 1)) != 0);
+        pTree->layerCount += 1;
+    }
+
+    /* The root goes first so the top of the tree is packed together at the start. */
+    nodeCount = 0;
+    for (layer = pTree->layerCount; layer > 0; layer -= 1) {
+        pTree->layerOffsets[layer - 1] = nodeCount;
+        nodeCount += layerSizes[layer - 1];
+    }
+
+    if (nodeCount > NS_SIZE_MAX / NS_STATIC_BTREE_NODE_SIZE) {
+        return NS_OUT_OF_MEMORY;
+    }
+
+    pTree->pNodes = ns_aligned_malloc(nodeCount * NS_STATIC_BTREE_NODE_SIZE, NS_STATIC_BTREE_NODE_SIZE, &pTree->allocationCallbacks);
+    if (pTree->pNodes == NULL) {
+        return NS_OUT_OF_MEMORY;
+    }
+
+    for (layer = 0; layer < pTree->layerCount; layer += 1) {
+        size_t iNode;
+
+        for (iNode = 0; iNode < layerSizes[layer]; iNode += 1) {
+            size_t iKey;
+
+            for (iKey = 0; iKey < keysPerNode; iKey += 1) {
+                size_t sortedIndex;
+                size_t iKeyInNode = (pTree->layerOffsets[layer] + iNode)*keysPerNode + iKey;
+
+                if (layer == 0) {
+                    sortedIndex = iNode*keysPerNode + iKey;
+                } else {
+                    /* Walk down the leftmost edge of child iKey + 1. */
+                    size_t leaf = iNode*(keysPerNode + 1) + iKey + 1;
+                    size_t below;
+
+                    for (below = layer - 1; below > 0 && leaf < leafCount; below -= 1) {
+                        leaf *= keysPerNode + 1;
+                    }
+
+                    sortedIndex = (leaf < leafCount) ? leaf*keysPerNode : count;
+                }
+
+                if (keySize == 4) {
+                    ((ns_int32*)pTree->pNodes)[iKeyInNode] = ns_static_btree_flip_u32((sortedIndex < count) ? ((const ns_uint32*)pSortedKeys)[sortedIndex] : NS_UINT32_MAX);
+                } else {
+                    ((ns_int64*)pTree->pNodes)[iKeyInNode] = ns_static_btree_flip_u64((sortedIndex < count) ? ((const ns_uint64*)pSortedKeys)[sortedIndex] : NS_UINT64_MAX);
+                }
+            }
+        }
+    }
+
+    return NS_SUCCESS;
+}
+
+NS_API ns_result ns_static_btree_init_u32(const ns_uint32* pSortedKeys, size_t count, const ns_allocation_callbacks* pAllocationCallbacks, ns_static_btree* pTree)
+{
+    return ns_static_btree_init_internal(pSortedKeys, count, sizeof(ns_uint32), pAllocationCallbacks, pTree);
+}
+
+NS_API ns_result ns_static_btree_init_u64(const ns_uint64* pSortedKeys, size_t count, const ns_allocation_callbacks* pAllocationCallbacks, ns_static_btree* pTree)
+{
+    return ns_static_btree_init_internal(pSortedKeys, count, sizeof(ns_uint64), pAllocationCallbacks, pTree);
+}
+
+NS_API void ns_static_btree_uninit(ns_static_btree* pTree)
+{
+    if (pTree == NULL) {
+        return;
+    }
+
+    ns_aligned_free(pTree->pNodes, &pTree->allocationCallbacks);
+    pTree->pNodes = NULL;
+}
+
+/*
+At each internal node the rank is the child to go down to, and at the leaf it's the position within the leaf. Because the leaves
+are the sorted array, the leaf's node index times the keys per node plus the rank is the lower bound. The padding keys are never
+less than the search key so this is never more than count.
+*/
+NS_API size_t ns_static_btree_lower_bound_u32(const ns_static_btree* pTree, ns_uint32 key)
+{
+    const ns_int32* pNodes;
+    ns_int32 flippedKey = ns_static_btree_flip_u32(key);
+    size_t k = 0;
+    size_t layer;
+
+    if (pTree == NULL || pTree->pNodes == NULL || pTree->keySize != sizeof(ns_uint32)) {
+        return 0;
+    }
+
+#if defined(NS_SEARCH_AVX2)
+    if (ns_search_has_avx2()) {
+        return ns_static_btree_lower_bound_u32_avx2(pTree, flippedKey);
+    }
+#endif
+
+    pNodes = (const ns_int32*)pTree->pNodes;
+
+#if defined(NS_SEARCH_SSE2)
+    {
+        __m128i key4 = _mm_set1_epi32(flippedKey);
+
+        for (layer = pTree->layerCount; layer > 0; layer -= 1) {
+            k = k*((layer > 1) ? 17 : 16) + ns_static_btree_rank_u32_sse2(pNodes + (pTree->layerOffsets[layer - 1] + k)*16, key4);
+        }
+    }
+#else
+    for (layer = pTree->layerCount; layer > 0; layer -= 1) {
+        k = k*((layer > 1) ? 17 : 16) + ns_static_btree_rank_u32_scalar(pNodes + (pTree->layerOffsets[layer - 1] + k)*16, flippedKey);
+    }
+#endif
+
+    return k;
+}
+
+NS_API size_t ns_static_btree_lower_bound_u64(const ns_static_btree* pTree, ns_uint64 key)
+{
+    const ns_int64* pNodes;
+    ns_int64 flippedKey = ns_static_btree_flip_u64(key);
+    size_t k = 0;
+    size_t layer;
+
+    if (pTree == NULL || pTree->pNodes == NULL || pTree->keySize != sizeof(ns_uint64)) {
+        return 0;
+    }
+
+#if defined(NS_SEARCH_AVX2)
+    if (ns_search_has_avx2()) {
+        return ns_static_btree_lower_bound_u64_avx2(pTree, flippedKey);
+    }
+#endif
+
+    pNodes = (const ns_int64*)pTree->pNodes;
+
+    for (layer = pTree->layerCount; layer > 0; layer -= 1) {
+        k = k*((layer > 1) ? 9 : 8) + ns_static_btree_rank_u64_scalar(pNodes + (pTree->layerOffsets[layer - 1] + k)*8, flippedKey);
+    }
+
+    return k;
+}
+
+NS_API size_t ns_static_btree_find_u32(const ns_static_btree* pTree, ns_uint32 key)
+{
+    size_t index;
+
+    if (pTree == NULL) {
+        return 0;
+    }
+
+    index = ns_static_btree_lower_bound_u32(pTree, key);
+    if (index < pTree->count && pTree->keySize == sizeof(ns_uint32) && ((const ns_int32*)pTree->pNodes)[pTree->layerOffsets[0]*16 + index] == ns_static_btree_flip_u32(key)) {
+        return index;
+    }
+
+    return pTree->count;
+}
+
+NS_API size_t ns_static_btree_find_u64(const ns_static_btree* pTree, ns_uint64 key)
+{
+    size_t index;
+
+    if (pTree == NULL) {
+        return 0;
+    }
+
+    index = ns_static_btree_lower_bound_u64(pTree, key);
+    if (index < pTree->count && pTree->keySize == sizeof(ns_uint64) && ((const ns_int64*)pTree->pNodes)[pTree->layerOffsets[0]*8 + index] == ns_static_btree_flip_u64(key)) {
+        return index;
+    }
+
+    return pTree->count;
+}
+/* END static_btree.c */
+
+/* BEG static_hash_index.c */
+/*
+An exact match index for tables that are built once and never change, using a minimal perfect hash. Every element gets its own
+slot, with no empty slots and no collisions, so a lookup is one hash, one read of the slot and one comparison, no matter how big
+the table is. pList isn't reordered. The slots hold indices into it, so the index can sit alongside whatever else uses the table.
+
+The construction is the hash and displace scheme from CHD and PTHash. Elements are hashed into buckets of about
+NS_STATIC_HASH_INDEX_BUCKET_SIZE elements each. The buckets are then placed from the largest to the smallest. For each bucket a
+pilot value is searched for that, mixed into the hash of each of its elements, sends them all to free slots. The pilot is stored
+per bucket. Placing the big buckets while the table is still empty and the single element buckets at the end is what makes it
+possible to fill every slot. Finding a home for the last few takes a lot of tries, so building costs a few hundred nanoseconds
+per element for small tables, growing to a couple of microseconds at ten million. The index itself is 4 bytes per element for the
+slots plus 4 bytes per bucket for the pilots, so about 5 bytes per element.
+
+hashProc is called with elements when building and with keys when looking up, and must return the same hash for a key as for the
+element it matches. The elements must be unique, and hashProc can't give two different elements the same 64-bit hash, since
+nothing could tell them apart. Either one makes ns_static_hash_index_init() return NS_ALREADY_EXISTS. The count is limited to
+what fits in 32 bits.
+
+ns_static_hash_index_find() returns a pointer to the element equal to pKey, or NULL. A key that isn't in the table still lands
+on a slot, which is why the comparison is needed.
+
+ns_static_hash_index_serialize() writes the index to a flat buffer of ns_static_hash_index_get_serialized_size() bytes, in the
+byte order of the machine. ns_static_hash_index_init_from_buffer() initializes an index that reads directly from such a buffer
+without copying it, so the buffer, which must be aligned to 8 bytes, needs to outlive the index. The table and callbacks aren't
+part of the buffer and need to be given again. Every slot is checked to be in range, which is a pass over the slots, so a corrupt
+buffer gives NS_INVALID_FILE rather than reads out of bounds. It can still give wrong answers, as a misplaced element just won't be
+found.
+*/
+#define NS_STATIC_HASH_INDEX_BUCKET_SIZE    4
+#define NS_STATIC_HASH_INDEX_MAGIC          0x4948534E  /* "NSHI" */
+#define NS_STATIC_HASH_INDEX_VERSION        1
+#define NS_STATIC_HASH_INDEX_EMPTY          0xFFFFFFFF
+
+typedef struct
+{
+    ns_uint32 magic;
+    ns_uint32 version;
+    ns_uint64 count;
+    ns_uint64 bucketCount;
+    ns_uint64 seed;
+} ns_static_hash_index_header;
+
+static NS_INLINE ns_uint64 ns_static_hash_index_mix(ns_uint64 x)
+{
+    /* The splitmix64 finalizer. */
+    x ^= x >> 30;
+    x *= ((ns_uint64)0xBF58476D << 32) | 0x1CE4E5B9;
+    x ^= x >> 27;
+    x *= ((ns_uint64)0x94D049BB << 32) | 0x133111EB;
+    x ^= x >> 31;
+    return x;
+}
+
+static NS_INLINE size_t ns_static_hash_index_bucket(ns_uint64 hash, size_t bucketCount)
+{
+    return (size_t)((hash >> 32) % bucketCount);
+}
+
+static NS_INLINE size_t ns_static_hash_index_slot(ns_uint64 hash, ns_uint32 pilot, size_t count)
+{
+    /* Mixed after the pilot goes in, otherwise two hashes with the same low bits would collide for every pilot with some counts. */
+    return (size_t)(ns_static_hash_index_mix(hash ^ pilot) % count);
+}
+
+/*
+Does one attempt at placing every bucket with the given seed. Returns NS_OUT_OF_RANGE if a bucket couldn't be placed in a
+reasonable number of tries, in which case it's worth trying again with a different seed.
+*/
+static ns_result ns_static_hash_index_place(const ns_uint64* pHashes, size_t count, size_t bucketCount, const size_t* pBucketStarts, const ns_uint32* pBucketElements, const ns_uint32* pBucketOrder, size_t* pPositions, ns_uint32* pPilots, ns_uint32* pSlots)
+{
+    ns_uint64 maxPilot = (ns_uint64)count * 16 + 65536;  /* The last bucket has one free slot and needs count tries on average. */
+    size_t iOrder;
+    size_t i;
+
+    for (i = 0; i < count; i += 1) {
+        pSlots[i] = NS_STATIC_HASH_INDEX_EMPTY;
+    }
+
+    for (iOrder = 0; iOrder < bucketCount; iOrder += 1) {
+        size_t bucket = pBucketOrder[iOrder];
+        size_t bucketSize = pBucketStarts[bucket + 1] - pBucketStarts[bucket];
+        const ns_uint32* pElements = pBucketElements + pBucketStarts[bucket];
+        ns_uint64 pilot;
+
+        if (bucketSize == 0) {
+            pPilots[bucket] = 0;
+            continue;
+        }
+
+        for (pilot = 0; pilot < maxPilot && pilot < NS_STATIC_HASH_INDEX_EMPTY; pilot += 1) {
+            size_t iElement;
+
+            for (iElement = 0; iElement < bucketSize; iElement += 1) {
+                size_t slot = ns_static_hash_index_slot(pHashes[pElements[iElement]], (ns_uint32)pilot, count);
+                size_t iOther;
+
+                if (pSlots[slot] != NS_STATIC_HASH_INDEX_EMPTY) {
+                    break;
+                }
+
+                for (iOther = 0; iOther < iElement; iOther += 1) {
+                    if (pPositions[iOther] == slot) {
+                        break;
+                    }
+                }
+
+                if (iOther < iElement) {
+                    break;
+                }
+
+                pPositions[iElement] = slot;
+            }
+
+            if (iElement == bucketSize) {
+                break;
+            }
+        }
+
+        if (pilot == maxPilot || pilot == NS_STATIC_HASH_INDEX_EMPTY) {
+            return NS_OUT_OF_RANGE;
+        }
+
+        pPilots[bucket] = (ns_uint32)pilot;
+        for (i = 0; i < bucketSize; i += 1) {
+            pSlots[pPositions[i]] = pElements[i];
+        }
+    }
+
+    return NS_SUCCESS;
+}
+
+static int ns_static_hash_index_compare_u64(const void* a, const void* b)
+{
+    ns_uint64 x = *(const ns_uint64*)a;
+    ns_uint64 y = *(const ns_uint64*)b;
+
+    return (x > y) - (x < y);
+}
+
+NS_API ns_result ns_static_hash_index_init(const void* pList, size_t count, size_t stride, ns_uint64 (*hashProc)(void*, const void*), int (*compareProc)(void*, const void*, const void*), void* pUserData, const ns_allocation_callbacks* pAllocationCallbacks, ns_static_hash_index* pIndex)
+{
+    ns_result result = NS_OUT_OF_MEMORY;
+    ns_uint64* pRawHashes = NULL;
+    ns_uint64* pHashes = NULL;
+    size_t* pBucketStarts = NULL;
+    ns_uint32* pBucketElements = NULL;
+    ns_uint32* pBucketOrder = NULL;
+    size_t* pPositions = NULL;
+    size_t* pSizeCounts = NULL;
+    size_t maxBucketSize = 0;
+    size_t bucketCount;
+    size_t attempt;
+    size_t i;
+
+    if (pIndex == NULL) {
+        return NS_INVALID_ARGS;
+    }
+
+    NS_ZERO_MEMORY(pIndex, sizeof(*pIndex));
+
+    if ((pList == NULL && count > 0) || stride == 0 || hashProc == NULL || compareProc == NULL) {
+        return NS_INVALID_ARGS;
+    }
+
+    if (count >= NS_STATIC_HASH_INDEX_EMPTY) {
+        return NS_TOO_BIG;
+    }
+
+    bucketCount = (count + NS_STATIC_HASH_INDEX_BUCKET_SIZE - 1) / NS_STATIC_HASH_INDEX_BUCKET_SIZE;
+
+    pIndex->pList       = pList;
+    pIndex->count       = count;
+    pIndex->stride      = stride;
+    pIndex->hashProc    = hashProc;
+    pIndex->compareProc = compareProc;
+    pIndex->pUserData   = pUserData;
+    pIndex->bucketCount = bucketCount;
+    pIndex->allocationCallbacks = ns_allocation_callbacks_init_copy(pAllocationCallbacks);
+
+    if (count == 0) {
+        return NS_SUCCESS;
+    }
+
+    /* The pilots and slots go in one allocation which is what's kept. Everything else is only needed while building. */
+    pIndex->pAllocation = ns_malloc((bucketCount + count) * sizeof(ns_uint32), &pIndex->allocationCallbacks);
+    pRawHashes      = (ns_uint64*)ns_malloc(count * sizeof(*pRawHashes), &pIndex->allocationCallbacks);
+    pHashes         = (ns_uint64*)ns_malloc(count * sizeof(*pHashes), &pIndex->allocationCallbacks);
+    pBucketStarts   = (size_t*)ns_malloc((bucketCount + 1) * sizeof(*pBucketStarts), &pIndex->allocationCallbacks);
+    pBucketElements = (ns_uint32*)ns_malloc(count * sizeof(*pBucketElements), &pIndex->allocationCallbacks);
+    pBucketOrder    = (ns_uint32*)ns_malloc(bucketCount * sizeof(*pBucketOrder), &pIndex->allocationCallbacks);
+    if (pIndex->pAllocation == NULL || pRawHashes == NULL || pHashes == NULL || pBucketStarts == NULL || pBucketElements == NULL || pBucketOrder == NULL) {
+        goto done;
+    }
+
+    pIndex->pPilots = (const ns_uint32*)pIndex->pAllocation;
+    pIndex->pSlots  = (const ns_uint32*)pIndex->pAllocation + bucketCount;
+
+    for (i = 0; i < count; i += 1) {
+        pRawHashes[i] = hashProc(pUserData, (const char*)pList + i*stride);
+    }
+
+    /* Elements with the same hash can never be separated, whatever the seed. */
+    NS_COPY_MEMORY(pHashes, pRawHashes, count * sizeof(*pHashes));
+    qsort(pHashes, count, sizeof(*pHashes), ns_static_hash_index_compare_u64);
+    for (i = 1; i < count; i += 1) {
+        if (pHashes[i] == pHashes[i - 1]) {
+            result = NS_ALREADY_EXISTS;
+            goto done;
+        }
+    }
+
+    for (attempt = 0; attempt < 16; attempt += 1) {
+        size_t bucket;
+        size_t size;
+
+        pIndex->seed = ns_static_hash_index_mix(attempt + 1);
+
+        for (i = 0; i < count; i += 1) {
+            pHashes[i] = ns_static_hash_index_mix(pRawHashes[i] ^ pIndex->seed);
+        }
+
+        /* A counting sort of the elements by bucket. */
+        NS_ZERO_MEMORY(pBucketStarts, (bucketCount + 1) * sizeof(*pBucketStarts));
+        for (i = 0; i < count; i += 1) {
+            pBucketStarts[ns_static_hash_index_bucket(pHashes[i], bucketCount) + 1] += 1;
+        }
+
+        maxBucketSize = 0;
+        for (bucket = 0; bucket < bucketCount; bucket += 1) {
+            if (pBucketStarts[bucket + 1] > maxBucketSize) {
+                maxBucketSize = pBucketStarts[bucket + 1];
+            }
+
+            pBucketStarts[bucket + 1] += pBucketStarts[bucket];
+        }
+
+        for (i = 0; i < count; i += 1) {
+            bucket = ns_static_hash_index_bucket(pHashes[i], bucketCount);
+            pBucketElements[pBucketStarts[bucket]] = (ns_uint32)i;
+            pBucketStarts[bucket] += 1;
+        }
+
+        for (bucket = bucketCount; bucket > 0; bucket -= 1) {
+            pBucketStarts[bucket] = pBucketStarts[bucket - 1];
+        }
+        pBucketStarts[0] = 0;
+
+        /* And another of the buckets by size, largest first. */
+        ns_free(pPositions, &pIndex->allocationCallbacks);
+        ns_free(pSizeCounts, &pIndex->allocationCallbacks);
+        pPositions  = (size_t*)ns_malloc(maxBucketSize * sizeof(*pPositions), &pIndex->allocationCallbacks);
+        pSizeCounts = (size_t*)ns_calloc((maxBucketSize + 1) * sizeof(*pSizeCounts), &pIndex->allocationCallbacks);
+        if (pPositions == NULL || pSizeCounts == NULL) {
+            result = NS_OUT_OF_MEMORY;
+            goto done;
+        }
+
+        for (bucket = 0; bucket < bucketCount; bucket += 1) {
+            pSizeCounts[pBucketStarts[bucket + 1] - pBucketStarts[bucket]] += 1;
+        }
+
+        for (size = maxBucketSize, i = 0; size + 1 > 0; size -= 1) {
+            size_t sizeCount = pSizeCounts[size];
+            pSizeCounts[size] = i;
+            i += sizeCount;
+
+            if (size == 0) {
+                break;
+            }
+        }
+
+        for (bucket = 0; bucket < bucketCount; bucket += 1) {
+            size = pBucketStarts[bucket + 1] - pBucketStarts[bucket];
+            pBucketOrder[pSizeCounts[size]] = (ns_uint32)bucket;
+            pSizeCounts[size] += 1;
+        }
+
+        result = ns_static_hash_index_place(pHashes, count, bucketCount, pBucketStarts, pBucketElements, pBucketOrder, pPositions, (ns_uint32*)pIndex->pPilots, (ns_uint32*)pIndex->pSlots);
+        if (result != NS_OUT_OF_RANGE) {
+            break;
+        }
+    }
+
+done:
+    ns_free(pRawHashes, &pIndex->allocationCallbacks);
+    ns_free(pHashes, &pIndex->allocationCallbacks);
+    ns_free(pBucketStarts, &pIndex->allocationCallbacks);
+    ns_free(pBucketElements, &pIndex->allocationCallbacks);
+    ns_free(pBucketOrder, &pIndex->allocationCallbacks);
+    ns_free(pPositions, &pIndex->allocationCallbacks);
+    ns_free(pSizeCounts, &pIndex->allocationCallbacks);
+
+    if (result != NS_SUCCESS) {
+        ns_free(pIndex->pAllocation, &pIndex->allocationCallbacks);
+        pIndex->pAllocation = NULL;
+        pIndex->pPilots     = NULL;
+        pIndex->pSlots      = NULL;
+    }
+
+    return result;
+}
+
+NS_API ns_result ns_static_hash_index_init_from_buffer(const void* pBuffer, size_t bufferSize, const void* pList, size_t count, size_t stride, ns_uint64 (*hashProc)(void*, const void*), int (*compareProc)(void*, const void*, const void*), void* pUserData, ns_static_hash_index* pIndex)
+{
+    ns_static_hash_index_header header;
+    size_t i;
+
+    if (pIndex == NULL) {
+        return NS_INVALID_ARGS;
+    }
+
+    NS_ZERO_MEMORY(pIndex, sizeof(*pIndex));
+
+    if (pBuffer == NULL || (pList == NULL && count > 0) || stride == 0 || hashProc == NULL || compareProc == NULL || ((ns_uintptr)pBuffer & 7) != 0) {
+        return NS_INVALID_ARGS;
+    }
+
+    if (bufferSize < sizeof(header)) {
+        return NS_INVALID_FILE;
+    }
+
+    NS_COPY_MEMORY(&header, pBuffer, sizeof(header));
+
+    if (header.magic != NS_STATIC_HASH_INDEX_MAGIC || header.version != NS_STATIC_HASH_INDEX_VERSION || header.count != count || header.bucketCount != (count + NS_STATIC_HASH_INDEX_BUCKET_SIZE - 1) / NS_STATIC_HASH_INDEX_BUCKET_SIZE) {
+        return NS_INVALID_FILE;
+    }
+
+    if (bufferSize - sizeof(header) < (size_t)(header.bucketCount + header.count) * sizeof(ns_uint32)) {
+        return NS_INVALID_FILE;
+    }
+
+    pIndex->pList       = pList;
+    pIndex->count       = count;
+    pIndex->stride      = stride;
+    pIndex->hashProc    = hashProc;
+    pIndex->compareProc = compareProc;
+    pIndex->pUserData   = pUserData;
+    pIndex->seed        = header.seed;
+    pIndex->bucketCount = (size_t)header.bucketCount;
+    pIndex->pPilots     = (const ns_uint32*)((const char*)pBuffer + sizeof(header));
+    pIndex->pSlots      = pIndex->pPilots + pIndex->bucketCount;
+
+    /* A slot out of range would have ns_static_hash_index_find() read past the end of pList. Any pilot is safe. */
+    for (i = 0; i < count; i += 1) {
+        if (pIndex->pSlots[i] >= count) {
+            NS_ZERO_MEMORY(pIndex, sizeof(*pIndex));
+            return NS_INVALID_FILE;
+        }
+    }
+
+    return NS_SUCCESS;
+}
+
+NS_API void ns_static_hash_index_uninit(ns_static_hash_index* pIndex)
+{
+    if (pIndex == NULL) {
+        return;
+    }
+
+    ns_free(pIndex->pAllocation, &pIndex->allocationCallbacks);
+    pIndex->pAllocation = NULL;
+    pIndex->pPilots     = NULL;
+    pIndex->pSlots      = NULL;
+}
+
+NS_API void* ns_static_hash_index_find(const ns_static_hash_index* pIndex, const void* pKey)
+{
+    ns_uint64 hash;
+    const char* pElement;
+
+    if (pIndex == NULL || pIndex->count == 0 || pIndex->pSlots == NULL) {
+        return NULL;
+    }
+
+    hash = ns_static_hash_index_mix(pIndex->hashProc(pIndex->pUserData, pKey) ^ pIndex->seed);
+    pElement = (const char*)pIndex->pList + pIndex->pSlots[ns_static_hash_index_slot(hash, pIndex->pPilots[ns_static_hash_index_bucket(hash, pIndex->bucketCount)], pIndex->count)] * pIndex->stride;
+
+    if (pIndex->compareProc(pIndex->pUserData, pKey, pElement) == 0) {
+        return (void*)pElement;
+    }
+
+    return NULL;
+}
+
+NS_API size_t ns_static_hash_index_get_serialized_size(const ns_static_hash_index* pIndex)
+{
+    if (pIndex == NULL) {
+        return 0;
+    }
+
+    return sizeof(ns_static_hash_index_header) + (pIndex->bucketCount + pIndex->count) * sizeof(ns_uint32);
+}
+
+NS_API ns_result ns_static_hash_index_serialize(const ns_static_hash_index* pIndex, void* pBuffer, size_t bufferSize)
+{
+    ns_static_hash_index_header header;
+
+    if (pIndex == NULL || pBuffer == NULL) {
+        return NS_INVALID_ARGS;
+    }
+
+    if (bufferSize < ns_static_hash_index_get_serialized_size(pIndex)) {
+        return NS_NO_SPACE;
+    }
+
+    header.magic       = NS_STATIC_HASH_INDEX_MAGIC;
+    header.version     = NS_STATIC_HASH_INDEX_VERSION;
+    header.count       = pIndex->count;
+    header.bucketCount = pIndex->bucketCount;
+    header.seed        = pIndex->seed;
+
+    NS_COPY_MEMORY(pBuffer, &header, sizeof(header));
+
+    if (pIndex->count > 0) {
+        NS_COPY_MEMORY((char*)pBuffer + sizeof(header), pIndex->pPilots, pIndex->bucketCount * sizeof(ns_uint32));
+        NS_COPY_MEMORY((char*)pBuffer + sizeof(header) + pIndex->bucketCount * sizeof(ns_uint32), pIndex->pSlots, pIndex->count * sizeof(ns_uint32));
+    }
+
+    return NS_SUCCESS;
+}
+/* END static_hash_index.c */
+
+/* BEG linear_search.c */
+NS_API void* ns_linear_search(const void* pKey, const void* pList, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData)
+{
+    size_t i;
+
+    for (i = 0; i < count; i+= 1) {
+        int compareResult = compareProc(pUserData, pKey, (char*)pList + (i * stride));
+        if (compareResult == 0) {
+            return (void*)((char*)pList + (i * stride));
+        }
+    }
+
+    return NULL;
+}
+
+/*
+Typed linear searches for unsorted or very small arrays of primitive types. These return the index of the first element that is
+equal to the key, or count if there isn't one. There's no function pointer call per element. Instead, 16 bytes at a time are
+compared with SSE2, or 32 with AVX2 when it's detected at runtime, and the loop is unrolled four times so the common case of no
+match in a block is one branch per 64 or 128 bytes. The position of the first match comes from the movemask of the comparison.
+Elements after the last full vector are compared one at a time.
+
+Floats are compared with ==, so -0.0 and +0.0 match each other and NaN never matches anything. SSE2 has no 64-bit equality
+compare so ns_uint64 compares the two 32-bit halves and requires both to match.
+
+These are for the cases where the element type is known. ns_linear_search() is the fallback for everything else.
+*/
+#if defined(NS_SEARCH_SSE2)
+static NS_INLINE size_t ns_linear_search_ctz(unsigned int mask)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (size_t)__builtin_ctz(mask);
+#else
+    size_t result = 0;
+
+    while ((mask & 1) == 0) {
+        mask >>= 1;
+        result += 1;
+    }
+
+    return result;
+#endif
+}
+#endif
+
+/*
+NS_LINEAR_SEARCH_DEFINE_SIMD generates a kernel for a given vector width. CMPEQ takes a pointer to the elements and the broadcast
+key and returns a byte mask, from movemask, of the bytes of the elements that are equal to the key, so the index of the first
+match is the number of trailing zeros divided by the element size.
+*/
+#define NS_LINEAR_SEARCH_DEFINE_SIMD(name, T, VECTOR, VECTOR_SIZE, SET1, CMPEQ, TARGET) \
+TARGET \
+static size_t name(const T* pList, size_t count, T key) \
+{ \
+    const size_t lanes = VECTOR_SIZE / sizeof(T); \
+    VECTOR keyVector = SET1(key); \
+    size_t i = 0; \
+\
+    for (; i + lanes*4 <= count; i += lanes*4) { \
+        unsigned int mask0 = CMPEQ(pList + i + lanes*0, keyVector); \
+        unsigned int mask1 = CMPEQ(pList + i + lanes*1, keyVector); \
+        unsigned int mask2 = CMPEQ(pList + i + lanes*2, keyVector); \
+        unsigned int mask3 = CMPEQ(pList + i + lanes*3, keyVector); \
+\
+        if ((mask0 | mask1 | mask2 | mask3) != 0) { \
+            if (mask0 != 0) { return i + lanes*0 + ns_linear_search_ctz(mask0) / sizeof(T); } \
+            if (mask1 != 0) { return i + lanes*1 + ns_linear_search_ctz(mask1) / sizeof(T); } \
+            if (mask2 != 0) { return i + lanes*2 + ns_linear_search_ctz(mask2) / sizeof(T); } \
+            return i + lanes*3 + ns_linear_search_ctz(mask3) / sizeof(T); \
+        } \
+    } \
+\
+    for (; i + lanes <= count; i += lanes) { \
+        unsigned int mask = CMPEQ(pList + i, keyVector); \
+        if (mask != 0) { \
+            return i + ns_linear_search_ctz(mask) / sizeof(T); \
+        } \
+    } \
+\
+    for (; i < count; i += 1) { \
+        if (pList[i] == key) { \
+            return i; \
+        } \
+    } \
+\
+    return count; \
+}
+
+#define NS_LINEAR_SEARCH_DEFINE_SCALAR(name, T) \
+static size_t name(const T* pList, size_t count, T key) \
+{ \
+    size_t i; \
+\
+    for (i = 0; i < count; i += 1) { \
+        if (pList[i] == key) { \
+            return i; \
+        } \
+    } \
+\
+    return count; \
+}
+
+#if defined(NS_SEARCH_SSE2)
+#define NS_LINEAR_SEARCH_SSE2_LOAD(p)   _mm_loadu_si128((const __m128i*)(p))
+#define NS_LINEAR_SEARCH_TARGET_SSE2    /* SSE2 is always enabled where it's used. */
+
+static NS_INLINE __m128i ns_linear_search_set1_u8_sse2 (ns_uint8  key) { return _mm_set1_epi8((char)key); }
+static NS_INLINE __m128i ns_linear_search_set1_u16_sse2(ns_uint16 key) { return _mm_set1_epi16((short)key); }
+static NS_INLINE __m128i ns_linear_search_set1_u32_sse2(ns_uint32 key) { return _mm_set1_epi32((int)key); }
+static NS_INLINE __m128i ns_linear_search_set1_u64_sse2(ns_uint64 key) { return _mm_set_epi32((int)(key >> 32), (int)key, (int)(key >> 32), (int)key); }
+static NS_INLINE __m128  ns_linear_search_set1_f32_sse2(float     key) { return _mm_set1_ps(key); }
+
+static NS_INLINE unsigned int ns_linear_search_cmpeq_u8_sse2(const ns_uint8* p, __m128i key)
+{
+    return (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(NS_LINEAR_SEARCH_SSE2_LOAD(p), key));
+}
+
+static NS_INLINE unsigned int ns_linear_search_cmpeq_u16_sse2(const ns_uint16* p, __m128i key)
+{
+    return (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi16(NS_LINEAR_SEARCH_SSE2_LOAD(p), key));
+}
+
+static NS_INLINE unsigned int ns_linear_search_cmpeq_u32_sse2(const ns_uint32* p, __m128i key)
+{
+    return (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi32(NS_LINEAR_SEARCH_SSE2_LOAD(p), key));
+}
+
+static NS_INLINE unsigned int ns_linear_search_cmpeq_u64_sse2(const ns_uint64* p, __m128i key)
+{
+    /* Both halves need to match. Swapping the halves within each 64-bit lane and ANDing gives that in both halves. */
+    __m128i eq = _mm_cmpeq_epi32(NS_LINEAR_SEARCH_SSE2_LOAD(p), key);
+    return (unsigned int)_mm_movemask_epi8(_mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1))));
+}
+
+static NS_INLINE unsigned int ns_linear_search_cmpeq_f32_sse2(const float* p, __m128 key)
+{
+    return (unsigned int)_mm_movemask_epi8(_mm_castps_si128(_mm_cmpeq_ps(_mm_loadu_ps(p), key)));
+}
+
+NS_LINEAR_SEARCH_DEFINE_SIMD(ns_linear_search_u8_sse2,  ns_uint8,  __m128i, 16, ns_linear_search_set1_u8_sse2,  ns_linear_search_cmpeq_u8_sse2,  NS_LINEAR_SEARCH_TARGET_SSE2)
+NS_LINEAR_SEARCH_DEFINE_SIMD(ns_linear_search_u16_sse2, ns_uint16, __m128i, 16, ns_linear_search_set1_u16_sse2, ns_linear_search_cmpeq_u16_sse2, NS_LINEAR_SEARCH_TARGET_SSE2)
+NS_LINEAR_SEARCH_DEFINE_SIMD(ns_linear_search_u32_sse2, ns_uint32, __m128i, 16, ns_linear_search_set1_u32_sse2, ns_linear_search_cmpeq_u32_sse2, NS_LINEAR_SEARCH_TARGET_SSE2)
+NS_LINEAR_SEARCH_DEFINE_SIMD(ns_linear_search_u64_sse2, ns_uint64, __m128i, 16, ns_linear_search_set1_u64_sse2, ns_linear_search_cmpeq_u64_sse2, NS_LINEAR_SEARCH_TARGET_SSE2)
+NS_LINEAR_SEARCH_DEFINE_SIMD(ns_linear_search_f32_sse2, float,     __m128,  16, ns_linear_search_set1_f32_sse2, ns_linear_search_cmpeq_f32_sse2, NS_LINEAR_SEARCH_TARGET_SSE2)
+#else
+NS_LINEAR_SEARCH_DEFINE_SCALAR(ns_linear_search_u8_scalar,  ns_uint8)
+NS_LINEAR_SEARCH_DEFINE_SCALAR(ns_linear_search_u16_scalar, ns_uint16)
+NS_LINEAR_SEARCH_DEFINE_SCALAR(ns_linear_search_u32_scalar, ns_uint32)
+NS_LINEAR_SEARCH_DEFINE_SCALAR(ns_linear_search_u64_scalar, ns_uint64)
+NS_LINEAR_SEARCH_DEFINE_SCALAR(ns_linear_search_f32_scalar, float)
+#endif
+
+#if defined(NS_SEARCH_AVX2)
+#define NS_LINEAR_SEARCH_AVX2_LOAD(p)   _mm256_loadu_si256((const __m256i*)(p))
+
+NS_SEARCH_TARGET_AVX2 static NS_INLINE __m256i ns_linear_search_set1_u8_avx2 (ns_uint8  key) { return _mm256_set1_epi8((char)key); }
+NS_SEARCH_TARGET_AVX2 static NS_INLINE __m256i ns_linear_search_set1_u16_avx2(ns_uint16 key) { return _mm256_set1_epi16((short)key); }
+NS_SEARCH_TARGET_AVX2 static NS_INLINE __m256i ns_linear_search_set1_u32_avx2(ns_uint32 key) { return _mm256_set1_epi32((int)key); }
+NS_SEARCH_TARGET_AVX2 static NS_INLINE __m256i ns_linear_search_set1_u64_avx2(ns_uint64 key) { return _mm256_set1_epi64x((ns_int64)key); }
+NS_SEARCH_TARGET_AVX2 static NS_INLINE __m256  ns_linear_search_set1_f32_avx2(float     key) { return _mm256_set1_ps(key); }
+
+NS_SEARCH_TARGET_AVX2
+static NS_INLINE unsigned int ns_linear_search_cmpeq_u8_avx2(const ns_uint8* p, __m256i key)
+{
+    return (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(NS_LINEAR_SEARCH_AVX2_LOAD(p), key));
+}
+
+NS_SEARCH_TARGET_AVX2
+static NS_INLINE unsigned int ns_linear_search_cmpeq_u16_avx2(const ns_uint16* p, __m256i key)
+{
+    return (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi16(NS_LINEAR_SEARCH_AVX2_LOAD(p), key));
+}
+
+NS_SEARCH_TARGET_AVX2
+static NS_INLINE unsigned int ns_linear_search_cmpeq_u32_avx2(const ns_uint32* p, __m256i key)
+{
+    return (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi32(NS_LINEAR_SEARCH_AVX2_LOAD(p), key));
+}
+
+NS_SEARCH_TARGET_AVX2
+static NS_INLINE unsigned int ns_linear_search_cmpeq_u64_avx2(const ns_uint64* p, __m256i key)
+{
+    return (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi64(NS_LINEAR_SEARCH_AVX2_LOAD(p), key));
+}
+
+NS_SEARCH_TARGET_AVX2
+static NS_INLINE unsigned int ns_linear_search_cmpeq_f32_avx2(const float* p, __m256 key)
+{
+    return (unsigned int)_mm256_movemask_epi8(_mm256_castps_si256(_mm256_cmp_ps(_mm256_loadu_ps(p), key, _CMP_EQ_OQ)));
+}
+
+NS_LINEAR_SEARCH_DEFINE_SIMD(ns_linear_search_u8_avx2,  ns_uint8,  __m256i, 32, ns_linear_search_set1_u8_avx2,  ns_linear_search_cmpeq_u8_avx2,  NS_SEARCH_TARGET_AVX2)
+NS_LINEAR_SEARCH_DEFINE_SIMD(ns_linear_search_u16_avx2, ns_uint16, __m256i, 32, ns_linear_search_set1_u16_avx2, ns_linear_search_cmpeq_u16_avx2, NS_SEARCH_TARGET_AVX2)
+NS_LINEAR_SEARCH_DEFINE_SIMD(ns_linear_search_u32_avx2, ns_uint32, __m256i, 32, ns_linear_search_set1_u32_avx2, ns_linear_search_cmpeq_u32_avx2, NS_SEARCH_TARGET_AVX2)
+NS_LINEAR_SEARCH_DEFINE_SIMD(ns_linear_search_u64_avx2, ns_uint64, __m256i, 32, ns_linear_search_set1_u64_avx2, ns_linear_search_cmpeq_u64_avx2, NS_SEARCH_TARGET_AVX2)
+NS_LINEAR_SEARCH_DEFINE_SIMD(ns_linear_search_f32_avx2, float,     __m256,  32, ns_linear_search_set1_f32_avx2, ns_linear_search_cmpeq_f32_avx2, NS_SEARCH_TARGET_AVX2)
+#endif
+
+/* AVX2 only pays for the check once there's at least one of its vectors to compare. */
+#if defined(NS_SEARCH_AVX2)
+    #define NS_LINEAR_SEARCH_DISPATCH(type, pList, count, key) \
+        if ((count)*sizeof(*(pList)) >= 32 && ns_search_has_avx2()) { \
+            return ns_linear_search_##type##_avx2(pList, count, key); \
+        } \
+        return ns_linear_search_##type##_sse2(pList, count, key)
+#elif defined(NS_SEARCH_SSE2)
+    #define NS_LINEAR_SEARCH_DISPATCH(type, pList, count, key) \
+        return ns_linear_search_##type##_sse2(pList, count, key)
+#else
+    #define NS_LINEAR_SEARCH_DISPATCH(type, pList, count, key) \
+        return ns_linear_search_##type##_scalar(pList, count, key)
+#endif
+
+NS_API size_t ns_linear_search_u8(const ns_uint8* pList, size_t count, ns_uint8 key)
+{
+    if (pList == NULL) {
+        return count;
+    }
+
+    NS_LINEAR_SEARCH_DISPATCH(u8, pList, count, key);
+}
+
+NS_API size_t ns_linear_search_u16(const ns_uint16* pList, size_t count, ns_uint16 key)
+{
+    if (pList == NULL) {
+        return count;
+    }
+
+    NS_LINEAR_SEARCH_DISPATCH(u16, pList, count, key);
+}
+
+NS_API size_t ns_linear_search_u32(const ns_uint32* pList, size_t count, ns_uint32 key)
+{
+    if (pList == NULL) {
+        return count;
+    }
+
+    NS_LINEAR_SEARCH_DISPATCH(u32, pList, count, key);
+}
+
+NS_API size_t ns_linear_search_u64(const ns_uint64* pList, size_t count, ns_uint64 key)
+{
+    if (pList == NULL) {
+        return count;
+    }
+
+    NS_LINEAR_SEARCH_DISPATCH(u64, pList, count, key);
+}
+
+NS_API size_t ns_linear_search_f32(const float* pList, size_t count, float key)
+{
+    if (pList == NULL) {
+        return count;
+    }
+
+    NS_LINEAR_SEARCH_DISPATCH(f32, pList, count, key);
+}
+/* END linear_search.c */
+
+/* BEG sorted_search.c */
+#define NS_SORTED_SEARCH_LINEAR_THRESHOLD       10
+#define NS_SORTED_SEARCH_BRANCHLESS_THRESHOLD   32  /* Below this there are too few mispredictions for the branchless search to win. */
+
+static void* ns_sorted_search_with_thresholds(const void* pKey, const void* pList, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData, size_t linearThreshold, size_t branchlessThreshold)
+{
+    if (count < linearThreshold) {
+        return ns_linear_search(pKey, pList, count, stride, compareProc, pUserData);
+    } else if (count < branchlessThreshold) {
+        return ns_binary_search(pKey, pList, count, stride, compareProc, pUserData);
+    } else {
+        return ns_binary_search_branchless(pKey, pList, count, stride, compareProc, pUserData);
+    }
+}
+
+NS_API void* ns_sorted_search(const void* pKey, const void* pList, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData)
+{
+    return ns_sorted_search_with_thresholds(pKey, pList, count, stride, compareProc, pUserData, NS_SORTED_SEARCH_LINEAR_THRESHOLD, NS_SORTED_SEARCH_BRANCHLESS_THRESHOLD);
+}
+/* END sorted_search.c */
+
+/* BEG search_tuner.c */
+/*
+ns_sorted_search() picks between a linear search, ns_binary_search() and ns_binary_search_branchless() with thresholds that were
+picked on one machine with an int comparator. Where the crossovers actually are depends on the CPU, the stride and above all on how
+expensive the comparator is. The tuner measures them.
+
+ns_search_tuner_measure() times all three searches on windows of a sorted sample of sizes from 2 up to 1024, or the sample count if
+that's smaller, and keeps the thresholds and the measured costs for that stride and comparator. pKeys is an array of keyCount keys
+to search for, keyStride bytes apart, in the same form compareProc expects. Only the first NS_SEARCH_TUNER_MAX_KEYS are used. Pass
+NULL to use elements spread over the sample as the keys, which is only valid when the keys and elements are the same type. Each key
+is searched for in windows around where it is in the sample, at random offsets, so the searches take different paths and the
+branch predictor can't learn any one of them. Each search is timed for at least half a millisecond, and the fastest of three runs
+is kept, so this takes in the order of 100ms.
+
+The linear threshold is the smallest size from which a binary search is always faster, and the branchless threshold the smallest
+size from which ns_binary_search_branchless() is always faster than ns_binary_search(). If one never overtakes within the sizes
+that could be measured, the threshold goes one past the largest of them. The costs are in the returned ns_search_tuning and can be
+logged and pinned later with ns_search_tuner_set(), which skips the measurement.
+
+ns_sorted_search_tuned() dispatches on the thresholds for its stride and comparator. It never measures anything itself, since that
+would put a stall of around 100ms on whichever lookup happened to come first. If there are no thresholds for the stride and
+comparator it behaves like ns_sorted_search(). It only reads the tuner, so once everything has been measured or set up front the
+tuner can be shared between threads. Measuring and setting aren't thread safe.
+*/
+#define NS_SEARCH_TUNER_MAX_KEYS        256
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+static volatile size_t g_nsSearchTunerSink = 0;    /* Stops the compiler from throwing away the searches being timed. */
+
+static double ns_search_tuner_time_in_seconds(void)
+{
+#if defined(_WIN32)
+    LARGE_INTEGER counter;
+    LARGE_INTEGER frequency;
+
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return (double)tv.tv_sec + (double)tv.tv_usec / 1000000.0;
+#endif
+}
+
+/*
+Returns the time of one search in nanoseconds. The algorithm is 0 for linear, 1 for binary and 2 for branchless. Each key is
+searched for in a window that contains its lower bound, at a random offset drawn fresh for every search. The keys are walked in a
+scrambled order. Nothing about the sequence repeats, so the branch predictor can't learn the path of the classic search, which
+would make it look a lot faster than it is on real lookups.
+*/
+static double ns_search_tuner_time_search(int algorithm, const char* pKeys, size_t keyCount, size_t keyStride, const size_t* pLowerBounds, const char* pList, size_t count, size_t stride, size_t size, int (*compareProc)(void*, const void*, const void*), void* pUserData)
+{
+    ns_uint32 random = 12345;
+    size_t keyStep;
+    size_t repCount = 64;
+
+    /* Any step that is coprime with the key count visits every key. */
+    keyStep = (keyCount * 5) / 8 + 1;
+    for (;;) {
+        size_t a = keyStep;
+        size_t b = keyCount;
+
+        while (b != 0) {
+            size_t t = a % b;
+            a = b;
+            b = t;
+        }
+
+        if (a == 1) {
+            break;
+        }
+
+        keyStep += 1;
+    }
+
+    for (;;) {
+        size_t iKey = 0;
+        size_t foundCount = 0;
+        double elapsed;
+        size_t iRep;
+
+        elapsed = ns_search_tuner_time_in_seconds();
+        for (iRep = 0; iRep < repCount; iRep += 1) {
+            const char* pKey = pKeys + iKey*keyStride;
+            size_t offset;
+            size_t windowBeg;
+            const char* pWindow;
+            void* pResult;
+
+            random ^= random << 13;
+            random ^= random >> 17;
+            random ^= random << 5;
+            offset = (size_t)(((ns_uint64)random * size) >> 32);    /* Cheaper than a modulo, which would add to every search. */
+
+            windowBeg = (pLowerBounds[iKey] > offset) ? pLowerBounds[iKey] - offset : 0;
+            if (windowBeg > count - size) {
+                windowBeg = count - size;
+            }
+
+            pWindow = pList + windowBeg*stride;
+
+            if (algorithm == 0) {
+                pResult = ns_linear_search(pKey, pWindow, size, stride, compareProc, pUserData);
+            } else if (algorithm == 1) {
+                pResult = ns_binary_search(pKey, pWindow, size, stride, compareProc, pUserData);
+            } else {
+                pResult = ns_binary_search_branchless(pKey, pWindow, size, stride, compareProc, pUserData);
+            }
+
+            foundCount += (pResult != NULL);
+
+            iKey += keyStep;
+            if (iKey >= keyCount) {
+                iKey -= keyCount;
+            }
+        }
+        elapsed = ns_search_tuner_time_in_seconds() - elapsed;
+
+        g_nsSearchTunerSink += foundCount;
+
+        if (elapsed >= 0.0005 || repCount >= ((size_t)1 << 24)) {
+            return (elapsed * 1000000000.0) / (double)repCount;
+        }
+
+        repCount *= 2;
+    }
+}
+
+static ns_search_tuning* ns_search_tuner_find_or_add(ns_search_tuner* pTuner, size_t stride, int (*compareProc)(void*, const void*, const void*))
+{
+    ns_search_tuning* pTuning = (ns_search_tuning*)ns_search_tuner_get(pTuner, stride, compareProc);
+
+    if (pTuning == NULL) {
+        if (pTuner->entryCount == NS_SEARCH_TUNER_MAX_ENTRIES) {
+            return NULL;
+        }
+
+        pTuning = &pTuner->entries[pTuner->entryCount];
+        pTuner->entryCount += 1;
+    }
+
+    NS_ZERO_MEMORY(pTuning, sizeof(*pTuning));
+    pTuning->stride      = stride;
+    pTuning->compareProc = compareProc;
+
+    return pTuning;
+}
+
+NS_API void ns_search_tuner_init(ns_search_tuner* pTuner)
+{
+    if (pTuner == NULL) {
+        return;
+    }
+
+    NS_ZERO_MEMORY(pTuner, sizeof(*pTuner));
+}
+
+NS_API ns_result ns_search_tuner_measure(ns_search_tuner* pTuner, const void* pKeys, size_t keyCount, size_t keyStride, const void* pList, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData, const ns_search_tuning** ppTuning)
+{
+    static const size_t sizes[NS_SEARCH_TUNER_MAX_SIZES] = {2, 4, 6, 8, 12, 16, 24, 32, 48, 64, 128, 256, 512, 1024};
+    double linearCosts[NS_SEARCH_TUNER_MAX_SIZES];
+    double binaryCosts[NS_SEARCH_TUNER_MAX_SIZES];
+    double branchlessCosts[NS_SEARCH_TUNER_MAX_SIZES];
+    size_t lowerBounds[NS_SEARCH_TUNER_MAX_KEYS];
+    ns_search_tuning* pTuning;
+    size_t sizeCount;
+    size_t iSize;
+    size_t iKey;
+    int iRun;
+
+    if (ppTuning != NULL) {
+        *ppTuning = NULL;
+    }
+
+    if (pTuner == NULL || pList == NULL || count < sizes[0] || stride == 0 || compareProc == NULL) {
+        return NS_INVALID_ARGS;
+    }
+
+    /* Don't waste time measuring if there's nowhere to put the result. */
+    if (pTuner->entryCount == NS_SEARCH_TUNER_MAX_ENTRIES && ns_search_tuner_get(pTuner, stride, compareProc) == NULL) {
+        return NS_NO_SPACE;
+    }
+
+    /* Without keys, elements spread evenly over the sample are used instead. */
+    if (pKeys == NULL || keyCount == 0) {
+        keyCount  = (count < NS_SEARCH_TUNER_MAX_KEYS) ? count : NS_SEARCH_TUNER_MAX_KEYS;
+        keyStride = (count / keyCount) * stride;
+        pKeys     = pList;
+    }
+
+    if (keyCount > NS_SEARCH_TUNER_MAX_KEYS) {
+        keyCount = NS_SEARCH_TUNER_MAX_KEYS;
+    }
+
+    for (iKey = 0; iKey < keyCount; iKey += 1) {
+        lowerBounds[iKey] = ns_lower_bound((const char*)pKeys + iKey*keyStride, pList, count, stride, compareProc, pUserData);
+    }
+
+    sizeCount = 0;
+    while (sizeCount < NS_SEARCH_TUNER_MAX_SIZES && sizes[sizeCount] <= count) {
+        sizeCount += 1;
+    }
+
+    /* The runs are interleaved so that something else happening on the machine is less likely to skew one search in particular. */
+    for (iRun = 0; iRun < 3; iRun += 1) {
+        for (iSize = 0; iSize < sizeCount; iSize += 1) {
+            double linearCost     = ns_search_tuner_time_search(0, (const char*)pKeys, keyCount, keyStride, lowerBounds, (const char*)pList, count, stride, sizes[iSize], compareProc, pUserData);
+            double binaryCost     = ns_search_tuner_time_search(1, (const char*)pKeys, keyCount, keyStride, lowerBounds, (const char*)pList, count, stride, sizes[iSize], compareProc, pUserData);
+            double branchlessCost = ns_search_tuner_time_search(2, (const char*)pKeys, keyCount, keyStride, lowerBounds, (const char*)pList, count, stride, sizes[iSize], compareProc, pUserData);
+
+            if (iRun == 0 || linearCost     < linearCosts[iSize])     { linearCosts[iSize]     = linearCost;     }
+            if (iRun == 0 || binaryCost     < binaryCosts[iSize])     { binaryCosts[iSize]     = binaryCost;     }
+            if (iRun == 0 || branchlessCost < branchlessCosts[iSize]) { branchlessCosts[iSize] = branchlessCost; }
+        }
+    }
+
+    pTuning = ns_search_tuner_find_or_add(pTuner, stride, compareProc);
+    if (pTuning == NULL) {
+        return NS_NO_SPACE;
+    }
+
+    pTuning->measuredSizeCount   = sizeCount;
+    pTuning->linearThreshold     = sizes[sizeCount - 1] + 1;
+    pTuning->branchlessThreshold = sizes[sizeCount - 1] + 1;
+
+    /* Walk down from the largest size so that a threshold is only moved down while the faster search keeps winning. */
+    for (iSize = sizeCount; iSize > 0; iSize -= 1) {
+        double binaryOrBranchlessCost = (binaryCosts[iSize - 1] < branchlessCosts[iSize - 1]) ? binaryCosts[iSize - 1] : branchlessCosts[iSize - 1];
+
+        if (binaryOrBranchlessCost >= linearCosts[iSize - 1]) {
+            break;
+        }
+
+        pTuning->linearThreshold = sizes[iSize - 1];
+    }
+
+    for (iSize = sizeCount; iSize > 0; iSize -= 1) {
+        if (branchlessCosts[iSize - 1] >= binaryCosts[iSize - 1]) {
+            break;
+        }
+
+        pTuning->branchlessThreshold = sizes[iSize - 1];
+    }
+
+    for (iSize = 0; iSize < sizeCount; iSize += 1) {
+        pTuning->measuredSizes[iSize]   = sizes[iSize];
+        pTuning->linearCosts[iSize]     = linearCosts[iSize];
+        pTuning->binaryCosts[iSize]     = binaryCosts[iSize];
+        pTuning->branchlessCosts[iSize] = branchlessCosts[iSize];
+    }
+
+    if (ppTuning != NULL) {
+        *ppTuning = pTuning;
+    }
+
+    return NS_SUCCESS;
+}
+
+NS_API ns_result ns_search_tuner_set(ns_search_tuner* pTuner, size_t stride, int (*compareProc)(void*, const void*, const void*), size_t linearThreshold, size_t branchlessThreshold)
+{
+    ns_search_tuning* pTuning;
+
+    if (pTuner == NULL || stride == 0 || compareProc == NULL) {
+        return NS_INVALID_ARGS;
+    }
+
+    pTuning = ns_search_tuner_find_or_add(pTuner, stride, compareProc);
+    if (pTuning == NULL) {
+        return NS_NO_SPACE;
+    }
+
+    pTuning->linearThreshold     = linearThreshold;
+    pTuning->branchlessThreshold = branchlessThreshold;
+
+    return NS_SUCCESS;
+}
+
+NS_API const ns_search_tuning* ns_search_tuner_get(const ns_search_tuner* pTuner, size_t stride, int (*compareProc)(void*, const void*, const void*))
+{
+    size_t iEntry;
+
+    if (pTuner == NULL) {
+        return NULL;
+    }
+
+    for (iEntry = 0; iEntry < pTuner->entryCount; iEntry += 1) {
+        if (pTuner->entries[iEntry].stride == stride && pTuner->entries[iEntry].compareProc == compareProc) {
+            return &pTuner->entries[iEntry];
+        }
+    }
+
+    return NULL;
+}
+
+NS_API void* ns_sorted_search_tuned(const ns_search_tuner* pTuner, const void* pKey, const void* pList, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData)
+{
+    const ns_search_tuning* pTuning = ns_search_tuner_get(pTuner, stride, compareProc);
+
+    if (pTuning == NULL) {
+        return ns_sorted_search(pKey, pList, count, stride, compareProc, pUserData);
+    }
+
+    return ns_sorted_search_with_thresholds(pKey, pList, count, stride, compareProc, pUserData, pTuning->linearThreshold, pTuning->branchlessThreshold);
+}
+/* END search_tuner.c */
+
+
+
+#include <stdio.h>
+#include <string.h>
+
+int compare_int(void* context, const void* a, const void* b)
+{
+    (void)context;
+    return (*(int*)a - *(int*)b);
+}
+
+int compare_strings(void* context, const void* a, const void* b)
+{
+    (void)context;
+    return strcmp((const char*)a, *(const char**)b);
+}
+
+/* Searches for every key in and around arrays of every size up to 100, with duplicates, and compares against ns_binary_search(). */
+static int test_binary_search_branchless(void)
+{
+    int arr[100];
+    size_t count;
+
+    for (count = 0; count <= 100; count += 1) {
+        size_t i;
+        int key;
+
+        for (i = 0; i < count; i += 1) {
+            arr[i] = (int)(i / 3) * 2;
+        }
+
+        for (key = -1; key <= (int)count; key += 1) {
+            const int* pExpected = (const int*)ns_binary_search(&key, arr, count, sizeof(int), compare_int, NULL);
+            const int* pResult   = (const int*)ns_binary_search_branchless(&key, arr, count, sizeof(int), compare_int, NULL);
+
+            /* With duplicates the two can find different elements, so only the value matters. */
+            if ((pExpected == NULL) != (pResult == NULL) || (pResult != NULL && *pResult != key)) {
+                printf("ns_binary_search_branchless() FAILED for key %d with count %u\n", key, (unsigned int)count);
+                return 0;
+            }
+        }
+    }
+
+    printf("ns_binary_search_branchless() PASSED\n");
+    return 1;
+}
+
+/* Checks every key in and around arrays of every size up to 100, with runs of duplicates, against a plain linear scan. */
+static int test_bounds(void)
+{
+    int arr[100];
+    size_t count;
+
+    for (count = 0; count <= 100; count += 1) {
+        size_t i;
+        int key;
+
+        for (i = 0; i < count; i += 1) {
+            arr[i] = (int)((i * i) / 40) * 2;   /* Long runs of duplicates at the start, none at the end. */
+        }
+
+        for (key = -1; key <= (int)((count * count) / 40) * 2 + 1; key += 1) {
+            size_t expectedLower = 0;
+            size_t expectedUpper;
+            size_t beg;
+            size_t end;
+
+            while (expectedLower < count && arr[expectedLower] < key) {
+                expectedLower += 1;
+            }
+            expectedUpper = expectedLower;
+            while (expectedUpper < count && arr[expectedUpper] == key) {
+                expectedUpper += 1;
+            }
+
+            ns_equal_range(&key, arr, count, sizeof(int), compare_int, NULL, &beg, &end);
+
+            if (ns_lower_bound(&key, arr, count, sizeof(int), compare_int, NULL) != expectedLower ||
+                ns_upper_bound(&key, arr, count, sizeof(int), compare_int, NULL) != expectedUpper ||
+                beg != expectedLower || end != expectedUpper) {
+                printf("ns_lower_bound/ns_upper_bound/ns_equal_range() FAILED for key %d with count %u\n", key, (unsigned int)count);
+                return 0;
+            }
+        }
+    }
+
+    printf("ns_lower_bound/ns_upper_bound/ns_equal_range() PASSED\n");
+    return 1;
+}
+
+/* Checks every key in and around arrays of every size up to 100, with duplicates, from every hint, against a plain lower bound. */
+static int test_gallop_search(void)
+{
+    int arr[100];
+    size_t count;
+
+    for (count = 0; count <= 100; count += 1) {
+        size_t i;
+        int key;
+
+        for (i = 0; i < count; i += 1) {
+            arr[i] = (int)(i / 3) * 2;
+        }
+
+        for (key = -1; key <= (int)count; key += 1) {
+            size_t expected = 0;
+            size_t hint;
+
+            while (expected < count && arr[expected] < key) {
+                expected += 1;
+            }
+
+            for (hint = 0; hint <= count + 2; hint += 1) {
+                if (ns_gallop_search(&key, arr, count, sizeof(int), compare_int, NULL, hint) != expected) {
+                    printf("ns_gallop_search() FAILED for key %d from hint %u with count %u\n", key, (unsigned int)hint, (unsigned int)count);
+                    return 0;
+                }
+            }
+        }
+    }
+
+    printf("ns_gallop_search() PASSED\n");
+    return 1;
+}
+
+/*
+Searches for batches of keys in random, sorted and mostly sorted order, with duplicates and keys outside of the table, and compares
+every result against ns_lower_bound(). The keys are interleaved with other data to check keyStride is respected.
+*/
+static int test_binary_search_batch(void)
+{
+    int list[1000];
+    int keys[2 * 700];
+    void* results[700];
+    size_t counts[] = {0, 1, 2, 17, 100, 1000};
+    size_t iCount;
+    int order;
+
+    for (iCount = 0; iCount < sizeof(counts) / sizeof(counts[0]); iCount += 1) {
+        size_t count = counts[iCount];
+        size_t i;
+
+        for (i = 0; i < count; i += 1) {
+            list[i] = (int)(i / 2) * 4;
+        }
+
+        for (order = 0; order < 3; order += 1) {
+            size_t keyCount;
+
+            for (keyCount = 0; keyCount <= 700; keyCount += (keyCount < 40) ? 1 : 333) {
+                unsigned int seed = 1;
+
+                for (i = 0; i < keyCount; i += 1) {
+                    seed = seed * 1103515245 + 12345;
+
+                    if (order == 0) {
+                        keys[i*2] = (int)((seed >> 8) % (count * 2 + 10)) - 5;     /* Random. */
+                    } else {
+                        keys[i*2] = (int)((i * (count * 2 + 10)) / (keyCount + 1)) - 5;    /* Sorted, with duplicates when keyCount is large. */
+                        if (order == 2 && (seed >> 8) % 50 == 0) {
+                            keys[i*2] = (int)((seed >> 12) % (count * 2 + 10)) - 5;    /* Mostly sorted. */
+                        }
+                    }
+
+                    keys[i*2 + 1] = -1000;
+                }
+
+                ns_binary_search_batch(keys, keyCount, sizeof(int) * 2, list, count, sizeof(int), compare_int, NULL, results);
+
+                for (i = 0; i < keyCount; i += 1) {
+                    size_t lowerBound = ns_lower_bound(&keys[i*2], list, count, sizeof(int), compare_int, NULL);
+                    void* pExpected = (lowerBound < count && list[lowerBound] == keys[i*2]) ? &list[lowerBound] : NULL;
+
+                    if (results[i] != pExpected) {
+                        printf("ns_binary_search_batch() FAILED for key %d with count %u, order %d and %u keys\n", keys[i*2], (unsigned int)count, order, (unsigned int)keyCount);
+                        return 0;
+                    }
+                }
+            }
+        }
+    }
+
+    printf("ns_binary_search_batch() PASSED\n");
+    return 1;
+}
+
+/*
+Checks every key in and around uniform, skewed and duplicate-heavy tables against a plain lower bound, that uniform tables need
+only a few probes, and that skewed tables never need more than twice the probes of a binary search plus the final scan.
+*/
+static int test_interpolation_search(void)
+{
+    static ns_uint64 list64[4096];
+    static ns_uint32 list32[4096];
+    int distribution;
+
+    for (distribution = 0; distribution < 4; distribution += 1) {
+        size_t count;
+
+        for (count = 0; count <= 4096; count += (count < 40) ? 1 : 1011) {
+            size_t maxProbes = 2 + NS_INTERPOLATION_SEARCH_SEQUENTIAL_COUNT;
+            size_t n;
+            size_t i;
+
+            for (n = count; n > 1; n >>= 1) {
+                maxProbes += 2;
+            }
+
+            for (i = 0; i < count; i += 1) {
+                ns_uint64 value;
+
+                if (distribution == 0) {
+                    value = (ns_uint64)i * 3 + 1000;                     /* Dense and uniform. */
+                } else if (distribution == 1) {
+                    value = (ns_uint64)i * i * i;                        /* Skewed. Squared for ns_uint32 so it doesn't wrap. */
+                } else if (distribution == 2) {
+                    value = (ns_uint64)(i / 100);                        /* Long runs of duplicates. */
+                } else {
+                    value = (i + 1 < count) ? (ns_uint64)i : NS_UINT64_MAX;    /* One huge outlier. */
+                }
+
+                list64[i] = value << 16;
+                list32[i] = (distribution == 3 && i + 1 == count) ? NS_UINT32_MAX : ((distribution == 1) ? (ns_uint32)(i * i) : (ns_uint32)value);
+            }
+
+            for (i = 0; i <= count; i += 1) {
+                int offset;
+
+                for (offset = -1; offset <= 1; offset += 1) {
+                    ns_uint64 key64 = ((i < count) ? list64[i] : list64[count > 0 ? count - 1 : 0] + 1) + (ns_uint64)(ns_int64)offset;
+                    ns_uint32 key32 = ((i < count) ? list32[i] : 0) + (ns_uint32)(ns_int32)offset;
+                    size_t expected64 = 0;
+                    size_t expected32 = 0;
+                    size_t probeCount64;
+                    size_t probeCount32;
+
+                    while (expected64 < count && list64[expected64] < key64) { expected64 += 1; }
+                    while (expected32 < count && list32[expected32] < key32) { expected32 += 1; }
+                    if (expected64 < count && list64[expected64] != key64) { expected64 = count; }
+                    if (expected32 < count && list32[expected32] != key32) { expected32 = count; }
+
+                    if (ns_interpolation_search_u64(list64, count, key64, &probeCount64) != expected64 || ns_interpolation_search_u32(list32, count, key32, &probeCount32) != expected32) {
+                        printf("ns_interpolation_search() FAILED for distribution %d with count %u\n", distribution, (unsigned int)count);
+                        return 0;
+                    }
+
+                    if (probeCount64 > maxProbes || probeCount32 > maxProbes || (distribution == 0 && count > 0 && probeCount64 > 4 + NS_INTERPOLATION_SEARCH_SEQUENTIAL_COUNT)) {
+                        printf("ns_interpolation_search() FAILED with %u probes for distribution %d with count %u\n", (unsigned int)probeCount64, distribution, (unsigned int)count);
+                        return 0;
+                    }
+                }
+            }
+        }
+    }
+
+    printf("ns_interpolation_search_u32/u64() PASSED\n");
+    return 1;
+}
+
+/* Searches for every key in and around Eytzinger arrays of every size up to 100, with duplicates, and checks the sorted index. */
+static int test_eytzinger(void)
+{
+    int sorted[100];
+    int eytzinger[100];
+    size_t count;
+
+    for (count = 0; count <= 100; count += 1) {
+        size_t i;
+        int key;
+
+        for (i = 0; i < count; i += 1) {
+            sorted[i] = (int)(i / 3) * 2;
+        }
+
+        ns_eytzinger_build(sorted, count, sizeof(int), eytzinger);
+
+        for (key = -1; key <= (int)count; key += 1) {
+            size_t expectedIndex = 0;
+            size_t sortedIndex;
+            const int* pResult;
+
+            while (expectedIndex < count && sorted[expectedIndex] < key) {
+                expectedIndex += 1;
+            }
+
+            pResult = (const int*)ns_eytzinger_search(&key, eytzinger, count, sizeof(int), compare_int, NULL, &sortedIndex);
+
+            if (sortedIndex != expectedIndex || (pResult != NULL) != (expectedIndex < count && sorted[expectedIndex] == key) || (pResult != NULL && *pResult != key)) {
+                printf("ns_eytzinger_search() FAILED for key %d with count %u\n", key, (unsigned int)count);
+                return 0;
+            }
+        }
+    }
+
+    printf("ns_eytzinger_search() PASSED\n");
+    return 1;
+}
+
+static void* test_failing_malloc(size_t sz, void* pUserData)
+{
+    (void)sz;
+    (void)pUserData;
+    return NULL;
+}
+
+/*
+Builds trees of every size up to a few full layers, with duplicates and keys at both ends of the range, and checks every key in
+and around them against a plain lower bound.
+*/
+static int test_static_btree(void)
+{
+    const size_t maxCount = 5000;   /* 16*17*17 is 4624 so this covers four layers of ns_uint32 keys. */
+    ns_uint32* pKeys32 = (ns_uint32*)malloc(maxCount * sizeof(*pKeys32));
+    ns_uint64* pKeys64 = (ns_uint64*)malloc(maxCount * sizeof(*pKeys64));
+    ns_allocation_callbacks failingCallbacks;
+    ns_static_btree tree;
+    size_t count;
+    int passed = 1;
+
+    if (pKeys32 == NULL || pKeys64 == NULL) {
+        printf("ns_static_btree FAILED: out of memory\n");
+        free(pKeys32);
+        free(pKeys64);
+        return 0;
+    }
+
+    for (count = 0; count <= maxCount && passed; count += (count < 300) ? 1 : 97) {
+        size_t i;
+        size_t iQuery;
+
+        for (i = 0; i < count; i += 1) {
+            pKeys32[i] = (ns_uint32)(i / 2) * 3;
+            pKeys64[i] = ((ns_uint64)(i / 2) * 3) << 33;
+        }
+
+        /* The largest key is the same as the padding. */
+        if (count > 2) {
+            pKeys32[count - 1] = NS_UINT32_MAX;
+            pKeys64[count - 1] = NS_UINT64_MAX;
+        }
+
+        if (ns_static_btree_init_u32(pKeys32, count, NULL, &tree) != NS_SUCCESS) {
+            printf("ns_static_btree_init_u32() FAILED with count %u\n", (unsigned int)count);
+            passed = 0;
+            break;
+        }
+
+        for (iQuery = 0; iQuery <= count + 1 && passed; iQuery += 1) {
+            ns_uint32 base = (iQuery < count) ? pKeys32[iQuery] : ((iQuery == count) ? 0 : NS_UINT32_MAX);
+            int offset;
+
+            for (offset = -1; offset <= 1; offset += 1) {
+                ns_uint32 key = base + (ns_uint32)offset;
+                size_t expected = 0;
+                size_t expectedFind;
+
+                while (expected < count && pKeys32[expected] < key) {
+                    expected += 1;
+                }
+                expectedFind = (expected < count && pKeys32[expected] == key) ? expected : count;
+
+                if (ns_static_btree_lower_bound_u32(&tree, key) != expected || ns_static_btree_find_u32(&tree, key) != expectedFind) {
+                    printf("ns_static_btree_lower_bound_u32() FAILED for key %u with count %u\n", (unsigned int)key, (unsigned int)count);
+                    passed = 0;
+                    break;
+                }
+            }
+        }
+
+        ns_static_btree_uninit(&tree);
+
+        if (ns_static_btree_init_u64(pKeys64, count, NULL, &tree) != NS_SUCCESS) {
+            printf("ns_static_btree_init_u64() FAILED with count %u\n", (unsigned int)count);
+            passed = 0;
+            break;
+        }
+
+        for (iQuery = 0; iQuery <= count + 1 && passed; iQuery += 1) {
+            ns_uint64 base = (iQuery < count) ? pKeys64[iQuery] : ((iQuery == count) ? 0 : NS_UINT64_MAX);
+            int offset;
+
+            for (offset = -1; offset <= 1; offset += 1) {
+                ns_uint64 key = base + (ns_uint64)(ns_int64)offset;
+                size_t expected = 0;
+                size_t expectedFind;
+
+                while (expected < count && pKeys64[expected] < key) {
+                    expected += 1;
+                }
+                expectedFind = (expected < count && pKeys64[expected] == key) ? expected : count;
+
+                if (ns_static_btree_lower_bound_u64(&tree, key) != expected || ns_static_btree_find_u64(&tree, key) != expectedFind) {
+                    printf("ns_static_btree_lower_bound_u64() FAILED for query %u with count %u\n", (unsigned int)iQuery, (unsigned int)count);
+                    passed = 0;
+                    break;
+                }
+            }
+        }
+
+        ns_static_btree_uninit(&tree);
+    }
+
+    /* A failed allocation should leave nothing to free. */
+    if (passed) {
+        failingCallbacks.pUserData = NULL;
+        failingCallbacks.onMalloc  = test_failing_malloc;
+        failingCallbacks.onRealloc = NULL;
+        failingCallbacks.onFree    = NULL;
+
+        if (ns_static_btree_init_u32(pKeys32, 100, &failingCallbacks, &tree) != NS_OUT_OF_MEMORY || tree.pNodes != NULL) {
+            printf("ns_static_btree_init_u32() FAILED to report out of memory\n");
+            passed = 0;
+        }
+    }
+
+    free(pKeys32);
+    free(pKeys64);
+
+    if (passed) {
+        printf("ns_static_btree PASSED\n");
+    }
+
+    return passed;
+}
+
+static ns_uint64 test_hash_u32(void* pUserData, const void* pKey)
+{
+    NS_UNUSED(pUserData);
+    return *(const ns_uint32*)pKey;   /* Deliberately weak. The index mixes the hash itself. */
+}
+
+static int test_compare_u32(void* pUserData, const void* pKey, const void* pElement)
+{
+    ns_uint32 a = *(const ns_uint32*)pKey;
+    ns_uint32 b = *(const ns_uint32*)pElement;
+
+    NS_UNUSED(pUserData);
+    return (a > b) - (a < b);
+}
+
+static ns_uint64 test_hash_string(void* pUserData, const void* pKey)
+{
+    const char* pString = *(const char**)pKey;
+    ns_uint64 hash = ((ns_uint64)0xCBF29CE4 << 32) | 0x84222325;  /* FNV-1a */
+
+    NS_UNUSED(pUserData);
+
+    while (*pString != '\0') {
+        hash = (hash ^ (unsigned char)*pString) * (((ns_uint64)0x100 << 32) | 0x1B3);
+        pString += 1;
+    }
+
+    return hash;
+}
+
+static int test_compare_string_ptrs(void* pUserData, const void* pKey, const void* pElement)
+{
+    NS_UNUSED(pUserData);
+    return strcmp(*(const char**)pKey, *(const char**)pElement);
+}
+
+/* Puts a slot past the end of the table in the last position of the buffer, and puts it back. */
+static int test_static_hash_index_rejects_bad_slot(void* pBuffer, size_t bufferSize, const ns_uint32* pKeys, size_t count)
+{
+    ns_uint32* pLastSlot = (ns_uint32*)((char*)pBuffer + bufferSize) - 1;
+    ns_uint32 slot = *pLastSlot;
+    ns_static_hash_index loaded;
+    ns_result result;
+
+    *pLastSlot = (ns_uint32)count;
+    result = ns_static_hash_index_init_from_buffer(pBuffer, bufferSize, pKeys, count, sizeof(*pKeys), test_hash_u32, test_compare_u32, NULL, &loaded);
+    *pLastSlot = slot;
+
+    return result == NS_INVALID_FILE && loaded.pSlots == NULL;
+}
+
+static int test_static_hash_index(void)
+{
+    const size_t maxCount = 3000;
+    ns_uint32* pKeys = (ns_uint32*)malloc(maxCount * sizeof(*pKeys));
+    ns_allocation_callbacks failingCallbacks;
+    ns_static_hash_index index;
+    size_t count;
+    int passed = 1;
+
+    if (pKeys == NULL) {
+        printf("ns_static_hash_index FAILED: out of memory\n");
+        return 0;
+    }
+
+    for (count = 0; count <= maxCount && passed; count += (count < 100) ? 1 : 293) {
+        size_t i;
+
+        /* Even keys only so the odd ones can be used for misses. The order is scrambled to check the slots map back to it. */
+        for (i = 0; i < count; i += 1) {
+            pKeys[i] = (ns_uint32)((i * 2654435761UL) % 1000003UL) * 2;
+        }
+
+        if (ns_static_hash_index_init(pKeys, count, sizeof(*pKeys), test_hash_u32, test_compare_u32, NULL, NULL, &index) != NS_SUCCESS) {
+            printf("ns_static_hash_index_init() FAILED with count %u\n", (unsigned int)count);
+            passed = 0;
+            break;
+        }
+
+        for (i = 0; i < count; i += 1) {
+            ns_uint32 miss = pKeys[i] + 1;
+
+            if (ns_static_hash_index_find(&index, &pKeys[i]) != &pKeys[i] || ns_static_hash_index_find(&index, &miss) != NULL) {
+                printf("ns_static_hash_index_find() FAILED for key %u with count %u\n", (unsigned int)pKeys[i], (unsigned int)count);
+                passed = 0;
+                break;
+            }
+        }
+
+        /* Every slot is used exactly once. */
+        if (passed && count > 0) {
+            char* pSeen = (char*)calloc(count, 1);
+            if (pSeen != NULL) {
+                for (i = 0; i < count; i += 1) {
+                    if (index.pSlots[i] >= count || pSeen[index.pSlots[i]]) {
+                        printf("ns_static_hash_index_init() FAILED to build a minimal perfect hash with count %u\n", (unsigned int)count);
+                        passed = 0;
+                        break;
+                    }
+                    pSeen[index.pSlots[i]] = 1;
+                }
+                free(pSeen);
+            }
+        }
+
+        /* Round trip through a buffer. ns_uint64 so it's aligned. */
+        if (passed) {
+            size_t bufferSize = ns_static_hash_index_get_serialized_size(&index);
+            ns_uint64* pBuffer = (ns_uint64*)malloc(bufferSize);
+            ns_static_hash_index loaded;
+
+            if (pBuffer == NULL) {
+                passed = 0;
+            } else {
+                if (ns_static_hash_index_serialize(&index, pBuffer, bufferSize - 1) != NS_NO_SPACE ||
+                    ns_static_hash_index_serialize(&index, pBuffer, bufferSize) != NS_SUCCESS ||
+                    ns_static_hash_index_init_from_buffer(pBuffer, bufferSize - 1, pKeys, count, sizeof(*pKeys), test_hash_u32, test_compare_u32, NULL, &loaded) != NS_INVALID_FILE ||
+                    ns_static_hash_index_init_from_buffer(pBuffer, bufferSize, pKeys, count + 4, sizeof(*pKeys), test_hash_u32, test_compare_u32, NULL, &loaded) != NS_INVALID_FILE ||
+                    (count > 0 && !test_static_hash_index_rejects_bad_slot(pBuffer, bufferSize, pKeys, count)) ||
+                    ns_static_hash_index_init_from_buffer(pBuffer, bufferSize, pKeys, count, sizeof(*pKeys), test_hash_u32, test_compare_u32, NULL, &loaded) != NS_SUCCESS) {
+                    printf("ns_static_hash_index_serialize() FAILED with count %u\n", (unsigned int)count);
+                    passed = 0;
+                } else {
+                    for (i = 0; i < count; i += 1) {
+                        if (ns_static_hash_index_find(&loaded, &pKeys[i]) != &pKeys[i]) {
+                            printf("ns_static_hash_index_init_from_buffer() FAILED for key %u with count %u\n", (unsigned int)pKeys[i], (unsigned int)count);
+                            passed = 0;
+                            break;
+                        }
+                    }
+
+                    ns_static_hash_index_uninit(&loaded);
+                }
+
+                free(pBuffer);
+            }
+        }
+
+        ns_static_hash_index_uninit(&index);
+    }
+
+    /* Strings, where the key is a copy so it's the comparison that matters and not the address. */
+    if (passed) {
+        const char* list[] = {"date", "apple", "cherry", "banana", "elderberry"};
+        char copy[] = "cherry";
+        const char* key = copy;
+        const char* miss = "fig";
+
+        if (ns_static_hash_index_init(list, 5, sizeof(*list), test_hash_string, test_compare_string_ptrs, NULL, NULL, &index) != NS_SUCCESS) {
+            printf("ns_static_hash_index_init() FAILED with strings\n");
+            passed = 0;
+        } else {
+            if (ns_static_hash_index_find(&index, &key) != &list[2] || ns_static_hash_index_find(&index, &miss) != NULL) {
+                printf("ns_static_hash_index_find() FAILED with strings\n");
+                passed = 0;
+            }
+
+            ns_static_hash_index_uninit(&index);
+        }
+    }
+
+    /* Duplicates can't be told apart. */
+    if (passed) {
+        pKeys[0] = 10;
+        pKeys[1] = 20;
+        pKeys[2] = 10;
+
+        if (ns_static_hash_index_init(pKeys, 3, sizeof(*pKeys), test_hash_u32, test_compare_u32, NULL, NULL, &index) != NS_ALREADY_EXISTS || index.pAllocation != NULL) {
+            printf("ns_static_hash_index_init() FAILED to report duplicates\n");
+            passed = 0;
+        }
+    }
+
+    /* A failed allocation should leave nothing to free. */
+    if (passed) {
+        failingCallbacks.pUserData = NULL;
+        failingCallbacks.onMalloc  = test_failing_malloc;
+        failingCallbacks.onRealloc = NULL;
+        failingCallbacks.onFree    = NULL;
+
+        if (ns_static_hash_index_init(pKeys, 100, sizeof(*pKeys), test_hash_u32, test_compare_u32, NULL, &failingCallbacks, &index) != NS_OUT_OF_MEMORY || index.pAllocation != NULL) {
+            printf("ns_static_hash_index_init() FAILED to report out of memory\n");
+            passed = 0;
+        }
+    }
+
+    free(pKeys);
+
+    if (passed) {
+        printf("ns_static_hash_index PASSED\n");
+    }
+
+    return passed;
+}
+
+/*
+Puts the key at every position in arrays of every size up to 200, with a second copy further on, and checks the first one is
+found. The arrays start one element in so the loads are unaligned.
+*/
+#define TEST_LINEAR_SEARCH(T, searchProc, filler, key) \
+    { \
+        T list[201]; \
+        size_t count; \
+\
+        for (count = 0; count <= 200 && passed; count += 1) { \
+            size_t position; \
+\
+            for (position = 0; position <= count; position += 1) { \
+                size_t i; \
+\
+                for (i = 0; i < count; i += 1) { \
+                    list[1 + i] = (filler); \
+                } \
+                if (position < count) { \
+                    list[1 + position] = (key); \
+                    if (position + 3 < count) { \
+                        list[1 + position + 3] = (key); \
+                    } \
+                } \
+\
+                if (searchProc(list + 1, count, (key)) != position) { \
+                    printf(#searchProc "() FAILED at position %u with count %u\n", (unsigned int)position, (unsigned int)count); \
+                    passed = 0; \
+                    break; \
+                } \
+            } \
+        } \
+    }
+
+static int test_linear_search_typed(void)
+{
+    int passed = 1;
+
+    /* The fillers differ from the key in only some of their bytes, or only one half for ns_uint64, to catch partial matches. */
+    TEST_LINEAR_SEARCH(ns_uint8,  ns_linear_search_u8,  (ns_uint8)(i % 200),            (ns_uint8)201)
+    TEST_LINEAR_SEARCH(ns_uint16, ns_linear_search_u16, (ns_uint16)(0x1200 + (i & 0xFF)), (ns_uint16)0x12FF)
+    TEST_LINEAR_SEARCH(ns_uint32, ns_linear_search_u32, (ns_uint32)i,                    (ns_uint32)0x10000)
+    TEST_LINEAR_SEARCH(ns_uint64, ns_linear_search_u64, ((ns_uint64)i << 32) | 0xABCD,    ((ns_uint64)0xABCD << 32) | 0xABCD)
+    TEST_LINEAR_SEARCH(float,     ns_linear_search_f32, (float)i + 0.5f,                 -0.0f)
+
+    /* Floats compare with ==. */
+    if (passed) {
+        float list[40];
+        size_t i;
+
+        for (i = 0; i < 40; i += 1) {
+            list[i] = (float)i + 1;
+        }
+        list[33] = 0.0f;
+
+        if (ns_linear_search_f32(list, 40, -0.0f) != 33) {
+            printf("ns_linear_search_f32() FAILED to match -0.0 with +0.0\n");
+            passed = 0;
+        }
+
+        list[20] = list[33] / list[33];     /* NaN. Computed at runtime so the compiler doesn't complain. */
+        if (ns_linear_search_f32(list, 40, list[20]) != 40) {
+            printf("ns_linear_search_f32() FAILED by matching NaN\n");
+            passed = 0;
+        }
+    }
+
+    if (passed) {
+        printf("ns_linear_search_u8/u16/u32/u64/f32() PASSED\n");
+    }
+
+    return passed;
+}
+
+/*
+Measures an int comparator and checks the thresholds and costs are sane, that ns_sorted_search_tuned() finds the same elements as
+ns_binary_search(), and that a comparator without an entry falls back to ns_sorted_search() without adding one. The thresholds depend
+on the machine so they're printed rather than checked against expected values.
+*/
+static int test_search_tuner(void)
+{
+    static int list[2000];
+    static char strings[100][8];
+    const char* stringList[100];
+    ns_search_tuner tuner;
+    const ns_search_tuning* pTuning;
+    size_t count;
+    size_t i;
+    int key;
+
+    for (i = 0; i < 2000; i += 1) {
+        list[i] = (int)i * 2;
+    }
+
+    ns_search_tuner_init(&tuner);
+
+    if (ns_search_tuner_measure(&tuner, NULL, 0, 0, list, 2000, sizeof(int), compare_int, NULL, &pTuning) != NS_SUCCESS || pTuning == NULL) {
+        printf("ns_search_tuner_measure() FAILED\n");
+        return 0;
+    }
+
+    if (pTuning->measuredSizeCount != NS_SEARCH_TUNER_MAX_SIZES || pTuning->linearThreshold < 2 || pTuning->linearThreshold > 1025 || pTuning->branchlessThreshold > 1025 || ns_search_tuner_get(&tuner, sizeof(int), compare_int) != pTuning) {
+        printf("ns_search_tuner_measure() FAILED with bad thresholds\n");
+        return 0;
+    }
+
+    for (i = 0; i < pTuning->measuredSizeCount; i += 1) {
+        if (!(pTuning->linearCosts[i] > 0) || !(pTuning->binaryCosts[i] > 0) || !(pTuning->branchlessCosts[i] > 0)) {
+            printf("ns_search_tuner_measure() FAILED with bad costs\n");
+            return 0;
+        }
+    }
+
+    printf("ns_search_tuner: linear below %u, branchless from %u. Nanoseconds per search (linear/binary/branchless):", (unsigned int)pTuning->linearThreshold, (unsigned int)pTuning->branchlessThreshold);
+    for (i = 0; i < pTuning->measuredSizeCount; i += 1) {
+        printf(" %u: %.0f/%.0f/%.0f", (unsigned int)pTuning->measuredSizes[i], pTuning->linearCosts[i], pTuning->binaryCosts[i], pTuning->branchlessCosts[i]);
+    }
+    printf("\n");
+
+    /* Pinned thresholds that force every path. */
+    for (i = 0; i < 3; i += 1) {
+        if (i == 1 && ns_search_tuner_set(&tuner, sizeof(int), compare_int, 20, 60) != NS_SUCCESS) {
+            printf("ns_search_tuner_set() FAILED\n");
+            return 0;
+        }
+
+        for (count = 0; count <= 100; count += 1) {
+            for (key = -1; key <= (int)count * 2; key += 1) {
+                const int* pExpected = (const int*)ns_binary_search(&key, list, count, sizeof(int), compare_int, NULL);
+                const int* pResult   = (const int*)ns_sorted_search_tuned((i == 2) ? NULL : &tuner, &key, list, count, sizeof(int), compare_int, NULL);
+
+                if (pExpected != pResult) {
+                    printf("ns_sorted_search_tuned() FAILED for key %d with count %u\n", key, (unsigned int)count);
+                    return 0;
+                }
+            }
+        }
+    }
+
+    /* Without an entry for the stride and comparator, searching works like ns_sorted_search() and doesn't measure anything. */
+    for (i = 0; i < 100; i += 1) {
+        strings[i][0] = (char)('a' + i / 10);
+        strings[i][1] = (char)('a' + i % 10);
+        strings[i][2] = '\0';
+        stringList[i] = strings[i];
+    }
+
+    if (ns_sorted_search_tuned(&tuner, "hd", stringList, 100, sizeof(const char*), compare_strings, NULL) != &stringList[73] || ns_search_tuner_get(&tuner, sizeof(const char*), compare_strings) != NULL || tuner.entryCount != 1) {
+        printf("ns_sorted_search_tuned() FAILED without an entry\n");
+        return 0;
+    }
+
+    /* Once full, pinning something new fails but searching still works. */
+    while (tuner.entryCount < NS_SEARCH_TUNER_MAX_ENTRIES) {
+        ns_search_tuner_set(&tuner, 1000 + tuner.entryCount, compare_int, 10, 32);
+    }
+
+    if (ns_search_tuner_set(&tuner, 3, compare_int, 10, 32) != NS_NO_SPACE || ns_sorted_search_tuned(&tuner, &list[10], list, 1000, sizeof(int) * 2, compare_int, NULL) != &list[10]) {
+        printf("ns_search_tuner FAILED when full\n");
+        return 0;
+    }
+
+    printf("ns_search_tuner PASSED\n");
+    return 1;
+}
+
+int main(void)
+{
+    int passed = 1;
+
+    {
+        int arr[] = {1, 2, 3, 4, 5};
+        int key = 4;
+        int* result = (int*)ns_binary_search(&key, arr, 5, sizeof(int), compare_int, NULL);
+        if (result != NULL) {
+            printf("Key found at index %u\n", (unsigned int)(result - arr));
+        } else {
+            printf("Key not found\n");
+        }
+    }
+    
+    {
+        const char* list[] = {"apple", "banana", "cherry", "date"};
+        const char* key = "cherry";
+        const char** result = (const char**)ns_binary_search(key, list, 4, sizeof(char*), compare_strings, NULL);
+        if (result != NULL) {
+          printf("String found at index %u\n", (unsigned int)(result - list));
+        } else {
+          printf("String not found\n");
+        }
+    }
+
+    passed = test_binary_search_branchless() && passed;
+    passed = test_bounds() && passed;
+    passed = test_gallop_search() && passed;
+    passed = test_binary_search_batch() && passed;
+    passed = test_interpolation_search() && passed;
+    passed = test_eytzinger() && passed;
+    passed = test_static_btree() && passed;
+    passed = test_static_hash_index() && passed;
+    passed = test_linear_search_typed() && passed;
+    passed = test_search_tuner() && passed;
+
+    return passed ? 0 : 1;
 }
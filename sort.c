@@ -1,8 +1,16 @@
 /*
-A simple generic insert sort. Nothing special going on here. You will most likely want to build something more
-specialised if you need something high performance. Will add to this as demanded by my own requirements.
+A generic sort for arrays of arbitrarily sized elements. Elements are compared with a callback and moved around with memcpy(),
+so it works with any stride. You will most likely want to build something more specialised if you need every last bit of
+performance, but this should be good enough for most things. Will add to this as demanded by my own requirements.
+
+ns_sort() is a pattern-defeating quicksort (pdqsort) which is an introsort variant. It uses a median-of-three pivot, or a
+ninther (pseudo median of nine) for larger partitions, a branchless block partition to avoid branch mispredictions on the
+comparison result, and a heapsort fallback if too many bad partitions are encountered which means it's O(n log n) in the worst
+case. Insertion sort is used for small partitions. Sorted, reversed and many-duplicate inputs are all handled in linear or
+close to linear time. Note that the sort is not stable.
 */
 #include <stddef.h> /* for size_t */
+#include <string.h> /* for memcpy, memmove */
 
 #ifndef NS_API
 #define NS_API
@@ -12,49 +20,8266 @@ specialised if you need something high performance. Will add to this as demanded
 #define NS_INLINE
 #endif
 
+/* The sort_bench build counts every byte moved by the sorts. See the benchmark at the bottom of this file. */
+#if defined(NS_SORT_BENCHMARK)
+static int    g_benchCounting   = 0;
+static size_t g_benchBytesMoved = 0;
+#define NS_COPY_MEMORY(dst, src, sz) ((void)(g_benchCounting && (g_benchBytesMoved += (sz))), memcpy((dst), (src), (sz)))
+#define NS_MOVE_MEMORY(dst, src, sz) ((void)(g_benchCounting && (g_benchBytesMoved += (sz))), memmove((dst), (src), (sz)))
+#endif
+
+#ifndef NS_COPY_MEMORY
+#define NS_COPY_MEMORY(dst, src, sz) memcpy((dst), (src), (sz))
+#endif
+
+#ifndef NS_MOVE_MEMORY
+#define NS_MOVE_MEMORY(dst, src, sz) memmove((dst), (src), (sz))
+#endif
+
+#ifndef NS_ZERO_MEMORY
+#define NS_ZERO_MEMORY(p, sz) memset((p), 0, (sz))
+#endif
+
+#ifndef NS_UNUSED
+#define NS_UNUSED(x) (void)(x)
+#endif
+
+/* BEG sized_types.h */
+#include <stddef.h> /* For size_t. */
+
+#if defined(SIZE_MAX)
+    #define NS_SIZE_MAX     SIZE_MAX
+#else
+    #define NS_SIZE_MAX     0xFFFFFFFF  /* When SIZE_MAX is not defined by the standard library just default to the maximum 32-bit unsigned integer. */
+#endif
+
+#if defined(__LP64__) || defined(_WIN64) || (defined(__x86_64__) && !defined(__ILP32__)) || defined(_M_X64) || defined(__ia64) || defined(_M_IA64) || defined(__aarch64__) || defined(_M_ARM64) || defined(__powerpc64__)
+    #define NS_SIZEOF_PTR   8
+#else
+    #define NS_SIZEOF_PTR   4
+#endif
+
+#if defined(NS_USE_STDINT)
+    #include <stdint.h>
+    typedef int8_t                  ns_int8;
+    typedef uint8_t                 ns_uint8;
+    typedef int16_t                 ns_int16;
+    typedef uint16_t                ns_uint16;
+    typedef int32_t                 ns_int32;
+    typedef uint32_t                ns_uint32;
+    typedef int64_t                 ns_int64;
+    typedef uint64_t                ns_uint64;
+#else
+    typedef   signed char           ns_int8;
+    typedef unsigned char           ns_uint8;
+    typedef   signed short          ns_int16;
+    typedef unsigned short          ns_uint16;
+    typedef   signed int            ns_int32;
+    typedef unsigned int            ns_uint32;
+    #if defined(_MSC_VER) && !defined(__clang__)
+        typedef   signed __int64    ns_int64;
+        typedef unsigned __int64    ns_uint64;
+    #else
+        #if defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 6)))
+            #pragma GCC diagnostic push
+            #pragma GCC diagnostic ignored "-Wlong-long"
+            #if defined(__clang__)
+                #pragma GCC diagnostic ignored "-Wc++11-long-long"
+            #endif
+        #endif
+        typedef   signed long long  ns_int64;
+        typedef unsigned long long  ns_uint64;
+        #if defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 6)))
+            #pragma GCC diagnostic pop
+        #endif
+    #endif
+#endif  /* NS_USE_STDINT */
+
+#if NS_SIZEOF_PTR == 8
+    typedef ns_uint64 ns_uintptr;
+    typedef ns_int64  ns_intptr;
+#else
+    typedef ns_uint32 ns_uintptr;
+    typedef ns_int32  ns_intptr;
+#endif
+
+typedef unsigned char ns_bool8;
+typedef unsigned int  ns_bool32;
+#define NS_TRUE  1
+#define NS_FALSE 0
+
+#define NS_INT8_MIN   ((ns_int8 )0x80)
+#define NS_UINT8_MIN  ((ns_uint8)0x00)
+#define NS_INT16_MIN  ((ns_int16)0x8000)
+#define NS_UINT16_MIN ((ns_uint16)0x0000)
+#define NS_INT32_MIN  ((ns_int32 )0x80000000)
+#define NS_UINT32_MIN ((ns_uint32)0x00000000)
+#define NS_INT64_MIN  ((ns_int64 )(((ns_uint64)0x80000000 << 32) | 0x00000000))
+#define NS_UINT64_MIN ((ns_uint64)(((ns_uint64)0x00000000 << 32) | 0x00000000))
+
+#define NS_INT8_MAX   ((ns_int8 )0x7F)
+#define NS_UINT8_MAX  ((ns_uint8)0xFF)
+#define NS_INT16_MAX  ((ns_int16)0x7FFF)
+#define NS_UINT16_MAX ((ns_uint16)0xFFFF)
+#define NS_INT32_MAX  ((ns_int32 )0x7FFFFFFF)
+#define NS_UINT32_MAX ((ns_uint32)0xFFFFFFFF)
+#define NS_INT64_MAX  ((ns_int64 )(((ns_uint64)0x7FFFFFFF << 32) | 0xFFFFFFFF))
+#define NS_UINT64_MAX ((ns_uint64)(((ns_uint64)0xFFFFFFFF << 32) | 0xFFFFFFFF))
+/* END sized_types.h */
+
+/* BEG result.h */
+typedef enum
+{
+    NS_SUCCESS                       =  0,
+    NS_ERROR                         = -1,  /* Generic, unknown error. */
+    NS_INVALID_ARGS                  = -2,
+    NS_INVALID_OPERATION             = -3,
+    NS_OUT_OF_MEMORY                 = -4,
+    NS_OUT_OF_RANGE                  = -5,
+    NS_ACCESS_DENIED                 = -6,
+    NS_DOES_NOT_EXIST                = -7,
+    NS_ALREADY_EXISTS                = -8,
+    NS_TOO_MANY_OPEN_FILES           = -9,
+    NS_INVALID_FILE                  = -10,
+    NS_TOO_BIG                       = -11,
+    NS_PATH_TOO_LONG                 = -12,
+    NS_NAME_TOO_LONG                 = -13,
+    NS_NOT_DIRECTORY                 = -14,
+    NS_IS_DIRECTORY                  = -15,
+    NS_DIRECTORY_NOT_EMPTY           = -16,
+    NS_AT_END                        = -17,
+    NS_NO_SPACE                      = -18,
+    NS_BUSY                          = -19,
+    NS_IO_ERROR                      = -20,
+    NS_INTERRUPT                     = -21,
+    NS_UNAVAILABLE                   = -22,
+    NS_ALREADY_IN_USE                = -23,
+    NS_BAD_ADDRESS                   = -24,
+    NS_BAD_SEEK                      = -25,
+    NS_BAD_PIPE                      = -26,
+    NS_DEADLOCK                      = -27,
+    NS_TOO_MANY_LINKS                = -28,
+    NS_NOT_IMPLEMENTED               = -29,
+    NS_NO_MESSAGE                    = -30,
+    NS_BAD_MESSAGE                   = -31,
+    NS_NO_DATA_AVAILABLE             = -32,
+    NS_INVALID_DATA                  = -33,
+    NS_TIMEOUT                       = -34,
+    NS_NO_NETWORK                    = -35,
+    NS_NOT_UNIQUE                    = -36,
+    NS_NOT_SOCKET                    = -37,
+    NS_NO_ADDRESS                    = -38,
+    NS_BAD_PROTOCOL                  = -39,
+    NS_PROTOCOL_UNAVAILABLE          = -40,
+    NS_PROTOCOL_NOT_SUPPORTED        = -41,
+    NS_PROTOCOL_FAMILY_NOT_SUPPORTED = -42,
+    NS_ADDRESS_FAMILY_NOT_SUPPORTED  = -43,
+    NS_SOCKET_NOT_SUPPORTED          = -44,
+    NS_CONNECTION_RESET              = -45,
+    NS_ALREADY_CONNECTED             = -46,
+    NS_NOT_CONNECTED                 = -47,
+    NS_CONNECTION_REFUSED            = -48,
+    NS_NO_HOST                       = -49,
+    NS_IN_PROGRESS                   = -50,
+    NS_CANCELLED                     = -51,
+    NS_MEMORY_ALREADY_MAPPED         = -52,
+    NS_DIFFERENT_DEVICE              = -53,
+    NS_CHECKSUM_MISMATCH             = -100,
+    NS_NO_BACKEND                    = -101,
+
+    /* Non-Error Result Codes. */
+    NS_NEEDS_MORE_INPUT              = 100, /* Some stream needs more input data before it can be processed. */
+    NS_HAS_MORE_OUTPUT               = 102  /* Some stream has more output data to be read, but there's not enough room in the output buffer. */
+} ns_result;
+/* END result.h */
+
+/* BEG result_from_errno.h */
+NS_API ns_result ns_result_from_errno(int error);
+/* END result_from_errno.h */
+
+/* BEG allocation_callbacks.h */
+typedef struct ns_allocation_callbacks
+{
+    void* pUserData;
+    void* (* onMalloc )(size_t sz, void* pUserData);
+    void* (* onRealloc)(void* p, size_t sz, void* pUserData);
+    void  (* onFree   )(void* p, void* pUserData);
+} ns_allocation_callbacks;
+
+NS_API void* ns_malloc(size_t sz, const ns_allocation_callbacks* pAllocationCallbacks);
+NS_API void* ns_calloc(size_t sz, const ns_allocation_callbacks* pAllocationCallbacks);
+NS_API void* ns_realloc(void* p, size_t sz, const ns_allocation_callbacks* pAllocationCallbacks);
+NS_API void  ns_free(void* p, const ns_allocation_callbacks* pAllocationCallbacks);
+NS_API void* ns_aligned_malloc(size_t sz, size_t alignment, const ns_allocation_callbacks* pAllocationCallbacks);
+NS_API void* ns_aligned_realloc(void* p, size_t sz, size_t alignment, const ns_allocation_callbacks* pAllocationCallbacks);
+NS_API void  ns_aligned_free(void* p, const ns_allocation_callbacks* pAllocationCallbacks);
+/* END allocation_callbacks.h */
+
 /* BEG sort.h */
 NS_API void ns_sort(void* pBase, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData);
 /* END sort.h */
 
-/* BEG sort.c */
-NS_API void ns_sort(void* pBase, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData)
+/* BEG sort_stable.h */
+NS_API void ns_sort_stable(void* pBase, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData, const ns_allocation_callbacks* pAllocationCallbacks);
+/* END sort_stable.h */
+
+/* BEG sort_parallel.h */
+NS_API void ns_sort_parallel(void* pBase, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData, size_t threadCount, const ns_allocation_callbacks* pAllocationCallbacks);
+/* END sort_parallel.h */
+
+/* BEG argsort.h */
+NS_API void ns_argsort(const void* pBase, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData, size_t* pIndices);
+NS_API void ns_argsort_u32(const void* pBase, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData, ns_uint32* pIndices);
+NS_API void ns_sort_indirect(void* pBase, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData, const ns_allocation_callbacks* pAllocationCallbacks);
+/* END argsort.h */
+
+/* BEG sort_soa.h */
+NS_API ns_result ns_sort_soa(void* pKeys, size_t count, size_t keyStride, int (*compareProc)(void*, const void*, const void*), void* pUserData, void** ppColumns, const size_t* pColumnStrides, size_t columnCount, const ns_allocation_callbacks* pAllocationCallbacks);
+NS_API ns_result ns_sort_soa_u32(void* pKeys, size_t count, size_t keyStride, void** ppColumns, const size_t* pColumnStrides, size_t columnCount, const ns_allocation_callbacks* pAllocationCallbacks);
+NS_API ns_result ns_sort_soa_u64(void* pKeys, size_t count, size_t keyStride, void** ppColumns, const size_t* pColumnStrides, size_t columnCount, const ns_allocation_callbacks* pAllocationCallbacks);
+NS_API ns_result ns_sort_soa_i32(void* pKeys, size_t count, size_t keyStride, void** ppColumns, const size_t* pColumnStrides, size_t columnCount, const ns_allocation_callbacks* pAllocationCallbacks);
+NS_API ns_result ns_sort_soa_i64(void* pKeys, size_t count, size_t keyStride, void** ppColumns, const size_t* pColumnStrides, size_t columnCount, const ns_allocation_callbacks* pAllocationCallbacks);
+NS_API ns_result ns_sort_soa_f32(void* pKeys, size_t count, size_t keyStride, void** ppColumns, const size_t* pColumnStrides, size_t columnCount, const ns_allocation_callbacks* pAllocationCallbacks);
+NS_API ns_result ns_sort_soa_f64(void* pKeys, size_t count, size_t keyStride, void** ppColumns, const size_t* pColumnStrides, size_t columnCount, const ns_allocation_callbacks* pAllocationCallbacks);
+/* END sort_soa.h */
+
+/* BEG select.h */
+NS_API void ns_select_nth(void* pBase, size_t count, size_t stride, size_t nth, int (*compareProc)(void*, const void*, const void*), void* pUserData);
+NS_API void ns_partial_sort(void* pBase, size_t count, size_t stride, size_t k, int (*compareProc)(void*, const void*, const void*), void* pUserData);
+/* END select.h */
+
+/* BEG topk.h */
+typedef struct
 {
-    /* Just a simple insert sort for now. Will improve on this later. */
-    size_t i;
-    size_t j;
+    char* pHeap;
+    size_t capacity;
+    size_t count;
+    size_t stride;
+    int (* compareProc)(void*, const void*, const void*);
+    void* pUserData;
+    ns_allocation_callbacks allocationCallbacks;
+} ns_topk;
 
-    for (i = 1; i < count; i += 1) {
-        for (j = i; j > 0; j -= 1) {
-            void* pA = (char*)pBase + (j - 1) * stride;
-            void* pB = (char*)pBase + j * stride;
+NS_API ns_result ns_topk_init(size_t k, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData, const ns_allocation_callbacks* pAllocationCallbacks, ns_topk* pTopK);
+NS_API void ns_topk_uninit(ns_topk* pTopK);
+NS_API void ns_topk_reset(ns_topk* pTopK);
+NS_API void ns_topk_push(ns_topk* pTopK, const void* pRecords, size_t count);
+NS_API size_t ns_topk_get(const ns_topk* pTopK, void* pOut);
+/* END topk.h */
 
-            if (compareProc(pUserData, pA, pB) <= 0) {
-                break;
-            }
+/* BEG merge_k.h */
+NS_API ns_result ns_merge_k(const void** ppRuns, const size_t* pCounts, size_t runCount, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData, void* pOut, const ns_allocation_callbacks* pAllocationCallbacks);
+NS_API ns_result ns_merge_k_unique(const void** ppRuns, const size_t* pCounts, size_t runCount, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData, void* pOut, size_t* pOutCount, const ns_allocation_callbacks* pAllocationCallbacks);
+/* END merge_k.h */
 
-            /* Swap. */
-            {
-                size_t k;
-                char* a = (char*)pA;
-                char* b = (char*)pB;
-                
-                for (k = 0; k < stride; k += 1) {
-                    char temp = *a;
-                    *a++ = *b;
-                    *b++ = temp;
-                }
-            }
+/* BEG sorted_array.h */
+typedef struct
+{
+    char* pData;                /* The sorted records. Only includes pending changes after ns_sorted_array_flush(). */
+    size_t count;
+    size_t capacity;
+    char* pDelta;               /* Pending inserts and erases, in the order they were made. */
+    unsigned char* pDeltaOps;
+    size_t* pDeltaIndices;      /* Scratch space for sorting the delta when it's merged. */
+    size_t deltaCount;
+    size_t deltaCapacity;
+    int autoDeltaCapacity;
+    size_t stride;
+    int (* compareProc)(void*, const void*, const void*);
+    void* pUserData;
+    ns_allocation_callbacks allocationCallbacks;
+} ns_sorted_array;
+
+NS_API ns_result ns_sorted_array_init(size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData, size_t deltaCapacity, const ns_allocation_callbacks* pAllocationCallbacks, ns_sorted_array* pArray);
+NS_API void ns_sorted_array_uninit(ns_sorted_array* pArray);
+NS_API ns_result ns_sorted_array_insert(ns_sorted_array* pArray, const void* pRecords, size_t count);
+NS_API ns_result ns_sorted_array_erase(ns_sorted_array* pArray, const void* pKeys, size_t count);
+NS_API void* ns_sorted_array_find(const ns_sorted_array* pArray, const void* pKey);
+NS_API ns_result ns_sorted_array_flush(ns_sorted_array* pArray);
+/* END sorted_array.h */
+
+/* BEG external_sort.h */
+#include <stdio.h> /* For FILE. */
+
+typedef struct
+{
+    size_t stride;
+    int (* compareProc)(void*, const void*, const void*);
+    void* pUserData;
+    size_t memoryBudget;            /* In bytes. This is the total amount of memory used for sorting runs and for merge buffers. */
+    const char* pTempDirectory;     /* Where runs are spilled to. When NULL, tmpfile() is used. */
+} ns_external_sort_config;
+
+NS_API ns_external_sort_config ns_external_sort_config_init(size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData);
+NS_API ns_result ns_external_sort(const ns_external_sort_config* pConfig, FILE* pInput, FILE* pOutput, const ns_allocation_callbacks* pAllocationCallbacks);
+NS_API ns_result ns_external_sort_file(const ns_external_sort_config* pConfig, const char* pInputFilePath, const char* pOutputFilePath, const ns_allocation_callbacks* pAllocationCallbacks);
+/* END external_sort.h */
+
+/* BEG sort_strings.h */
+NS_API void ns_sort_strings(const char** ppStrings, size_t count, size_t* pLCP, const ns_allocation_callbacks* pAllocationCallbacks);
+NS_API void ns_sort_strings_by_key(void* pBase, size_t count, size_t stride, size_t keyOffset, size_t* pLCP, const ns_allocation_callbacks* pAllocationCallbacks);
+/* END sort_strings.h */
+
+/* BEG radix_sort.h */
+NS_API void ns_radix_sort_u32(void* pBase, size_t count, size_t stride, size_t keyOffset, const ns_allocation_callbacks* pAllocationCallbacks);
+NS_API void ns_radix_sort_u64(void* pBase, size_t count, size_t stride, size_t keyOffset, const ns_allocation_callbacks* pAllocationCallbacks);
+NS_API void ns_radix_sort_i32(void* pBase, size_t count, size_t stride, size_t keyOffset, const ns_allocation_callbacks* pAllocationCallbacks);
+NS_API void ns_radix_sort_i64(void* pBase, size_t count, size_t stride, size_t keyOffset, const ns_allocation_callbacks* pAllocationCallbacks);
+NS_API void ns_radix_sort_f32(void* pBase, size_t count, size_t stride, size_t keyOffset, const ns_allocation_callbacks* pAllocationCallbacks);
+NS_API void ns_radix_sort_f64(void* pBase, size_t count, size_t stride, size_t keyOffset, const ns_allocation_callbacks* pAllocationCallbacks);
+/* END radix_sort.h */
+
+/* BEG sort_small.h */
+typedef struct
+{
+    ns_uint32 key;
+    ns_uint32 value;
+} ns_key_value_u32;
+
+NS_API void ns_sort_small_i32(ns_int32* pData, size_t count);
+NS_API void ns_sort_small_u32(ns_uint32* pData, size_t count);
+NS_API void ns_sort_small_f32(float* pData, size_t count);
+NS_API void ns_sort_small_kv_u32(ns_key_value_u32* pData, size_t count);
+NS_API void ns_sort_i32(ns_int32* pData, size_t count);
+NS_API void ns_sort_u32(ns_uint32* pData, size_t count);
+NS_API void ns_sort_f32(float* pData, size_t count);
+NS_API void ns_sort_kv_u32(ns_key_value_u32* pData, size_t count);
+/* END sort_small.h */
+
+/* BEG sort_define.h */
+/*
+NS_SORT_DEFINE(name, T, LESS) generates a sort specialized for elements of type T:
+
+    static void name(T* pBase, size_t count);
+
+LESS must be a function-like macro or a function taking two elements of type T and returning non-zero if the first should be
+ordered before the second. Because the element type and comparison are known at compile time, comparisons are inlined and
+elements are moved with plain assignments instead of going through a function pointer and memcpy(). This lets the compiler unroll
+and vectorize which ns_sort() can't do. Use ns_sort() for anything where the element type isn't known at compile time.
+
+    #define MY_LESS(a, b) ((a).key < (b).key)
+    NS_SORT_DEFINE(my_sort_records, my_record, MY_LESS)
+
+    my_sort_records(pRecords, recordCount);
+
+The algorithm is the same pattern-defeating quicksort as ns_sort(), including the branchless block partition, which matters even
+more here since cheap inlined comparisons make branch mispredictions the dominant cost. The sort is not stable.
+
+NS_SORT_DEFINE_EX(name, T, LESS, SMALL_SORT, SMALL_SORT_THRESHOLD) is the same thing except partitions with fewer than
+SMALL_SORT_THRESHOLD elements are handed to SMALL_SORT(T* pBase, size_t count) instead of an insertion sort. Use this to plug in
+something like a sorting network for the base case.
+*/
+#define NS_SORT_DEFINE(name, T, LESS) \
+    NS_SORT_DEFINE_INSERTION(name, T, LESS) \
+    NS_SORT_DEFINE_EX(name, T, LESS, name##_insertion, 24)  /* Same threshold as ns_sort(). */
+
+#define NS_SORT_DEFINE_INSERTION(name, T, LESS) \
+static void name##_insertion(T* pBase, size_t count) \
+{ \
+    T* pBegin = pBase; \
+    T* pEnd = pBase + count; \
+    T* pCur; \
+\
+    if (count < 2) { \
+        return; \
+    } \
+\
+    for (pCur = pBegin + 1; pCur < pEnd; pCur += 1) { \
+        T* pSift = pCur; \
+        T temp = pCur[0]; \
+\
+        while (pSift > pBegin && LESS(temp, pSift[-1])) { \
+            pSift[0] = pSift[-1]; \
+            pSift -= 1; \
+        } \
+\
+        pSift[0] = temp; \
+    } \
+}
+
+#define NS_SORT_DEFINE_EX(name, T, LESS, SMALL_SORT, SMALL_SORT_THRESHOLD) \
+static int name##_partial_insertion(T* pBegin, T* pEnd) \
+{ \
+    T* pCur; \
+    size_t limit = 0; \
+\
+    for (pCur = pBegin + 1; pCur < pEnd; pCur += 1) { \
+        T* pSift = pCur; \
+        T temp = pCur[0]; \
+\
+        while (pSift > pBegin && LESS(temp, pSift[-1])) { \
+            pSift[0] = pSift[-1]; \
+            pSift -= 1; \
+        } \
+\
+        pSift[0] = temp; \
+\
+        limit += (size_t)(pCur - pSift); \
+        if (limit > 8) { \
+            return 0; \
+        } \
+    } \
+\
+    return 1; \
+} \
+\
+static void name##_swap(T* pA, T* pB) \
+{ \
+    T temp = pA[0]; \
+    pA[0] = pB[0]; \
+    pB[0] = temp; \
+} \
+\
+static void name##_sort2(T* pA, T* pB) \
+{ \
+    if (LESS(pB[0], pA[0])) { \
+        name##_swap(pA, pB); \
+    } \
+} \
+\
+static void name##_sort3(T* pA, T* pB, T* pC) \
+{ \
+    name##_sort2(pA, pB); \
+    name##_sort2(pB, pC); \
+    name##_sort2(pA, pB); \
+} \
+\
+static void name##_sift_down(T* pBase, size_t root, size_t count) \
+{ \
+    for (;;) { \
+        size_t child = root*2 + 1; \
+        if (child >= count) { \
+            break; \
+        } \
+\
+        if (child + 1 < count && LESS(pBase[child], pBase[child + 1])) { \
+            child += 1; \
+        } \
+\
+        if (!LESS(pBase[root], pBase[child])) { \
+            break; \
+        } \
+\
+        name##_swap(&pBase[root], &pBase[child]); \
+        root = child; \
+    } \
+} \
+\
+static void name##_heapsort(T* pBase, size_t count) \
+{ \
+    size_t i; \
+\
+    for (i = count/2; i > 0; i -= 1) { \
+        name##_sift_down(pBase, i - 1, count); \
+    } \
+\
+    for (i = count - 1; i > 0; i -= 1) { \
+        name##_swap(&pBase[0], &pBase[i]); \
+        name##_sift_down(pBase, 0, i); \
+    } \
+} \
+\
+static T* name##_partition_right(T* pBegin, T* pEnd, int* pAlreadyPartitioned) \
+{ \
+    T pivot = pBegin[0]; \
+    T* pFirst = pBegin; \
+    T* pLast  = pEnd; \
+\
+    do { \
+        pFirst += 1; \
+    } while (LESS(pFirst[0], pivot)); \
+\
+    if (pFirst - 1 == pBegin) { \
+        while (pFirst < pLast) { \
+            pLast -= 1; \
+            if (LESS(pLast[0], pivot)) { \
+                break; \
+            } \
+        } \
+    } else { \
+        do { \
+            pLast -= 1; \
+        } while (!LESS(pLast[0], pivot)); \
+    } \
+\
+    *pAlreadyPartitioned = pFirst >= pLast; \
+\
+    if (!*pAlreadyPartitioned) { \
+        unsigned char offsetsL[64]; \
+        unsigned char offsetsR[64]; \
+        T* pOffsetsBaseL; \
+        T* pOffsetsBaseR; \
+        size_t countL = 0; \
+        size_t countR = 0; \
+        size_t startL = 0; \
+        size_t startR = 0; \
+\
+        name##_swap(pFirst, pLast); \
+        pFirst += 1; \
+\
+        pOffsetsBaseL = pFirst; \
+        pOffsetsBaseR = pLast; \
+\
+        while (pFirst < pLast) { \
+            size_t unknownCount = (size_t)(pLast - pFirst); \
+            size_t splitL; \
+            size_t splitR; \
+            size_t swapCount; \
+            size_t i; \
+\
+            if (countL == 0) { \
+                splitL = (countR == 0) ? unknownCount/2 : unknownCount; \
+            } else { \
+                splitL = 0; \
+            } \
+\
+            splitR = (countR == 0) ? (unknownCount - splitL) : 0; \
+\
+            if (splitL > 64) { \
+                splitL = 64; \
+            } \
+            if (splitR > 64) { \
+                splitR = 64; \
+            } \
+\
+            for (i = 0; i < splitL; i += 1) { \
+                offsetsL[countL] = (unsigned char)i; \
+                countL += !LESS(pFirst[0], pivot); \
+                pFirst += 1; \
+            } \
+\
+            for (i = 0; i < splitR; i += 1) { \
+                pLast -= 1; \
+                offsetsR[countR] = (unsigned char)(i + 1); \
+                countR += (LESS(pLast[0], pivot) != 0); \
+            } \
+\
+            swapCount = (countL < countR) ? countL : countR; \
+            for (i = 0; i < swapCount; i += 1) { \
+                name##_swap(pOffsetsBaseL + offsetsL[startL + i], pOffsetsBaseR - offsetsR[startR + i]); \
+            } \
+\
+            countL -= swapCount; \
+            countR -= swapCount; \
+            startL += swapCount; \
+            startR += swapCount; \
+\
+            if (countL == 0) { \
+                startL = 0; \
+                pOffsetsBaseL = pFirst; \
+            } \
+            if (countR == 0) { \
+                startR = 0; \
+                pOffsetsBaseR = pLast; \
+            } \
+        } \
+\
+        if (countL > 0) { \
+            while (countL > 0) { \
+                countL -= 1; \
+                pLast -= 1; \
+                name##_swap(pOffsetsBaseL + offsetsL[startL + countL], pLast); \
+            } \
+            pFirst = pLast; \
+        } \
+        if (countR > 0) { \
+            while (countR > 0) { \
+                countR -= 1; \
+                name##_swap(pOffsetsBaseR - offsetsR[startR + countR], pFirst); \
+                pFirst += 1; \
+            } \
+            pLast = pFirst; \
+        } \
+    } \
+\
+    pFirst -= 1; \
+    pBegin[0] = pFirst[0]; \
+    pFirst[0] = pivot; \
+\
+    return pFirst; \
+} \
+\
+static T* name##_partition_left(T* pBegin, T* pEnd) \
+{ \
+    T pivot = pBegin[0]; \
+    T* pFirst = pBegin; \
+    T* pLast  = pEnd; \
+\
+    do { \
+        pLast -= 1; \
+    } while (LESS(pivot, pLast[0])); \
+\
+    if (pLast + 1 == pEnd) { \
+        while (pFirst < pLast) { \
+            pFirst += 1; \
+            if (LESS(pivot, pFirst[0])) { \
+                break; \
+            } \
+        } \
+    } else { \
+        do { \
+            pFirst += 1; \
+        } while (!LESS(pivot, pFirst[0])); \
+    } \
+\
+    while (pFirst < pLast) { \
+        name##_swap(pFirst, pLast); \
+\
+        do { \
+            pLast -= 1; \
+        } while (LESS(pivot, pLast[0])); \
+\
+        do { \
+            pFirst += 1; \
+        } while (!LESS(pivot, pFirst[0])); \
+    } \
+\
+    pBegin[0] = pLast[0]; \
+    pLast[0]  = pivot; \
+\
+    return pLast; \
+} \
+\
+static void name##_break_patterns(T* pBegin, T* pEnd, size_t count) \
+{ \
+    size_t quarter = count/4; \
+\
+    if (count < 24) { \
+        return; \
+    } \
+\
+    name##_swap(pBegin, pBegin + quarter); \
+    name##_swap(pEnd - 1, pEnd - quarter); \
+\
+    if (count > 128) { \
+        name##_swap(pBegin + 1, pBegin + quarter + 1); \
+        name##_swap(pBegin + 2, pBegin + quarter + 2); \
+        name##_swap(pEnd - 2, pEnd - quarter - 1); \
+        name##_swap(pEnd - 3, pEnd - quarter - 2); \
+    } \
+} \
+\
+static void name##_loop(T* pBegin, T* pEnd, int badAllowed, int leftmost) \
+{ \
+    for (;;) { \
+        size_t count = (size_t)(pEnd - pBegin); \
+        size_t half; \
+        size_t countL; \
+        size_t countR; \
+        T* pPivotPos; \
+        int alreadyPartitioned; \
+\
+        if (count < SMALL_SORT_THRESHOLD) { \
+            SMALL_SORT(pBegin, count); \
+            return; \
+        } \
+\
+        half = count/2; \
+        if (count > 128) { \
+            name##_sort3(pBegin,            pBegin + half,     pEnd - 1); \
+            name##_sort3(pBegin + 1,        pBegin + half - 1, pEnd - 2); \
+            name##_sort3(pBegin + 2,        pBegin + half + 1, pEnd - 3); \
+            name##_sort3(pBegin + half - 1, pBegin + half,     pBegin + half + 1); \
+            name##_swap(pBegin, pBegin + half); \
+        } else { \
+            name##_sort3(pBegin + half, pBegin, pEnd - 1); \
+        } \
+\
+        if (!leftmost && !LESS(pBegin[-1], pBegin[0])) { \
+            pBegin = name##_partition_left(pBegin, pEnd) + 1; \
+            continue; \
+        } \
+\
+        pPivotPos = name##_partition_right(pBegin, pEnd, &alreadyPartitioned); \
+\
+        countL = (size_t)(pPivotPos - pBegin); \
+        countR = (size_t)(pEnd - (pPivotPos + 1)); \
+\
+        if (countL < count/8 || countR < count/8) { \
+            badAllowed -= 1; \
+            if (badAllowed == 0) { \
+                name##_heapsort(pBegin, count); \
+                return; \
+            } \
+\
+            name##_break_patterns(pBegin, pPivotPos, countL); \
+            name##_break_patterns(pPivotPos + 1, pEnd, countR); \
+        } else { \
+            if (alreadyPartitioned && name##_partial_insertion(pBegin, pPivotPos) && name##_partial_insertion(pPivotPos + 1, pEnd)) { \
+                return; \
+            } \
+        } \
+\
+        if (countL < countR) { \
+            name##_loop(pBegin, pPivotPos, badAllowed, leftmost); \
+            pBegin   = pPivotPos + 1; \
+            leftmost = 0; \
+        } else { \
+            name##_loop(pPivotPos + 1, pEnd, badAllowed, 0); \
+            pEnd = pPivotPos; \
+        } \
+    } \
+} \
+\
+static void name(T* pBase, size_t count) \
+{ \
+    int badAllowed = 0; \
+    size_t n; \
+\
+    if (pBase == NULL || count < 2) { \
+        return; \
+    } \
+\
+    for (n = count; n > 1; n >>= 1) { \
+        badAllowed += 1; \
+    } \
+\
+    name##_loop(pBase, pBase + count, badAllowed, 1); \
+}
+/* END sort_define.h */
+
+
+
+/* BEG allocation_callbacks.c */
+#if !defined(NS_MALLOC) || !defined(NS_REALLOC) || !defined(NS_FREE)
+#include <stdlib.h> /* For malloc, realloc, free. */
+#endif
+
+#ifndef NS_MALLOC
+#define NS_MALLOC(sz) malloc(sz)
+#endif
+#ifndef NS_REALLOC
+#define NS_REALLOC(p, sz) realloc(p, sz)
+#endif
+#ifndef NS_FREE
+#define NS_FREE(p) free(p)
+#endif
+
+typedef struct
+{
+    void* pUnaligned;
+    size_t size;
+    size_t alignment;
+} ns_aligned_allocation_header;
+
+static void* ns_malloc_default(size_t sz, void* pUserData)
+{
+    NS_UNUSED(pUserData);
+    return NS_MALLOC(sz);
+}
+
+static void* ns_realloc_default(void* p, size_t sz, void* pUserData)
+{
+    NS_UNUSED(pUserData);
+    return NS_REALLOC(p, sz);
+}
+
+static void ns_free_default(void* p, void* pUserData)
+{
+    NS_UNUSED(pUserData);
+    NS_FREE(p);
+}
+
+
+NS_API ns_allocation_callbacks ns_allocation_callbacks_init_default(void)
+{
+    ns_allocation_callbacks allocationCallbacks;
+
+    allocationCallbacks.pUserData = NULL;
+    allocationCallbacks.onMalloc  = ns_malloc_default;
+    allocationCallbacks.onRealloc = ns_realloc_default;
+    allocationCallbacks.onFree    = ns_free_default;
+
+    return allocationCallbacks;
+}
+
+NS_API ns_allocation_callbacks ns_allocation_callbacks_init_copy(const ns_allocation_callbacks* pAllocationCallbacks)
+{
+    if (pAllocationCallbacks != NULL) {
+        return *pAllocationCallbacks;
+    } else {
+        return ns_allocation_callbacks_init_default();
+    }
+}
+
+
+NS_API void* ns_malloc(size_t sz, const ns_allocation_callbacks* pAllocationCallbacks)
+{
+    if (pAllocationCallbacks != NULL) {
+        if (pAllocationCallbacks->onMalloc != NULL) {
+            return pAllocationCallbacks->onMalloc(sz, pAllocationCallbacks->pUserData);
+        } else {
+            return NULL;    /* Do not fall back to the default implementation. */
         }
+    } else {
+        return ns_malloc_default(sz, NULL);
     }
 }
-/* END sort.c */
 
+NS_API void* ns_calloc(size_t sz, const ns_allocation_callbacks* pAllocationCallbacks)
+{
+    void* p = ns_malloc(sz, pAllocationCallbacks);
+    if (p != NULL) {
+        NS_ZERO_MEMORY(p, sz);
+    }
 
-/* TODO: Implement a proper test. */
-int main(int argc, char** argv)
+    return p;
+}
+
+NS_API void* ns_realloc(void* p, size_t sz, const ns_allocation_callbacks* pAllocationCallbacks)
 {
-    (void)argc;
-    (void)argv;
+    if (pAllocationCallbacks != NULL) {
+        if (pAllocationCallbacks->onRealloc != NULL) {
+            return pAllocationCallbacks->onRealloc(p, sz, pAllocationCallbacks->pUserData);
+        } else {
+            return NULL;    /* Do not fall back to the default implementation. */
+        }
+    } else {
+        return ns_realloc_default(p, sz, NULL);
+    }
+}
+
+NS_API void ns_free(void* p, const ns_allocation_callbacks* pAllocationCallbacks)
+{
+    if (p == NULL) {
+        return;
+    }
+
+    if (pAllocationCallbacks != NULL) {
+        if (pAllocationCallbacks->onFree != NULL) {
+            pAllocationCallbacks->onFree(p, pAllocationCallbacks->pUserData);
+        } else {
+            return; /* Do no fall back to the default implementation. */
+        }
+    } else {
+        ns_free_default(p, NULL);
+    }
+}
+
+NS_API void* ns_aligned_malloc(size_t sz, size_t alignment, const ns_allocation_callbacks* pAllocationCallbacks)
+{
+    size_t extraBytes;
+    void* pUnaligned;
+    void* pAligned;
+    ns_aligned_allocation_header* pHeader;
+
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        return 0;
+    }
+
+    if (alignment - 1 > (size_t)-1 - sizeof(ns_aligned_allocation_header)) {
+        return NULL;
+    }
+
+    extraBytes = alignment-1 + sizeof(ns_aligned_allocation_header);
+
+    if (sz > (size_t)-1 - extraBytes) {
+        return NULL;
+    }
+
+    pUnaligned = ns_malloc(sz + extraBytes, pAllocationCallbacks);
+    if (pUnaligned == NULL) {
+        return NULL;
+    }
+
+    pAligned = (void*)(((ns_uintptr)pUnaligned + extraBytes) & ~((ns_uintptr)(alignment-1)));
+    pHeader = (ns_aligned_allocation_header*)((unsigned char*)pAligned - sizeof(*pHeader));
+    pHeader->pUnaligned = pUnaligned;
+    pHeader->size       = sz;
+    pHeader->alignment  = alignment;
+
+    return pAligned;
+}
+
+NS_API void* ns_aligned_realloc(void* p, size_t sz, size_t alignment, const ns_allocation_callbacks* pAllocationCallbacks)
+{
+    size_t extraBytes;
+    size_t oldAlignmentOffset;
+    size_t oldSize;
+    void* pOldUnaligned;
+    void* pNewUnaligned;
+    void* pNewAligned;
+    ns_aligned_allocation_header* pHeader;
+
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        return 0;
+    }
+
+    if (p == NULL) {
+        return ns_aligned_malloc(sz, alignment, pAllocationCallbacks);
+    }
+
+    pHeader = (ns_aligned_allocation_header*)((unsigned char*)p - sizeof(*pHeader));
+    pOldUnaligned = pHeader->pUnaligned;
+    oldSize = pHeader->size;
+
+    if (alignment != pHeader->alignment) {
+        return NULL;
+    }
+
+    oldAlignmentOffset = (size_t)((unsigned char*)p - (unsigned char*)pOldUnaligned);
+
+    if (alignment - 1 > (size_t)-1 - sizeof(ns_aligned_allocation_header)) {
+        return NULL;
+    }
+
+    extraBytes = alignment-1 + sizeof(ns_aligned_allocation_header);
+
+    if (oldAlignmentOffset > extraBytes) {
+        return NULL;
+    }
+
+    if (sz > (size_t)-1 - extraBytes) {
+        return NULL;
+    }
+
+    pNewUnaligned = ns_realloc(pOldUnaligned, sz + extraBytes, pAllocationCallbacks);
+    if (pNewUnaligned == NULL) {
+        return NULL;
+    }
+
+    pNewAligned = (void*)(((ns_uintptr)pNewUnaligned + extraBytes) & ~((ns_uintptr)(alignment-1)));
+
+    if (pNewAligned != (unsigned char*)pNewUnaligned + oldAlignmentOffset) {
+        void* pDst = pNewAligned;
+        void* pSrc = (unsigned char*)pNewUnaligned + oldAlignmentOffset;
+        NS_MOVE_MEMORY(pDst, pSrc, (oldSize < sz) ? oldSize : sz);
+    }
+
+    pHeader = (ns_aligned_allocation_header*)((unsigned char*)pNewAligned - sizeof(*pHeader));
+    pHeader->pUnaligned = pNewUnaligned;
+    pHeader->size       = sz;
+    pHeader->alignment  = alignment;
+
+    return pNewAligned;
+}
+
+NS_API void ns_aligned_free(void* p, const ns_allocation_callbacks* pAllocationCallbacks)
+{
+    ns_aligned_allocation_header* pHeader;
+
+    if (p == NULL) {
+        return;
+    }
+
+    pHeader = (ns_aligned_allocation_header*)((unsigned char*)p - sizeof(*pHeader));
+    ns_free(pHeader->pUnaligned, pAllocationCallbacks);
+}
+/* END allocation_callbacks.c */
+
+/* BEG result_from_errno.c */
+#include <errno.h>
+
+NS_API ns_result ns_result_from_errno(int error)
+{
+    if (error == 0) {
+        return NS_SUCCESS;
+    }
+#ifdef EPERM
+    else if (error == EPERM) { return NS_INVALID_OPERATION; }
+#endif
+#ifdef ENOENT
+    else if (error == ENOENT) { return NS_DOES_NOT_EXIST; }
+#endif
+#ifdef ESRCH
+    else if (error == ESRCH) { return NS_DOES_NOT_EXIST; }
+#endif
+#ifdef EINTR
+    else if (error == EINTR) { return NS_INTERRUPT; }
+#endif
+#ifdef EIO
+    else if (error == EIO) { return NS_IO_ERROR; }
+#endif
+#ifdef ENXIO
+    else if (error == ENXIO) { return NS_DOES_NOT_EXIST; }
+#endif
+#ifdef E2BIG
+    else if (error == E2BIG) { return NS_INVALID_ARGS; }
+#endif
+#ifdef ENOEXEC
+    else if (error == ENOEXEC) { return NS_INVALID_FILE; }
+#endif
+#ifdef EBADF
+    else if (error == EBADF) { return NS_INVALID_FILE; }
+#endif
+#ifdef EAGAIN
+    else if (error == EAGAIN) { return NS_UNAVAILABLE; }
+#endif
+#ifdef ENOMEM
+    else if (error == ENOMEM) { return NS_OUT_OF_MEMORY; }
+#endif
+#ifdef EACCES
+    else if (error == EACCES) { return NS_ACCESS_DENIED; }
+#endif
+#ifdef EFAULT
+    else if (error == EFAULT) { return NS_BAD_ADDRESS; }
+#endif
+#ifdef EBUSY
+    else if (error == EBUSY) { return NS_BUSY; }
+#endif
+#ifdef EEXIST
+    else if (error == EEXIST) { return NS_ALREADY_EXISTS; }
+#endif
+#ifdef EXDEV
+    else if (error == EXDEV) { return NS_DIFFERENT_DEVICE; }
+#endif
+#ifdef ENODEV
+    else if (error == ENODEV) { return NS_DOES_NOT_EXIST; }
+#endif
+#ifdef ENOTDIR
+    else if (error == ENOTDIR) { return NS_NOT_DIRECTORY; }
+#endif
+#ifdef EISDIR
+    else if (error == EISDIR) { return NS_IS_DIRECTORY; }
+#endif
+#ifdef EINVAL
+    else if (error == EINVAL) { return NS_INVALID_ARGS; }
+#endif
+#ifdef ENFILE
+    else if (error == ENFILE) { return NS_TOO_MANY_OPEN_FILES; }
+#endif
+#ifdef EMFILE
+    else if (error == EMFILE) { return NS_TOO_MANY_OPEN_FILES; }
+#endif
+#ifdef ENOTTY
+    else if (error == ENOTTY) { return NS_INVALID_OPERATION; }
+#endif
+#ifdef ETXTBSY
+    else if (error == ETXTBSY) { return NS_BUSY; }
+#endif
+#ifdef EFBIG
+    else if (error == EFBIG) { return NS_TOO_BIG; }
+#endif
+#ifdef ENOSPC
+    else if (error == ENOSPC) { return NS_NO_SPACE; }
+#endif
+#ifdef ESPIPE
+    else if (error == ESPIPE) { return NS_BAD_SEEK; }
+#endif
+#ifdef EROFS
+    else if (error == EROFS) { return NS_ACCESS_DENIED; }
+#endif
+#ifdef EPIPE
+    else if (error == EPIPE) { return NS_BAD_PIPE; }
+#endif
+#ifdef EDOM
+    else if (error == EDOM) { return NS_OUT_OF_RANGE; }
+#endif
+#ifdef ERANGE
+    else if (error == ERANGE) { return NS_OUT_OF_RANGE; }
+#endif
+#ifdef EDEADLK
+    else if (error == EDEADLK) { return NS_DEADLOCK; }
+#endif
+#ifdef ENAMETOOLONG
+    else if (error == ENAMETOOLONG) { return NS_PATH_TOO_LONG; }
+#endif
+#ifdef ENOSYS
+    else if (error == ENOSYS) { return NS_NOT_IMPLEMENTED; }
+#endif
+#ifdef ENOTEMPTY
+    else if (error == ENOTEMPTY) { return NS_DIRECTORY_NOT_EMPTY; }
+#endif
+#ifdef ELNRNG
+    else if (error == ELNRNG) { return NS_OUT_OF_RANGE; }
+#endif
+#ifdef EBFONT
+    else if (error == EBFONT) { return NS_INVALID_FILE; }
+#endif
+#ifdef ENODATA
+    else if (error == ENODATA) { return NS_NO_DATA_AVAILABLE; }
+#endif
+#ifdef ETIME
+    else if (error == ETIME) { return NS_TIMEOUT; }
+#endif
+#ifdef ENOSR
+    else if (error == ENOSR) { return NS_NO_DATA_AVAILABLE; }
+#endif
+#ifdef ENONET
+    else if (error == ENONET) { return NS_NO_NETWORK; }
+#endif
+#ifdef EOVERFLOW
+    else if (error == EOVERFLOW) { return NS_TOO_BIG; }
+#endif
+#ifdef ELIBACC
+    else if (error == ELIBACC) { return NS_ACCESS_DENIED; }
+#endif
+#ifdef ELIBBAD
+    else if (error == ELIBBAD) { return NS_INVALID_FILE; }
+#endif
+#ifdef ELIBSCN
+    else if (error == ELIBSCN) { return NS_INVALID_FILE; }
+#endif
+#ifdef EILSEQ
+    else if (error == EILSEQ) { return NS_INVALID_DATA; }
+#endif
+#ifdef ENOTSOCK
+    else if (error == ENOTSOCK) { return NS_NOT_SOCKET; }
+#endif
+#ifdef EDESTADDRREQ
+    else if (error == EDESTADDRREQ) { return NS_NO_ADDRESS; }
+#endif
+#ifdef EMSGSIZE
+    else if (error == EMSGSIZE) { return NS_TOO_BIG; }
+#endif
+#ifdef EPROTOTYPE
+    else if (error == EPROTOTYPE) { return NS_BAD_PROTOCOL; }
+#endif
+#ifdef ENOPROTOOPT
+    else if (error == ENOPROTOOPT) { return NS_PROTOCOL_UNAVAILABLE; }
+#endif
+#ifdef EPROTONOSUPPORT
+    else if (error == EPROTONOSUPPORT) { return NS_PROTOCOL_NOT_SUPPORTED; }
+#endif
+#ifdef ESOCKTNOSUPPORT
+    else if (error == ESOCKTNOSUPPORT) { return NS_SOCKET_NOT_SUPPORTED; }
+#endif
+#ifdef EOPNOTSUPP
+    else if (error == EOPNOTSUPP) { return NS_INVALID_OPERATION; }
+#endif
+#ifdef EPFNOSUPPORT
+    else if (error == EPFNOSUPPORT) { return NS_PROTOCOL_FAMILY_NOT_SUPPORTED; }
+#endif
+#ifdef EAFNOSUPPORT
+    else if (error == EAFNOSUPPORT) { return NS_ADDRESS_FAMILY_NOT_SUPPORTED; }
+#endif
+#ifdef EADDRINUSE
+    else if (error == EADDRINUSE) { return NS_ALREADY_IN_USE; }
+#endif
+#ifdef ENETDOWN
+    else if (error == ENETDOWN) { return NS_NO_NETWORK; }
+#endif
+#ifdef ENETUNREACH
+    else if (error == ENETUNREACH) { return NS_NO_NETWORK; }
+#endif
+#ifdef ENETRESET
+    else if (error == ENETRESET) { return NS_NO_NETWORK; }
+#endif
+#ifdef ECONNABORTED
+    else if (error == ECONNABORTED) { return NS_NO_NETWORK; }
+#endif
+#ifdef ECONNRESET
+    else if (error == ECONNRESET) { return NS_CONNECTION_RESET; }
+#endif
+#ifdef ENOBUFS
+    else if (error == ENOBUFS) { return NS_NO_SPACE; }
+#endif
+#ifdef EISCONN
+    else if (error == EISCONN) { return NS_ALREADY_CONNECTED; }
+#endif
+#ifdef ENOTCONN
+    else if (error == ENOTCONN) { return NS_NOT_CONNECTED; }
+#endif
+#ifdef ETIMEDOUT
+    else if (error == ETIMEDOUT) { return NS_TIMEOUT; }
+#endif
+#ifdef ECONNREFUSED
+    else if (error == ECONNREFUSED) { return NS_CONNECTION_REFUSED; }
+#endif
+#ifdef EHOSTDOWN
+    else if (error == EHOSTDOWN) { return NS_NO_HOST; }
+#endif
+#ifdef EHOSTUNREACH
+    else if (error == EHOSTUNREACH) { return NS_NO_HOST; }
+#endif
+#ifdef EALREADY
+    else if (error == EALREADY) { return NS_IN_PROGRESS; }
+#endif
+#ifdef EINPROGRESS
+    else if (error == EINPROGRESS) { return NS_IN_PROGRESS; }
+#endif
+#ifdef ESTALE
+    else if (error == ESTALE) { return NS_INVALID_FILE; }
+#endif
+#ifdef EREMOTEIO
+    else if (error == EREMOTEIO) { return NS_IO_ERROR; }
+#endif
+#ifdef EDQUOT
+    else if (error == EDQUOT) { return NS_NO_SPACE; }
+#endif
+#ifdef ENOMEDIUM
+    else if (error == ENOMEDIUM) { return NS_DOES_NOT_EXIST; }
+#endif
+#ifdef ECANCELED
+    else if (error == ECANCELED) { return NS_CANCELLED; }
+#endif
     
-    return 0;
+    return NS_ERROR;
+}
+/* END result_from_errno.c */
+
+/* BEG sort.c */
+#define NS_SORT_INSERTION_SORT_THRESHOLD        24  /* Partitions smaller than this are insertion sorted. */
+#define NS_SORT_NINTHER_THRESHOLD               128 /* Partitions larger than this use a ninther for pivot selection. */
+#define NS_SORT_PARTIAL_INSERTION_SORT_LIMIT    8   /* Maximum number of element moves before a partial insertion sort gives up. */
+#define NS_SORT_BLOCK_SIZE                      64  /* Block size for the branchless partition. Must fit in an unsigned char. */
+#define NS_SORT_TEMP_BUFFER_SIZE                256 /* Size of the stack buffer used for moving elements around. Larger elements will be moved with swaps. */
+
+static NS_INLINE int ns_sort_less(int (*compareProc)(void*, const void*, const void*), void* pUserData, const void* pA, const void* pB)
+{
+    return compareProc(pUserData, pA, pB) < 0;
+}
+
+static NS_INLINE void ns_sort_swap(void* pA, void* pB, size_t stride)
+{
+    unsigned char temp[64];
+    unsigned char* a = (unsigned char*)pA;
+    unsigned char* b = (unsigned char*)pB;
+
+    if (pA == pB) {
+        return;
+    }
+
+    while (stride > 0) {
+        size_t bytesToSwap = (stride < sizeof(temp)) ? stride : sizeof(temp);
+
+        NS_COPY_MEMORY(temp, a, bytesToSwap);
+        NS_COPY_MEMORY(a, b, bytesToSwap);
+        NS_COPY_MEMORY(b, temp, bytesToSwap);
+
+        a      += bytesToSwap;
+        b      += bytesToSwap;
+        stride -= bytesToSwap;
+    }
+}
+
+/* Moves the element at pLast to pFirst and shifts everything in [pFirst, pLast) up by one element. */
+static void ns_sort_rotate_right(char* pFirst, char* pLast, size_t stride)
+{
+    if (stride <= NS_SORT_TEMP_BUFFER_SIZE) {
+        char temp[NS_SORT_TEMP_BUFFER_SIZE];
+
+        NS_COPY_MEMORY(temp, pLast, stride);
+        NS_MOVE_MEMORY(pFirst + stride, pFirst, (size_t)(pLast - pFirst));
+        NS_COPY_MEMORY(pFirst, temp, stride);
+    } else {
+        /* Too big for our temp buffer. Just fall back to a chain of swaps. */
+        while (pLast > pFirst) {
+            ns_sort_swap(pLast - stride, pLast, stride);
+            pLast -= stride;
+        }
+    }
+}
+
+static void ns_sort_sort2(char* pA, char* pB, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData)
+{
+    if (ns_sort_less(compareProc, pUserData, pB, pA)) {
+        ns_sort_swap(pA, pB, stride);
+    }
+}
+
+static void ns_sort_sort3(char* pA, char* pB, char* pC, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData)
+{
+    ns_sort_sort2(pA, pB, stride, compareProc, pUserData);
+    ns_sort_sort2(pB, pC, stride, compareProc, pUserData);
+    ns_sort_sort2(pA, pB, stride, compareProc, pUserData);
+}
+
+/*
+Each element is compared against its predecessors until its final position is found, and then moved there with a single
+rotation rather than swapping it down one position at a time.
+*/
+static void ns_sort_insertion(char* pBegin, char* pEnd, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData)
+{
+    char* pCur;
+
+    if (pBegin == pEnd) {
+        return;
+    }
+
+    for (pCur = pBegin + stride; pCur < pEnd; pCur += stride) {
+        char* pSift = pCur;
+
+        while (pSift > pBegin && ns_sort_less(compareProc, pUserData, pCur, pSift - stride)) {
+            pSift -= stride;
+        }
+
+        if (pSift != pCur) {
+            ns_sort_rotate_right(pSift, pCur, stride);
+        }
+    }
+}
+
+/*
+Same as ns_sort_insertion(), except it gives up after moving more than NS_SORT_PARTIAL_INSERTION_SORT_LIMIT elements. Returns
+non-zero if the range was fully sorted. This is used to quickly finish off partitions that look like they're already sorted.
+*/
+static int ns_sort_partial_insertion(char* pBegin, char* pEnd, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData)
+{
+    char* pCur;
+    size_t limit = 0;
+
+    if (pBegin == pEnd) {
+        return 1;
+    }
+
+    for (pCur = pBegin + stride; pCur < pEnd; pCur += stride) {
+        char* pSift = pCur;
+
+        while (pSift > pBegin && ns_sort_less(compareProc, pUserData, pCur, pSift - stride)) {
+            pSift -= stride;
+        }
+
+        if (pSift != pCur) {
+            ns_sort_rotate_right(pSift, pCur, stride);
+
+            limit += (size_t)(pCur - pSift) / stride;
+            if (limit > NS_SORT_PARTIAL_INSERTION_SORT_LIMIT) {
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+static void ns_sort_heap_sift_down(char* pBase, size_t root, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData)
+{
+    for (;;) {
+        size_t child = root*2 + 1;
+        if (child >= count) {
+            break;
+        }
+
+        if (child + 1 < count && ns_sort_less(compareProc, pUserData, pBase + child*stride, pBase + (child + 1)*stride)) {
+            child += 1;
+        }
+
+        if (!ns_sort_less(compareProc, pUserData, pBase + root*stride, pBase + child*stride)) {
+            break;
+        }
+
+        ns_sort_swap(pBase + root*stride, pBase + child*stride, stride);
+        root = child;
+    }
+}
+
+/* Fallback for when the quicksort keeps picking bad pivots. Guarantees O(n log n). */
+static void ns_sort_heapsort(char* pBase, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData)
+{
+    size_t i;
+
+    if (count < 2) {
+        return;
+    }
+
+    for (i = count/2; i > 0; i -= 1) {
+        ns_sort_heap_sift_down(pBase, i - 1, count, stride, compareProc, pUserData);
+    }
+
+    for (i = count - 1; i > 0; i -= 1) {
+        ns_sort_swap(pBase, pBase + i*stride, stride);
+        ns_sort_heap_sift_down(pBase, 0, i, stride, compareProc, pUserData);
+    }
+}
+
+/*
+Partitions [pBegin, pEnd) around the pivot at pBegin. Elements equal to the pivot go to the right. Returns the final position of
+the pivot. The pivot is left at pBegin for the duration of the partition so it never needs to be copied out.
+
+This uses the block partitioning scheme from BlockQuicksort. Rather than branching on each comparison, the results of a whole
+block of comparisons are written to offset buffers unconditionally, and then the misplaced elements are swapped in a separate
+pass. This keeps the comparison results out of the branch predictor.
+
+The already partitioned flag is set if no elements needed to be swapped.
+*/
+static char* ns_sort_partition_right(char* pBegin, char* pEnd, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData, int* pAlreadyPartitioned)
+{
+    char* pFirst = pBegin;
+    char* pLast  = pEnd;
+    char* pPivotPos;
+
+    /* Find the first element greater than or equal to the pivot. The median of 3 guarantees this exists. */
+    do {
+        pFirst += stride;
+    } while (ns_sort_less(compareProc, pUserData, pFirst, pBegin));
+
+    /* Find the first element strictly smaller than the pivot. We have to guard this search if there was no element before *pFirst. */
+    if (pFirst - stride == pBegin) {
+        while (pFirst < pLast) {
+            pLast -= stride;
+            if (ns_sort_less(compareProc, pUserData, pLast, pBegin)) {
+                break;
+            }
+        }
+    } else {
+        do {
+            pLast -= stride;
+        } while (!ns_sort_less(compareProc, pUserData, pLast, pBegin));
+    }
+
+    *pAlreadyPartitioned = pFirst >= pLast;
+
+    if (!*pAlreadyPartitioned) {
+        unsigned char offsetsL[NS_SORT_BLOCK_SIZE];
+        unsigned char offsetsR[NS_SORT_BLOCK_SIZE];
+        char* pOffsetsBaseL;
+        char* pOffsetsBaseR;
+        size_t countL = 0;
+        size_t countR = 0;
+        size_t startL = 0;
+        size_t startR = 0;
+
+        ns_sort_swap(pFirst, pLast, stride);
+        pFirst += stride;
+
+        pOffsetsBaseL = pFirst;
+        pOffsetsBaseR = pLast;
+
+        while (pFirst < pLast) {
+            size_t unknownCount = (size_t)(pLast - pFirst) / stride;
+            size_t splitL;
+            size_t splitR;
+            size_t swapCount;
+            size_t i;
+
+            /* Fill whichever offset buffers are empty, splitting the remaining elements if both are. */
+            if (countL == 0) {
+                splitL = (countR == 0) ? unknownCount/2 : unknownCount;
+            } else {
+                splitL = 0;
+            }
+
+            splitR = (countR == 0) ? (unknownCount - splitL) : 0;
+
+            if (splitL > NS_SORT_BLOCK_SIZE) {
+                splitL = NS_SORT_BLOCK_SIZE;
+            }
+            if (splitR > NS_SORT_BLOCK_SIZE) {
+                splitR = NS_SORT_BLOCK_SIZE;
+            }
+
+            for (i = 0; i < splitL; i += 1) {
+                offsetsL[countL] = (unsigned char)i;
+                countL += !ns_sort_less(compareProc, pUserData, pFirst, pBegin);
+                pFirst += stride;
+            }
+
+            for (i = 0; i < splitR; i += 1) {
+                pLast -= stride;
+                offsetsR[countR] = (unsigned char)(i + 1);
+                countR += ns_sort_less(compareProc, pUserData, pLast, pBegin);
+            }
+
+            /* Swap as many misplaced pairs as we have. */
+            swapCount = (countL < countR) ? countL : countR;
+            for (i = 0; i < swapCount; i += 1) {
+                ns_sort_swap(pOffsetsBaseL + offsetsL[startL + i]*stride, pOffsetsBaseR - offsetsR[startR + i]*stride, stride);
+            }
+
+            countL -= swapCount;
+            countR -= swapCount;
+            startL += swapCount;
+            startR += swapCount;
+
+            if (countL == 0) {
+                startL = 0;
+                pOffsetsBaseL = pFirst;
+            }
+            if (countR == 0) {
+                startR = 0;
+                pOffsetsBaseR = pLast;
+            }
+        }
+
+        /* Anything left over in the offset buffers needs to be moved to the boundary. */
+        if (countL > 0) {
+            while (countL > 0) {
+                countL -= 1;
+                pLast -= stride;
+                ns_sort_swap(pOffsetsBaseL + offsetsL[startL + countL]*stride, pLast, stride);
+            }
+            pFirst = pLast;
+        }
+        if (countR > 0) {
+            while (countR > 0) {
+                countR -= 1;
+                ns_sort_swap(pOffsetsBaseR - offsetsR[startR + countR]*stride, pFirst, stride);
+                pFirst += stride;
+            }
+            pLast = pFirst;
+        }
+    }
+
+    pPivotPos = pFirst - stride;
+    ns_sort_swap(pBegin, pPivotPos, stride);
+
+    return pPivotPos;
+}
+
+/*
+Similar to ns_sort_partition_right(), except elements equal to the pivot go to the left. This is used when the pivot is equal to
+the element just before the partition, in which case we know every element equal to the pivot is already in its final position
+and we can skip over them all at once. This is what makes inputs with many duplicates linear.
+*/
+static char* ns_sort_partition_left(char* pBegin, char* pEnd, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData)
+{
+    char* pFirst = pBegin;
+    char* pLast  = pEnd;
+
+    do {
+        pLast -= stride;
+    } while (ns_sort_less(compareProc, pUserData, pBegin, pLast));
+
+    if (pLast + stride == pEnd) {
+        while (pFirst < pLast) {
+            pFirst += stride;
+            if (ns_sort_less(compareProc, pUserData, pBegin, pFirst)) {
+                break;
+            }
+        }
+    } else {
+        do {
+            pFirst += stride;
+        } while (!ns_sort_less(compareProc, pUserData, pBegin, pFirst));
+    }
+
+    while (pFirst < pLast) {
+        ns_sort_swap(pFirst, pLast, stride);
+
+        do {
+            pLast -= stride;
+        } while (ns_sort_less(compareProc, pUserData, pBegin, pLast));
+
+        do {
+            pFirst += stride;
+        } while (!ns_sort_less(compareProc, pUserData, pBegin, pFirst));
+    }
+
+    ns_sort_swap(pBegin, pLast, stride);
+
+    return pLast;
+}
+
+/* Swaps a few elements around to break up patterns that caused an unbalanced partition. */
+static void ns_sort_break_patterns(char* pBegin, char* pEnd, size_t count, size_t stride)
+{
+    size_t quarter = count/4;
+
+    if (count < NS_SORT_INSERTION_SORT_THRESHOLD) {
+        return;
+    }
+
+    ns_sort_swap(pBegin, pBegin + quarter*stride, stride);
+    ns_sort_swap(pEnd - stride, pEnd - quarter*stride, stride);
+
+    if (count > NS_SORT_NINTHER_THRESHOLD) {
+        ns_sort_swap(pBegin + 1*stride, pBegin + (quarter + 1)*stride, stride);
+        ns_sort_swap(pBegin + 2*stride, pBegin + (quarter + 2)*stride, stride);
+        ns_sort_swap(pEnd - 2*stride, pEnd - (quarter + 1)*stride, stride);
+        ns_sort_swap(pEnd - 3*stride, pEnd - (quarter + 2)*stride, stride);
+    }
+}
+
+/* Chooses a pivot and moves it to the start of the partition. */
+static void ns_sort_choose_pivot(char* pBegin, char* pEnd, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData)
+{
+    size_t half = count/2;
+
+    if (count > NS_SORT_NINTHER_THRESHOLD) {
+        ns_sort_sort3(pBegin,                    pBegin + half*stride,       pEnd - 1*stride, stride, compareProc, pUserData);
+        ns_sort_sort3(pBegin + 1*stride,         pBegin + (half - 1)*stride, pEnd - 2*stride, stride, compareProc, pUserData);
+        ns_sort_sort3(pBegin + 2*stride,         pBegin + (half + 1)*stride, pEnd - 3*stride, stride, compareProc, pUserData);
+        ns_sort_sort3(pBegin + (half - 1)*stride, pBegin + half*stride,       pBegin + (half + 1)*stride, stride, compareProc, pUserData);
+        ns_sort_swap(pBegin, pBegin + half*stride, stride);
+    } else {
+        ns_sort_sort3(pBegin + half*stride, pBegin, pEnd - stride, stride, compareProc, pUserData);
+    }
+}
+
+static void ns_sort_loop(char* pBegin, char* pEnd, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData, int badAllowed, int leftmost)
+{
+    for (;;) {
+        size_t count = (size_t)(pEnd - pBegin) / stride;
+        size_t countL;
+        size_t countR;
+        char* pPivotPos;
+        int alreadyPartitioned;
+
+        if (count < NS_SORT_INSERTION_SORT_THRESHOLD) {
+            ns_sort_insertion(pBegin, pEnd, stride, compareProc, pUserData);
+            return;
+        }
+
+        ns_sort_choose_pivot(pBegin, pEnd, count, stride, compareProc, pUserData);
+
+        /*
+        If the element just before this partition is not less than the pivot, it must be equal to it because it was the pivot of
+        a previous partition. In this case everything equal to the pivot can be put into place at once.
+        */
+        if (!leftmost && !ns_sort_less(compareProc, pUserData, pBegin - stride, pBegin)) {
+            pBegin = ns_sort_partition_left(pBegin, pEnd, stride, compareProc, pUserData) + stride;
+            continue;
+        }
+
+        pPivotPos = ns_sort_partition_right(pBegin, pEnd, stride, compareProc, pUserData, &alreadyPartitioned);
+
+        countL = (size_t)(pPivotPos - pBegin) / stride;
+        countR = (size_t)(pEnd - (pPivotPos + stride)) / stride;
+
+        if (countL < count/8 || countR < count/8) {
+            /* Highly unbalanced. If this keeps happening we're probably dealing with an adversarial input so switch to heapsort. */
+            badAllowed -= 1;
+            if (badAllowed == 0) {
+                ns_sort_heapsort(pBegin, count, stride, compareProc, pUserData);
+                return;
+            }
+
+            ns_sort_break_patterns(pBegin, pPivotPos, countL, stride);
+            ns_sort_break_patterns(pPivotPos + stride, pEnd, countR, stride);
+        } else {
+            /* If the partition looks like it's already sorted, try finishing it off with an insertion sort. */
+            if (alreadyPartitioned &&
+                ns_sort_partial_insertion(pBegin, pPivotPos, stride, compareProc, pUserData) &&
+                ns_sort_partial_insertion(pPivotPos + stride, pEnd, stride, compareProc, pUserData)) {
+                return;
+            }
+        }
+
+        /* Recurse into the smaller side and loop on the larger one to keep the stack depth at O(log n). */
+        if (countL < countR) {
+            ns_sort_loop(pBegin, pPivotPos, stride, compareProc, pUserData, badAllowed, leftmost);
+            pBegin   = pPivotPos + stride;
+            leftmost = 0;
+        } else {
+            ns_sort_loop(pPivotPos + stride, pEnd, stride, compareProc, pUserData, badAllowed, 0);
+            pEnd = pPivotPos;
+        }
+    }
+}
+
+NS_API void ns_sort(void* pBase, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData)
+{
+    int badAllowed = 0;
+    size_t n;
+
+    if (pBase == NULL || count < 2 || stride == 0 || compareProc == NULL) {
+        return;
+    }
+
+    /* Allow log2(count) bad partitions before falling back to heapsort. */
+    for (n = count; n > 1; n >>= 1) {
+        badAllowed += 1;
+    }
+
+    ns_sort_loop((char*)pBase, (char*)pBase + count*stride, stride, compareProc, pUserData, badAllowed, 1);
+}
+/* END sort.c */
+
+/* BEG sort_stable.c */
+/*
+This is a Timsort. Natural runs are detected and short runs are extended to a minimum length with a binary insertion sort. The
+runs are then merged according to the usual Timsort stack invariants. Merging uses galloping mode which is what makes this
+efficient for partially sorted data. A fully sorted (or reversed) input is done in n-1 comparisons.
+
+The scratch buffer only ever needs to hold the smaller of the two runs being merged, and is capped at
+NS_SORT_STABLE_MAX_TEMP_SIZE bytes. Merges that don't fit are split with rotations until they do. If the scratch buffer can't be
+allocated at all the sort will still work, it'll just be slower.
+*/
+#ifndef NS_SORT_STABLE_MAX_TEMP_SIZE
+#define NS_SORT_STABLE_MAX_TEMP_SIZE    (16*1024*1024)
+#endif
+
+#define NS_SORT_STABLE_MIN_GALLOP       7
+#define NS_SORT_STABLE_MAX_RUNS         85  /* Enough for 2^64 elements given the run length invariants. */
+
+typedef struct
+{
+    char* pStart;
+    size_t count;
+} ns_sort_stable_run;
+
+typedef struct
+{
+    size_t stride;
+    int (* compareProc)(void*, const void*, const void*);
+    void* pUserData;
+    const ns_allocation_callbacks* pAllocationCallbacks;
+    char* pTemp;
+    size_t tempCap;         /* In elements. */
+    size_t tempCapMax;      /* In elements. Will be lowered if an allocation fails so we don't keep retrying. */
+    size_t minGallop;
+    ns_sort_stable_run runs[NS_SORT_STABLE_MAX_RUNS];
+    size_t runCount;
+} ns_sort_stable_state;
+
+static int ns_sort_stable_reserve_temp(ns_sort_stable_state* pState, size_t count)
+{
+    char* pNewTemp;
+
+    if (count <= pState->tempCap) {
+        return 1;
+    }
+
+    if (count > pState->tempCapMax) {
+        return 0;
+    }
+
+    /* We don't need to preserve the contents so there's no point in a realloc. */
+    pNewTemp = (char*)ns_malloc(count * pState->stride, pState->pAllocationCallbacks);
+    if (pNewTemp == NULL) {
+        pState->tempCapMax = pState->tempCap;  /* Don't bother trying to grow again. We'll just make do with what we have. */
+        return 0;
+    }
+
+    ns_free(pState->pTemp, pState->pAllocationCallbacks);
+
+    pState->pTemp   = pNewTemp;
+    pState->tempCap = count;
+
+    return 1;
+}
+
+/*
+The gallop functions return the number of leading elements in pList for which a predicate is true. When isUpper is false this
+is the number of elements less than the key (the lower bound). When isUpper is true it's the number of elements less than or
+equal to the key (the upper bound). The forward version starts searching at the start of the list and the backward version at
+the end. Either way it's an exponential search followed by a binary search.
+*/
+static NS_INLINE int ns_sort_stable_gallop_predicate(ns_sort_stable_state* pState, const char* pKey, const char* pElement, int isUpper)
+{
+    if (isUpper) {
+        return !ns_sort_less(pState->compareProc, pState->pUserData, pKey, pElement);
+    } else {
+        return ns_sort_less(pState->compareProc, pState->pUserData, pElement, pKey);
+    }
+}
+
+static size_t ns_sort_stable_gallop_forward(ns_sort_stable_state* pState, const char* pKey, const char* pList, size_t count, int isUpper)
+{
+    size_t stride = pState->stride;
+    size_t lo;  /* Predicate known to be true at lo. */
+    size_t hi;  /* Predicate known to be false at hi, or hi == count. */
+    size_t ofs;
+
+    if (count == 0 || !ns_sort_stable_gallop_predicate(pState, pKey, pList, isUpper)) {
+        return 0;
+    }
+
+    lo  = 0;
+    ofs = 1;
+    while (ofs < count && ns_sort_stable_gallop_predicate(pState, pKey, pList + ofs*stride, isUpper)) {
+        lo  = ofs;
+        ofs = (ofs << 1) + 1;
+    }
+
+    hi = (ofs < count) ? ofs : count;
+
+    lo += 1;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo)/2;
+        if (ns_sort_stable_gallop_predicate(pState, pKey, pList + mid*stride, isUpper)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return hi;
+}
+
+static size_t ns_sort_stable_gallop_backward(ns_sort_stable_state* pState, const char* pKey, const char* pList, size_t count, int isUpper)
+{
+    size_t stride = pState->stride;
+    size_t lo;  /* Predicate known to be true before lo. */
+    size_t hi;  /* Predicate known to be false at hi. */
+    size_t ofs;
+
+    if (count == 0 || ns_sort_stable_gallop_predicate(pState, pKey, pList + (count - 1)*stride, isUpper)) {
+        return count;
+    }
+
+    hi  = count - 1;
+    ofs = 1;
+    while (ofs < count && !ns_sort_stable_gallop_predicate(pState, pKey, pList + (count - 1 - ofs)*stride, isUpper)) {
+        hi  = count - 1 - ofs;
+        ofs = (ofs << 1) + 1;
+    }
+
+    lo = (ofs < count) ? (count - ofs) : 0;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo)/2;
+        if (ns_sort_stable_gallop_predicate(pState, pKey, pList + mid*stride, isUpper)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return hi;
+}
+
+/*
+Merges two adjacent runs where A is the smaller one. A is copied to the scratch buffer and the merge is done from left to right.
+The runs must have been trimmed such that the first element of B is less than the first element of A, and the last element of A
+is greater than every element of B.
+*/
+static void ns_sort_stable_merge_lo(ns_sort_stable_state* pState, char* pA, size_t countA, char* pB, size_t countB)
+{
+    size_t stride = pState->stride;
+    size_t minGallop = pState->minGallop;
+    char* pDst = pA;
+    char* pTempA = pState->pTemp;
+
+    NS_COPY_MEMORY(pTempA, pA, countA*stride);
+    pA = pTempA;
+
+    NS_COPY_MEMORY(pDst, pB, stride);
+    pDst   += stride;
+    pB     += stride;
+    countB -= 1;
+
+    if (countB == 0) {
+        goto done;
+    }
+    if (countA == 1) {
+        goto copy_b;
+    }
+
+    for (;;) {
+        size_t winsA = 0;
+        size_t winsB = 0;
+
+        /* Merge one at a time until one run starts consistently winning. */
+        for (;;) {
+            if (ns_sort_less(pState->compareProc, pState->pUserData, pB, pA)) {
+                NS_COPY_MEMORY(pDst, pB, stride);
+                pDst   += stride;
+                pB     += stride;
+                countB -= 1;
+                winsB  += 1;
+                winsA   = 0;
+
+                if (countB == 0) {
+                    goto done;
+                }
+                if (winsB >= minGallop) {
+                    break;
+                }
+            } else {
+                NS_COPY_MEMORY(pDst, pA, stride);
+                pDst   += stride;
+                pA     += stride;
+                countA -= 1;
+                winsA  += 1;
+                winsB   = 0;
+
+                if (countA == 1) {
+                    goto copy_b;
+                }
+                if (winsA >= minGallop) {
+                    break;
+                }
+            }
+        }
+
+        /* Galloping mode. Keep going while it's paying off. */
+        minGallop += 1;
+        do {
+            size_t k;
+
+            minGallop -= (minGallop > 1);
+
+            k = ns_sort_stable_gallop_forward(pState, pB, pA, countA, 1);
+            winsA = k;
+            if (k > 0) {
+                NS_COPY_MEMORY(pDst, pA, k*stride);
+                pDst   += k*stride;
+                pA     += k*stride;
+                countA -= k;
+
+                if (countA == 1) {
+                    goto copy_b;
+                }
+                if (countA == 0) {
+                    goto done;  /* Can only happen with an inconsistent comparison function. */
+                }
+            }
+
+            NS_COPY_MEMORY(pDst, pB, stride);
+            pDst   += stride;
+            pB     += stride;
+            countB -= 1;
+            if (countB == 0) {
+                goto done;
+            }
+
+            k = ns_sort_stable_gallop_forward(pState, pA, pB, countB, 0);
+            winsB = k;
+            if (k > 0) {
+                NS_MOVE_MEMORY(pDst, pB, k*stride);
+                pDst   += k*stride;
+                pB     += k*stride;
+                countB -= k;
+
+                if (countB == 0) {
+                    goto done;
+                }
+            }
+
+            NS_COPY_MEMORY(pDst, pA, stride);
+            pDst   += stride;
+            pA     += stride;
+            countA -= 1;
+            if (countA == 1) {
+                goto copy_b;
+            }
+        } while (winsA >= NS_SORT_STABLE_MIN_GALLOP || winsB >= NS_SORT_STABLE_MIN_GALLOP);
+
+        minGallop += 1;  /* Penalize leaving galloping mode. */
+    }
+
+done:
+    if (countA > 0) {
+        NS_COPY_MEMORY(pDst, pA, countA*stride);
+    }
+    pState->minGallop = (minGallop < 1) ? 1 : minGallop;
+    return;
+
+copy_b:
+    /* The last element of A belongs at the end. */
+    NS_MOVE_MEMORY(pDst, pB, countB*stride);
+    NS_COPY_MEMORY(pDst + countB*stride, pA, stride);
+    pState->minGallop = (minGallop < 1) ? 1 : minGallop;
+}
+
+/* Mirror of ns_sort_stable_merge_lo(). B is the smaller run and is copied to the scratch buffer. The merge is done from right to left. */
+static void ns_sort_stable_merge_hi(ns_sort_stable_state* pState, char* pA, size_t countA, char* pB, size_t countB)
+{
+    size_t stride = pState->stride;
+    size_t minGallop = pState->minGallop;
+    char* pTempB = pState->pTemp;
+    char* pDst;     /* Points to the last element written, not one past it. */
+    char* pLastA;
+    char* pLastB;
+
+    NS_COPY_MEMORY(pTempB, pB, countB*stride);
+
+    pDst   = pB + (countB - 1)*stride;
+    pLastA = pA + (countA - 1)*stride;
+    pLastB = pTempB + (countB - 1)*stride;
+
+    NS_COPY_MEMORY(pDst, pLastA, stride);
+    pDst   -= stride;
+    pLastA -= stride;
+    countA -= 1;
+
+    if (countA == 0) {
+        goto done;
+    }
+    if (countB == 1) {
+        goto copy_a;
+    }
+
+    for (;;) {
+        size_t winsA = 0;
+        size_t winsB = 0;
+
+        for (;;) {
+            if (ns_sort_less(pState->compareProc, pState->pUserData, pLastB, pLastA)) {
+                NS_COPY_MEMORY(pDst, pLastA, stride);
+                pDst   -= stride;
+                pLastA -= stride;
+                countA -= 1;
+                winsA  += 1;
+                winsB   = 0;
+
+                if (countA == 0) {
+                    goto done;
+                }
+                if (winsA >= minGallop) {
+                    break;
+                }
+            } else {
+                NS_COPY_MEMORY(pDst, pLastB, stride);
+                pDst   -= stride;
+                pLastB -= stride;
+                countB -= 1;
+                winsB  += 1;
+                winsA   = 0;
+
+                if (countB == 1) {
+                    goto copy_a;
+                }
+                if (winsB >= minGallop) {
+                    break;
+                }
+            }
+        }
+
+        minGallop += 1;
+        do {
+            size_t k;
+
+            minGallop -= (minGallop > 1);
+
+            /* Number of elements in A greater than the last element in B. */
+            k = countA - ns_sort_stable_gallop_backward(pState, pLastB, pA, countA, 1);
+            winsA = k;
+            if (k > 0) {
+                pDst   -= k*stride;
+                pLastA -= k*stride;
+                NS_MOVE_MEMORY(pDst + stride, pLastA + stride, k*stride);
+                countA -= k;
+
+                if (countA == 0) {
+                    goto done;
+                }
+            }
+
+            NS_COPY_MEMORY(pDst, pLastB, stride);
+            pDst   -= stride;
+            pLastB -= stride;
+            countB -= 1;
+            if (countB == 1) {
+                goto copy_a;
+            }
+
+            /* Number of elements in B greater than or equal to the last element in A. */
+            k = countB - ns_sort_stable_gallop_backward(pState, pLastA, pTempB, countB, 0);
+            winsB = k;
+            if (k > 0) {
+                pDst   -= k*stride;
+                pLastB -= k*stride;
+                NS_COPY_MEMORY(pDst + stride, pLastB + stride, k*stride);
+                countB -= k;
+
+                if (countB == 1) {
+                    goto copy_a;
+                }
+                if (countB == 0) {
+                    goto done;  /* Can only happen with an inconsistent comparison function. */
+                }
+            }
+
+            NS_COPY_MEMORY(pDst, pLastA, stride);
+            pDst   -= stride;
+            pLastA -= stride;
+            countA -= 1;
+            if (countA == 0) {
+                goto done;
+            }
+        } while (winsA >= NS_SORT_STABLE_MIN_GALLOP || winsB >= NS_SORT_STABLE_MIN_GALLOP);
+
+        minGallop += 1;
+    }
+
+done:
+    if (countB > 0) {
+        NS_COPY_MEMORY(pDst - (countB - 1)*stride, pTempB, countB*stride);
+    }
+    pState->minGallop = (minGallop < 1) ? 1 : minGallop;
+    return;
+
+copy_a:
+    /* The first element of B belongs at the start. */
+    pDst   -= countA*stride;
+    pLastA -= countA*stride;
+    NS_MOVE_MEMORY(pDst + stride, pLastA + stride, countA*stride);
+    NS_COPY_MEMORY(pDst, pTempB, stride);
+    pState->minGallop = (minGallop < 1) ? 1 : minGallop;
+}
+
+static void ns_sort_stable_reverse(char* pFirst, char* pLast, size_t stride)
+{
+    while (pFirst + stride < pLast) {
+        pLast -= stride;
+        ns_sort_swap(pFirst, pLast, stride);
+        pFirst += stride;
+    }
+}
+
+/* Swaps the two adjacent blocks [pFirst, pMiddle) and [pMiddle, pLast) using three reversals. */
+static void ns_sort_stable_rotate(char* pFirst, char* pMiddle, char* pLast, size_t stride)
+{
+    if (pFirst == pMiddle || pMiddle == pLast) {
+        return;
+    }
+
+    ns_sort_stable_reverse(pFirst, pMiddle, stride);
+    ns_sort_stable_reverse(pMiddle, pLast, stride);
+    ns_sort_stable_reverse(pFirst, pLast, stride);
+}
+
+static void ns_sort_stable_merge(ns_sort_stable_state* pState, char* pA, size_t countA, char* pB, size_t countB)
+{
+    size_t stride = pState->stride;
+    size_t k;
+
+    /* Elements at the start of A that are already in place can be skipped. */
+    k = ns_sort_stable_gallop_forward(pState, pB, pA, countA, 1);
+    pA     += k*stride;
+    countA -= k;
+    if (countA == 0) {
+        return;
+    }
+
+    /* Likewise for elements at the end of B. */
+    countB = ns_sort_stable_gallop_backward(pState, pA + (countA - 1)*stride, pB, countB, 0);
+    if (countB == 0) {
+        return;
+    }
+
+    if (countA == 1 && countB == 1) {
+        ns_sort_swap(pA, pB, stride);
+        return;
+    }
+
+    if (ns_sort_stable_reserve_temp(pState, (countA <= countB) ? countA : countB)) {
+        if (countA <= countB) {
+            ns_sort_stable_merge_lo(pState, pA, countA, pB, countB);
+        } else {
+            ns_sort_stable_merge_hi(pState, pA, countA, pB, countB);
+        }
+    } else {
+        /*
+        Not enough scratch memory. Split the larger run in half, find where its middle element lands in the other run, and
+        rotate the two inner pieces into place. This leaves us with two independent merges of roughly half the size.
+        */
+        char* pCutA;
+        char* pCutB;
+        size_t cutCountA;
+        size_t cutCountB;
+
+        if (countA > countB) {
+            cutCountA = countA/2;
+            pCutA     = pA + cutCountA*stride;
+            cutCountB = ns_sort_stable_gallop_forward(pState, pCutA, pB, countB, 0);
+            pCutB     = pB + cutCountB*stride;
+        } else {
+            cutCountB = countB/2;
+            pCutB     = pB + cutCountB*stride;
+            cutCountA = ns_sort_stable_gallop_forward(pState, pCutB, pA, countA, 1);
+            pCutA     = pA + cutCountA*stride;
+        }
+
+        ns_sort_stable_rotate(pCutA, pB, pCutB, stride);
+
+        ns_sort_stable_merge(pState, pA, cutCountA, pCutA, cutCountB);
+        ns_sort_stable_merge(pState, pCutA + cutCountB*stride, countA - cutCountA, pCutB, countB - cutCountB);
+    }
+}
+
+static void ns_sort_stable_merge_at(ns_sort_stable_state* pState, size_t i)
+{
+    ns_sort_stable_run* pRunA = &pState->runs[i];
+    ns_sort_stable_run* pRunB = &pState->runs[i + 1];
+
+    ns_sort_stable_merge(pState, pRunA->pStart, pRunA->count, pRunB->pStart, pRunB->count);
+
+    pRunA->count += pRunB->count;
+    if (i + 2 < pState->runCount) {
+        pState->runs[i + 1] = pState->runs[i + 2];
+    }
+    pState->runCount -= 1;
+}
+
+/* Merges runs on the stack until the Timsort invariants are restored. This is the corrected version of the original check. */
+static void ns_sort_stable_merge_collapse(ns_sort_stable_state* pState)
+{
+    ns_sort_stable_run* pRuns = pState->runs;
+
+    while (pState->runCount > 1) {
+        size_t i = pState->runCount - 2;
+
+        if ((i > 0 && pRuns[i - 1].count <= pRuns[i].count + pRuns[i + 1].count) ||
+            (i > 1 && pRuns[i - 2].count <= pRuns[i - 1].count + pRuns[i].count)) {
+            if (pRuns[i - 1].count < pRuns[i + 1].count) {
+                i -= 1;
+            }
+        } else if (pRuns[i].count > pRuns[i + 1].count) {
+            break;
+        }
+
+        ns_sort_stable_merge_at(pState, i);
+    }
+}
+
+static void ns_sort_stable_merge_force_collapse(ns_sort_stable_state* pState)
+{
+    while (pState->runCount > 1) {
+        size_t i = pState->runCount - 2;
+
+        if (i > 0 && pState->runs[i - 1].count < pState->runs[i + 1].count) {
+            i -= 1;
+        }
+
+        ns_sort_stable_merge_at(pState, i);
+    }
+}
+
+/* Binary insertion sort. Elements in [pBegin, pSorted) must already be sorted. */
+static void ns_sort_stable_binary_insertion(ns_sort_stable_state* pState, char* pBegin, char* pSorted, char* pEnd)
+{
+    size_t stride = pState->stride;
+    char* pCur;
+
+    for (pCur = pSorted; pCur < pEnd; pCur += stride) {
+        /* Use the upper bound so equal elements keep their original order. */
+        size_t lo = 0;
+        size_t hi = (size_t)(pCur - pBegin) / stride;
+        char* pPos;
+
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo)/2;
+            if (ns_sort_less(pState->compareProc, pState->pUserData, pCur, pBegin + mid*stride)) {
+                hi = mid;
+            } else {
+                lo = mid + 1;
+            }
+        }
+
+        pPos = pBegin + lo*stride;
+        if (pPos != pCur) {
+            ns_sort_rotate_right(pPos, pCur, stride);
+        }
+    }
+}
+
+/* Returns the length of the run starting at pBegin. Strictly descending runs are reversed in place. */
+static size_t ns_sort_stable_count_run(ns_sort_stable_state* pState, char* pBegin, char* pEnd)
+{
+    size_t stride = pState->stride;
+    char* pCur = pBegin + stride;
+
+    if (pCur == pEnd) {
+        return 1;
+    }
+
+    if (ns_sort_less(pState->compareProc, pState->pUserData, pCur, pBegin)) {
+        /* Must be strictly descending or else reversing it would break stability. */
+        while (pCur + stride < pEnd && ns_sort_less(pState->compareProc, pState->pUserData, pCur + stride, pCur)) {
+            pCur += stride;
+        }
+        pCur += stride;
+
+        ns_sort_stable_reverse(pBegin, pCur, stride);
+    } else {
+        while (pCur + stride < pEnd && !ns_sort_less(pState->compareProc, pState->pUserData, pCur + stride, pCur)) {
+            pCur += stride;
+        }
+        pCur += stride;
+    }
+
+    return (size_t)(pCur - pBegin) / stride;
+}
+
+static size_t ns_sort_stable_min_run(size_t count)
+{
+    size_t r = 0;
+
+    while (count >= 64) {
+        r |= count & 1;
+        count >>= 1;
+    }
+
+    return count + r;
+}
+
+NS_API void ns_sort_stable(void* pBase, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData, const ns_allocation_callbacks* pAllocationCallbacks)
+{
+    ns_sort_stable_state state;
+    char* pCur;
+    char* pEnd;
+    size_t minRun;
+
+    if (pBase == NULL || count < 2 || stride == 0 || compareProc == NULL) {
+        return;
+    }
+
+    state.stride               = stride;
+    state.compareProc          = compareProc;
+    state.pUserData            = pUserData;
+    state.pAllocationCallbacks = pAllocationCallbacks;
+    state.pTemp                = NULL;
+    state.tempCap              = 0;
+    state.tempCapMax           = NS_SORT_STABLE_MAX_TEMP_SIZE / stride;
+    state.minGallop            = NS_SORT_STABLE_MIN_GALLOP;
+    state.runCount             = 0;
+
+    /* A merge never needs more than half the elements in scratch memory. */
+    if (state.tempCapMax > count/2) {
+        state.tempCapMax = count/2;
+    }
+
+    pCur   = (char*)pBase;
+    pEnd   = (char*)pBase + count*stride;
+    minRun = ns_sort_stable_min_run(count);
+
+    while (pCur < pEnd) {
+        size_t remaining = (size_t)(pEnd - pCur) / stride;
+        size_t runCount  = ns_sort_stable_count_run(&state, pCur, pEnd);
+
+        /* Short runs are extended with a binary insertion sort. */
+        if (runCount < minRun) {
+            size_t extendedCount = (remaining < minRun) ? remaining : minRun;
+            ns_sort_stable_binary_insertion(&state, pCur, pCur + runCount*stride, pCur + extendedCount*stride);
+            runCount = extendedCount;
+        }
+
+        state.runs[state.runCount].pStart = pCur;
+        state.runs[state.runCount].count  = runCount;
+        state.runCount += 1;
+
+        ns_sort_stable_merge_collapse(&state);
+
+        pCur += runCount*stride;
+    }
+
+    ns_sort_stable_merge_force_collapse(&state);
+
+    ns_free(state.pTemp, pAllocationCallbacks);
+}
+/* END sort_stable.c */
+
+/* BEG radix_sort.c */
+/*
+LSD radix sort on 8-bit digits for records keyed by a fixed-width integer at keyOffset within each record. The histograms for
+every digit are built in a single pass over the input, and any digit where every key has the same value is skipped entirely,
+which means keys that only use their low bytes only cost as many passes as they need.
+
+Signed keys are handled by flipping the sign bit which makes them sort correctly as unsigned integers. Floating point keys are
+mapped to an unsigned total order by flipping the sign bit of positive values and every bit of negative values. This places -0.0
+before +0.0. NaNs are all mapped to the largest key which puts them at the end in their original order. The mapping is only used
+for extracting digits. Records are moved as-is so there's no need to map anything back. The sort is stable.
+
+This needs a scratch buffer the same size as the input. If that can't be allocated it'll fall back to ns_sort_stable().
+*/
+typedef enum
+{
+    NS_RADIX_SORT_KEY_UNSIGNED,
+    NS_RADIX_SORT_KEY_SIGNED,
+    NS_RADIX_SORT_KEY_FLOAT
+} ns_radix_sort_key_type;
+
+/* Loads a key and maps it to an unsigned integer with the same ordering. */
+static NS_INLINE ns_uint64 ns_radix_sort_load_key(const char* pKey, size_t keySize, ns_radix_sort_key_type keyType)
+{
+    ns_uint64 key;
+    ns_uint64 signBit;
+    ns_uint64 allBits;
+    ns_uint64 infinity;
+
+    if (keySize == 4) {
+        ns_uint32 key32;
+        NS_COPY_MEMORY(&key32, pKey, sizeof(key32));
+
+        key      = key32;
+        signBit  = (ns_uint64)0x80000000;
+        allBits  = (ns_uint64)0xFFFFFFFF;
+        infinity = (ns_uint64)0x7F800000;
+    } else {
+        NS_COPY_MEMORY(&key, pKey, sizeof(key));
+
+        signBit  = (ns_uint64)0x80000000 << 32;
+        allBits  = ~(ns_uint64)0;
+        infinity = (ns_uint64)0x7FF00000 << 32;
+    }
+
+    if (keyType == NS_RADIX_SORT_KEY_UNSIGNED) {
+        return key;
+    }
+
+    if (keyType == NS_RADIX_SORT_KEY_SIGNED) {
+        return key ^ signBit;
+    }
+
+    /* Floating point. */
+    if ((key & ~signBit) > infinity) {
+        return allBits; /* NaN. */
+    }
+
+    if ((key & signBit) != 0) {
+        return ~key & allBits;
+    } else {
+        return key | signBit;
+    }
+}
+
+static int ns_radix_sort_compare_keys(const void* a, const void* b, size_t keyOffset, size_t keySize, ns_radix_sort_key_type keyType)
+{
+    ns_uint64 x = ns_radix_sort_load_key((const char*)a + keyOffset, keySize, keyType);
+    ns_uint64 y = ns_radix_sort_load_key((const char*)b + keyOffset, keySize, keyType);
+
+    return (x > y) - (x < y);
+}
+
+static int ns_radix_sort_compare_u32(void* pUserData, const void* a, const void* b)
+{
+    return ns_radix_sort_compare_keys(a, b, *(const size_t*)pUserData, 4, NS_RADIX_SORT_KEY_UNSIGNED);
+}
+
+static int ns_radix_sort_compare_u64(void* pUserData, const void* a, const void* b)
+{
+    return ns_radix_sort_compare_keys(a, b, *(const size_t*)pUserData, 8, NS_RADIX_SORT_KEY_UNSIGNED);
+}
+
+static int ns_radix_sort_compare_i32(void* pUserData, const void* a, const void* b)
+{
+    return ns_radix_sort_compare_keys(a, b, *(const size_t*)pUserData, 4, NS_RADIX_SORT_KEY_SIGNED);
+}
+
+static int ns_radix_sort_compare_i64(void* pUserData, const void* a, const void* b)
+{
+    return ns_radix_sort_compare_keys(a, b, *(const size_t*)pUserData, 8, NS_RADIX_SORT_KEY_SIGNED);
+}
+
+static int ns_radix_sort_compare_f32(void* pUserData, const void* a, const void* b)
+{
+    return ns_radix_sort_compare_keys(a, b, *(const size_t*)pUserData, 4, NS_RADIX_SORT_KEY_FLOAT);
+}
+
+static int ns_radix_sort_compare_f64(void* pUserData, const void* a, const void* b)
+{
+    return ns_radix_sort_compare_keys(a, b, *(const size_t*)pUserData, 8, NS_RADIX_SORT_KEY_FLOAT);
+}
+
+/* Scatters each record in pSrc to its bucket in pDst. pOffsets is the exclusive prefix sum of the digit's histogram. */
+static void ns_radix_sort_scatter(const char* pSrc, char* pDst, size_t count, size_t stride, size_t keyOffset, size_t keySize, ns_radix_sort_key_type keyType, unsigned int shift, size_t* pOffsets)
+{
+    size_t i;
+
+    /* The element size is constant in the common cases which lets the compiler turn the copy into a single move. */
+    if (stride == 4) {
+        for (i = 0; i < count; i += 1) {
+            const char* pRecord = pSrc + i*4;
+            size_t digit = (size_t)(((ns_radix_sort_load_key(pRecord + keyOffset, keySize, keyType)) >> shift) & 0xFF);
+            NS_COPY_MEMORY(pDst + pOffsets[digit]*4, pRecord, 4);
+            pOffsets[digit] += 1;
+        }
+    } else if (stride == 8) {
+        for (i = 0; i < count; i += 1) {
+            const char* pRecord = pSrc + i*8;
+            size_t digit = (size_t)(((ns_radix_sort_load_key(pRecord + keyOffset, keySize, keyType)) >> shift) & 0xFF);
+            NS_COPY_MEMORY(pDst + pOffsets[digit]*8, pRecord, 8);
+            pOffsets[digit] += 1;
+        }
+    } else {
+        for (i = 0; i < count; i += 1) {
+            const char* pRecord = pSrc + i*stride;
+            size_t digit = (size_t)(((ns_radix_sort_load_key(pRecord + keyOffset, keySize, keyType)) >> shift) & 0xFF);
+            NS_COPY_MEMORY(pDst + pOffsets[digit]*stride, pRecord, stride);
+            pOffsets[digit] += 1;
+        }
+    }
+}
+
+static void ns_radix_sort_internal(void* pBase, size_t count, size_t stride, size_t keyOffset, size_t keySize, ns_radix_sort_key_type keyType, int (*fallbackCompareProc)(void*, const void*, const void*), const ns_allocation_callbacks* pAllocationCallbacks)
+{
+    size_t histograms[8][256];
+    int passes[8];
+    size_t passCount = 0;
+    ns_uint64 firstKey;
+    char* pTemp;
+    char* pSrc;
+    char* pDst;
+    size_t iDigit;
+    size_t i;
+
+    if (pBase == NULL || count < 2 || keyOffset + keySize > stride) {
+        return;
+    }
+
+    NS_ZERO_MEMORY(histograms, sizeof(histograms));
+
+    /* All histograms are built in one pass. */
+    if (keySize == 4) {
+        for (i = 0; i < count; i += 1) {
+            ns_uint32 key = (ns_uint32)ns_radix_sort_load_key((const char*)pBase + i*stride + keyOffset, 4, keyType);
+
+            histograms[0][(key      ) & 0xFF] += 1;
+            histograms[1][(key >>  8) & 0xFF] += 1;
+            histograms[2][(key >> 16) & 0xFF] += 1;
+            histograms[3][(key >> 24)       ] += 1;
+        }
+    } else {
+        for (i = 0; i < count; i += 1) {
+            ns_uint64 key = ns_radix_sort_load_key((const char*)pBase + i*stride + keyOffset, 8, keyType);
+
+            for (iDigit = 0; iDigit < 8; iDigit += 1) {
+                histograms[iDigit][(size_t)((key >> (iDigit*8)) & 0xFF)] += 1;
+            }
+        }
+    }
+
+    /* A digit only needs a pass if the keys don't all share the same value for it. */
+    firstKey = ns_radix_sort_load_key((const char*)pBase + keyOffset, keySize, keyType);
+    for (iDigit = 0; iDigit < keySize; iDigit += 1) {
+        if (histograms[iDigit][(size_t)((firstKey >> (iDigit*8)) & 0xFF)] != count) {
+            passes[passCount] = (int)iDigit;
+            passCount += 1;
+        }
+    }
+
+    if (passCount == 0) {
+        return; /* Every key is the same. */
+    }
+
+    pTemp = (char*)ns_malloc(count * stride, pAllocationCallbacks);
+    if (pTemp == NULL) {
+        ns_sort_stable(pBase, count, stride, fallbackCompareProc, &keyOffset, pAllocationCallbacks);
+        return;
+    }
+
+    pSrc = (char*)pBase;
+    pDst = pTemp;
+
+    for (i = 0; i < passCount; i += 1) {
+        size_t* pHistogram = histograms[passes[i]];
+        size_t offset = 0;
+        size_t iBucket;
+        char* pSwap;
+
+        for (iBucket = 0; iBucket < 256; iBucket += 1) {
+            size_t bucketCount = pHistogram[iBucket];
+            pHistogram[iBucket] = offset;
+            offset += bucketCount;
+        }
+
+        ns_radix_sort_scatter(pSrc, pDst, count, stride, keyOffset, keySize, keyType, (unsigned int)passes[i]*8, pHistogram);
+
+        pSwap = pSrc;
+        pSrc  = pDst;
+        pDst  = pSwap;
+    }
+
+    /* An odd number of passes leaves the result in the scratch buffer. */
+    if (pSrc != (char*)pBase) {
+        NS_COPY_MEMORY(pBase, pSrc, count * stride);
+    }
+
+    ns_free(pTemp, pAllocationCallbacks);
+}
+
+NS_API void ns_radix_sort_u32(void* pBase, size_t count, size_t stride, size_t keyOffset, const ns_allocation_callbacks* pAllocationCallbacks)
+{
+    ns_radix_sort_internal(pBase, count, stride, keyOffset, sizeof(ns_uint32), NS_RADIX_SORT_KEY_UNSIGNED, ns_radix_sort_compare_u32, pAllocationCallbacks);
+}
+
+NS_API void ns_radix_sort_u64(void* pBase, size_t count, size_t stride, size_t keyOffset, const ns_allocation_callbacks* pAllocationCallbacks)
+{
+    ns_radix_sort_internal(pBase, count, stride, keyOffset, sizeof(ns_uint64), NS_RADIX_SORT_KEY_UNSIGNED, ns_radix_sort_compare_u64, pAllocationCallbacks);
+}
+
+NS_API void ns_radix_sort_i32(void* pBase, size_t count, size_t stride, size_t keyOffset, const ns_allocation_callbacks* pAllocationCallbacks)
+{
+    ns_radix_sort_internal(pBase, count, stride, keyOffset, sizeof(ns_int32), NS_RADIX_SORT_KEY_SIGNED, ns_radix_sort_compare_i32, pAllocationCallbacks);
+}
+
+NS_API void ns_radix_sort_i64(void* pBase, size_t count, size_t stride, size_t keyOffset, const ns_allocation_callbacks* pAllocationCallbacks)
+{
+    ns_radix_sort_internal(pBase, count, stride, keyOffset, sizeof(ns_int64), NS_RADIX_SORT_KEY_SIGNED, ns_radix_sort_compare_i64, pAllocationCallbacks);
+}
+
+NS_API void ns_radix_sort_f32(void* pBase, size_t count, size_t stride, size_t keyOffset, const ns_allocation_callbacks* pAllocationCallbacks)
+{
+    ns_radix_sort_internal(pBase, count, stride, keyOffset, sizeof(float), NS_RADIX_SORT_KEY_FLOAT, ns_radix_sort_compare_f32, pAllocationCallbacks);
+}
+
+NS_API void ns_radix_sort_f64(void* pBase, size_t count, size_t stride, size_t keyOffset, const ns_allocation_callbacks* pAllocationCallbacks)
+{
+    ns_radix_sort_internal(pBase, count, stride, keyOffset, sizeof(double), NS_RADIX_SORT_KEY_FLOAT, ns_radix_sort_compare_f64, pAllocationCallbacks);
+}
+/* END radix_sort.c */
+
+/* BEG sort_parallel.c */
+/*
+A parallel sort built on a small pthread worker pool. The array is split into one chunk per thread and each chunk is sorted with
+ns_sort(). The sorted chunks are then merged pairwise in log2(threadCount) rounds, ping-ponging between the array and a scratch
+buffer of the same size. Every thread takes part in every merge round: the output of each round is divided evenly between the
+threads, and each thread finds where its slice of the output starts in the two input runs with a binary search along the merge
+path. This keeps all threads busy right up until the last merge, and the merges themselves are purely sequential streams which
+is what you want for memory bandwidth.
+
+A threadCount of 0 will use the number of online processors. Small inputs, or if threading is unavailable or the scratch buffer
+can't be allocated, will fall back to the serial ns_sort(). Like ns_sort(), this is not stable.
+
+Threading is only implemented with pthread. Define NS_NO_THREADING to compile this as a plain wrapper around ns_sort().
+*/
+#ifndef NS_SORT_PARALLEL_MIN_COUNT
+#define NS_SORT_PARALLEL_MIN_COUNT      65536   /* Below this the cost of spinning up threads isn't worth it. */
+#endif
+
+#define NS_SORT_PARALLEL_MAX_THREADS    64
+
+#if !defined(NS_NO_THREADING) && !defined(_WIN32)
+#define NS_SORT_PARALLEL_PTHREAD
+#endif
+
+#if defined(NS_SORT_PARALLEL_PTHREAD)
+#include <pthread.h>
+#include <unistd.h> /* For sysconf(). */
+
+typedef struct
+{
+    char* pBase;
+    char* pTemp;
+    size_t count;
+    size_t stride;
+    int (* compareProc)(void*, const void*, const void*);
+    void* pUserData;
+    size_t threadCount;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    size_t barrierCount;
+    size_t barrierGeneration;
+} ns_sort_parallel_context;
+
+typedef struct
+{
+    ns_sort_parallel_context* pContext;
+    size_t threadIndex;
+} ns_sort_parallel_worker;
+
+static void ns_sort_parallel_barrier(ns_sort_parallel_context* pContext)
+{
+    pthread_mutex_lock(&pContext->lock);
+    {
+        size_t generation = pContext->barrierGeneration;
+
+        pContext->barrierCount += 1;
+        if (pContext->barrierCount == pContext->threadCount) {
+            pContext->barrierCount       = 0;
+            pContext->barrierGeneration += 1;
+            pthread_cond_broadcast(&pContext->cond);
+        } else {
+            while (generation == pContext->barrierGeneration) {
+                pthread_cond_wait(&pContext->cond, &pContext->lock);
+            }
+        }
+    }
+    pthread_mutex_unlock(&pContext->lock);
+}
+
+/*
+Returns how many of the first k merged elements come from A. Ties are taken from A first so the merge is consistent no matter
+where the output is split.
+*/
+static size_t ns_sort_parallel_co_rank(const ns_sort_parallel_context* pContext, size_t k, const char* pA, size_t countA, const char* pB, size_t countB)
+{
+    size_t stride = pContext->stride;
+    size_t lo = (k > countB) ? k - countB : 0;
+    size_t hi = (k < countA) ? k : countA;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo)/2;
+
+        if (ns_sort_less(pContext->compareProc, pContext->pUserData, pB + (k - mid - 1)*stride, pA + mid*stride)) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+
+    return lo;
+}
+
+static void ns_sort_parallel_merge(const ns_sort_parallel_context* pContext, const char* pA, const char* pEndA, const char* pB, const char* pEndB, char* pDst)
+{
+    size_t stride = pContext->stride;
+
+    while (pA < pEndA && pB < pEndB) {
+        if (ns_sort_less(pContext->compareProc, pContext->pUserData, pB, pA)) {
+            NS_COPY_MEMORY(pDst, pB, stride);
+            pB += stride;
+        } else {
+            NS_COPY_MEMORY(pDst, pA, stride);
+            pA += stride;
+        }
+
+        pDst += stride;
+    }
+
+    if (pA < pEndA) {
+        NS_COPY_MEMORY(pDst, pA, (size_t)(pEndA - pA));
+    }
+    if (pB < pEndB) {
+        NS_COPY_MEMORY(pDst, pB, (size_t)(pEndB - pB));
+    }
+}
+
+static void ns_sort_parallel_run(ns_sort_parallel_context* pContext, size_t threadIndex)
+{
+    size_t bounds[NS_SORT_PARALLEL_MAX_THREADS + 1];
+    size_t runCount;
+    size_t stride = pContext->stride;
+    size_t threadCount;
+    size_t outputBeg;
+    size_t outputEnd;
+    char* pSrc;
+    char* pDst;
+    size_t i;
+
+    /* The thread count isn't final until every thread has been created. */
+    ns_sort_parallel_barrier(pContext);
+    threadCount = pContext->threadCount;
+
+    /* Every thread computes the same run boundaries. */
+    runCount = threadCount;
+    for (i = 0; i <= runCount; i += 1) {
+        bounds[i] = (pContext->count * i) / runCount;
+    }
+
+    ns_sort(pContext->pBase + bounds[threadIndex]*stride, bounds[threadIndex + 1] - bounds[threadIndex], stride, pContext->compareProc, pContext->pUserData);
+    ns_sort_parallel_barrier(pContext);
+
+    /* Each thread is responsible for the same slice of the output in every round. */
+    outputBeg = (pContext->count * threadIndex)       / threadCount;
+    outputEnd = (pContext->count * (threadIndex + 1)) / threadCount;
+
+    pSrc = pContext->pBase;
+    pDst = pContext->pTemp;
+
+    while (runCount > 1) {
+        size_t iPair;
+        size_t newRunCount = 0;
+        char* pSwap;
+
+        for (iPair = 0; iPair < runCount; iPair += 2) {
+            size_t pairBeg = bounds[iPair];
+            size_t pairEnd = (iPair + 2 <= runCount) ? bounds[iPair + 2] : bounds[iPair + 1];
+            size_t sliceBeg;
+            size_t sliceEnd;
+
+            sliceBeg = (outputBeg > pairBeg) ? outputBeg : pairBeg;
+            sliceEnd = (outputEnd < pairEnd) ? outputEnd : pairEnd;
+
+            if (sliceBeg < sliceEnd) {
+                if (iPair + 1 < runCount) {
+                    const char* pA = pSrc + bounds[iPair]*stride;
+                    const char* pB = pSrc + bounds[iPair + 1]*stride;
+                    size_t countA = bounds[iPair + 1] - bounds[iPair];
+                    size_t countB = pairEnd - bounds[iPair + 1];
+                    size_t begA = ns_sort_parallel_co_rank(pContext, sliceBeg - pairBeg, pA, countA, pB, countB);
+                    size_t endA = ns_sort_parallel_co_rank(pContext, sliceEnd - pairBeg, pA, countA, pB, countB);
+                    size_t begB = (sliceBeg - pairBeg) - begA;
+                    size_t endB = (sliceEnd - pairBeg) - endA;
+
+                    ns_sort_parallel_merge(pContext, pA + begA*stride, pA + endA*stride, pB + begB*stride, pB + endB*stride, pDst + sliceBeg*stride);
+                } else {
+                    /* Odd run out. Just copy it over. */
+                    NS_COPY_MEMORY(pDst + sliceBeg*stride, pSrc + sliceBeg*stride, (sliceEnd - sliceBeg)*stride);
+                }
+            }
+
+            bounds[newRunCount] = pairBeg;
+            newRunCount += 1;
+        }
+
+        bounds[newRunCount] = pContext->count;
+        runCount = newRunCount;
+
+        pSwap = pSrc;
+        pSrc  = pDst;
+        pDst  = pSwap;
+
+        ns_sort_parallel_barrier(pContext);
+    }
+
+    /* An odd number of rounds leaves the result in the scratch buffer. */
+    if (pSrc != pContext->pBase) {
+        NS_COPY_MEMORY(pContext->pBase + outputBeg*stride, pSrc + outputBeg*stride, (outputEnd - outputBeg)*stride);
+    }
+}
+
+static void* ns_sort_parallel_worker_entry(void* pUserData)
+{
+    ns_sort_parallel_worker* pWorker = (ns_sort_parallel_worker*)pUserData;
+    ns_sort_parallel_run(pWorker->pContext, pWorker->threadIndex);
+    return NULL;
+}
+
+static size_t ns_sort_parallel_get_processor_count(void)
+{
+#if defined(_SC_NPROCESSORS_ONLN)
+    long processorCount = sysconf(_SC_NPROCESSORS_ONLN);
+    if (processorCount > 0) {
+        return (size_t)processorCount;
+    }
+#endif
+
+    return 1;
+}
+#endif  /* NS_SORT_PARALLEL_PTHREAD */
+
+NS_API void ns_sort_parallel(void* pBase, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData, size_t threadCount, const ns_allocation_callbacks* pAllocationCallbacks)
+{
+#if defined(NS_SORT_PARALLEL_PTHREAD)
+    ns_sort_parallel_context context;
+    ns_sort_parallel_worker workers[NS_SORT_PARALLEL_MAX_THREADS];
+    pthread_t threads[NS_SORT_PARALLEL_MAX_THREADS];
+    size_t createdCount;
+    size_t i;
+
+    if (pBase == NULL || count < 2 || stride == 0 || compareProc == NULL) {
+        return;
+    }
+
+    if (threadCount == 0) {
+        threadCount = ns_sort_parallel_get_processor_count();
+    }
+
+    if (threadCount > NS_SORT_PARALLEL_MAX_THREADS) {
+        threadCount = NS_SORT_PARALLEL_MAX_THREADS;
+    }
+
+    /* Make sure each thread has a decent amount of work. */
+    if (threadCount > count / (NS_SORT_PARALLEL_MIN_COUNT/2)) {
+        threadCount = count / (NS_SORT_PARALLEL_MIN_COUNT/2);
+    }
+
+    if (threadCount < 2) {
+        ns_sort(pBase, count, stride, compareProc, pUserData);
+        return;
+    }
+
+    context.pTemp = (char*)ns_malloc(count * stride, pAllocationCallbacks);
+    if (context.pTemp == NULL) {
+        ns_sort(pBase, count, stride, compareProc, pUserData);
+        return;
+    }
+
+    context.pBase             = (char*)pBase;
+    context.count             = count;
+    context.stride            = stride;
+    context.compareProc       = compareProc;
+    context.pUserData         = pUserData;
+    context.threadCount       = threadCount;
+    context.barrierCount      = 0;
+    context.barrierGeneration = 0;
+
+    if (pthread_mutex_init(&context.lock, NULL) != 0) {
+        ns_free(context.pTemp, pAllocationCallbacks);
+        ns_sort(pBase, count, stride, compareProc, pUserData);
+        return;
+    }
+
+    if (pthread_cond_init(&context.cond, NULL) != 0) {
+        pthread_mutex_destroy(&context.lock);
+        ns_free(context.pTemp, pAllocationCallbacks);
+        ns_sort(pBase, count, stride, compareProc, pUserData);
+        return;
+    }
+
+    /*
+    The lock is held while the threads are being created so that none of them can get through the first barrier until we know
+    how many were actually created. The calling thread is worker 0.
+    */
+    createdCount = 1;
+    pthread_mutex_lock(&context.lock);
+    {
+        for (i = 1; i < threadCount; i += 1) {
+            workers[i].pContext    = &context;
+            workers[i].threadIndex = i;
+
+            if (pthread_create(&threads[i], NULL, ns_sort_parallel_worker_entry, &workers[i]) != 0) {
+                break;
+            }
+
+            createdCount += 1;
+        }
+
+        context.threadCount = createdCount;
+    }
+    pthread_mutex_unlock(&context.lock);
+
+    ns_sort_parallel_run(&context, 0);
+
+    for (i = 1; i < createdCount; i += 1) {
+        pthread_join(threads[i], NULL);
+    }
+
+    pthread_cond_destroy(&context.cond);
+    pthread_mutex_destroy(&context.lock);
+    ns_free(context.pTemp, pAllocationCallbacks);
+#else
+    NS_UNUSED(threadCount);
+    NS_UNUSED(pAllocationCallbacks);
+    ns_sort(pBase, count, stride, compareProc, pUserData);
+#endif
+}
+/* END sort_parallel.c */
+
+/* BEG argsort.c */
+/*
+ns_argsort() fills pIndices with the permutation that would sort the array, without moving any of the records. ns_argsort_u32()
+is the same thing with 32-bit indices which halves the memory traffic of the index sort. The count must fit in 32 bits.
+
+ns_sort_indirect() is for records that are expensive to move. It sorts an index array instead of the records themselves, and
+then applies the permutation in place by following its cycles, which means each record is moved exactly once plus one copy to a
+temporary per cycle. For large strides this is a lot less memory traffic than ns_sort() which moves records on every swap.
+
+Records that compare equal are ordered by their original position which means all of these are stable.
+*/
+typedef struct
+{
+    const char* pBase;
+    size_t stride;
+    int (* compareProc)(void*, const void*, const void*);
+    void* pUserData;
+} ns_argsort_context;
+
+static int ns_argsort_compare(void* pUserData, const void* a, const void* b)
+{
+    const ns_argsort_context* pContext = (const ns_argsort_context*)pUserData;
+    size_t indexA = *(const size_t*)a;
+    size_t indexB = *(const size_t*)b;
+    int result;
+
+    result = pContext->compareProc(pContext->pUserData, pContext->pBase + indexA*pContext->stride, pContext->pBase + indexB*pContext->stride);
+    if (result != 0) {
+        return result;
+    }
+
+    return (indexA > indexB) - (indexA < indexB);
+}
+
+static int ns_argsort_compare_u32(void* pUserData, const void* a, const void* b)
+{
+    const ns_argsort_context* pContext = (const ns_argsort_context*)pUserData;
+    ns_uint32 indexA = *(const ns_uint32*)a;
+    ns_uint32 indexB = *(const ns_uint32*)b;
+    int result;
+
+    result = pContext->compareProc(pContext->pUserData, pContext->pBase + indexA*pContext->stride, pContext->pBase + indexB*pContext->stride);
+    if (result != 0) {
+        return result;
+    }
+
+    return (indexA > indexB) - (indexA < indexB);
+}
+
+NS_API void ns_argsort(const void* pBase, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData, size_t* pIndices)
+{
+    ns_argsort_context context;
+    size_t i;
+
+    if (pBase == NULL || pIndices == NULL || compareProc == NULL) {
+        return;
+    }
+
+    for (i = 0; i < count; i += 1) {
+        pIndices[i] = i;
+    }
+
+    context.pBase       = (const char*)pBase;
+    context.stride      = stride;
+    context.compareProc = compareProc;
+    context.pUserData   = pUserData;
+
+    ns_sort(pIndices, count, sizeof(*pIndices), ns_argsort_compare, &context);
+}
+
+NS_API void ns_argsort_u32(const void* pBase, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData, ns_uint32* pIndices)
+{
+    ns_argsort_context context;
+    size_t i;
+
+    if (pBase == NULL || pIndices == NULL || compareProc == NULL || count > NS_UINT32_MAX) {
+        return;
+    }
+
+    for (i = 0; i < count; i += 1) {
+        pIndices[i] = (ns_uint32)i;
+    }
+
+    context.pBase       = (const char*)pBase;
+    context.stride      = stride;
+    context.compareProc = compareProc;
+    context.pUserData   = pUserData;
+
+    ns_sort(pIndices, count, sizeof(*pIndices), ns_argsort_compare_u32, &context);
+}
+
+/*
+Moves records such that the record at pIndices[i] ends up at i. Each cycle of the permutation is walked once with the first
+record of the cycle held in pTemp. Visited entries are marked by pointing them at themselves which destroys pIndices.
+*/
+static void ns_sort_indirect_apply_permutation(char* pBase, size_t count, size_t stride, size_t* pIndices, void* pTemp)
+{
+    size_t i;
+
+    for (i = 0; i < count; i += 1) {
+        size_t iDst;
+
+        if (pIndices[i] == i) {
+            continue;   /* Already in place or already visited. */
+        }
+
+        NS_COPY_MEMORY(pTemp, pBase + i*stride, stride);
+
+        iDst = i;
+        for (;;) {
+            size_t iSrc = pIndices[iDst];
+            pIndices[iDst] = iDst;
+
+            if (iSrc == i) {
+                NS_COPY_MEMORY(pBase + iDst*stride, pTemp, stride);
+                break;
+            }
+
+            NS_COPY_MEMORY(pBase + iDst*stride, pBase + iSrc*stride, stride);
+            iDst = iSrc;
+        }
+    }
+}
+
+NS_API void ns_sort_indirect(void* pBase, size_t count, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData, const ns_allocation_callbacks* pAllocationCallbacks)
+{
+    size_t* pIndices;
+    char stackTemp[NS_SORT_TEMP_BUFFER_SIZE];
+    void* pTemp;
+
+    if (pBase == NULL || count < 2 || stride == 0 || compareProc == NULL) {
+        return;
+    }
+
+    pIndices = (size_t*)ns_malloc(count * sizeof(*pIndices), pAllocationCallbacks);
+    if (pIndices == NULL) {
+        ns_sort_stable(pBase, count, stride, compareProc, pUserData, pAllocationCallbacks);
+        return;
+    }
+
+    if (stride <= sizeof(stackTemp)) {
+        pTemp = stackTemp;
+    } else {
+        pTemp = ns_malloc(stride, pAllocationCallbacks);
+        if (pTemp == NULL) {
+            ns_free(pIndices, pAllocationCallbacks);
+            ns_sort_stable(pBase, count, stride, compareProc, pUserData, pAllocationCallbacks);
+            return;
+        }
+    }
+
+    ns_argsort(pBase, count, stride, compareProc, pUserData, pIndices);
+    ns_sort_indirect_apply_permutation((char*)pBase, count, stride, pIndices, pTemp);
+
+    if (pTemp != stackTemp) {
+        ns_free(pTemp, pAllocationCallbacks);
+    }
+
+    ns_free(pIndices, pAllocationCallbacks);
+}
+/* END argsort.c */
+
+/* BEG sort_soa.c */
+/*
+Sorts columnar data where the keys and each payload column live in separate arrays. Element i of every column belongs with key i.
+The key column is sorted, and every payload column is rearranged to match, without building rows.
+
+The permutation is computed first. ns_sort_soa() uses ns_argsort() with compareProc, which is passed pointers to the key
+elements. The typed versions instead radix sort (key, index) pairs, where the key is the first 4 or 8 bytes of each key element,
+with the same ordering as the matching ns_radix_sort_*() function.
+Each column, including the keys, is then gathered through the permutation into a scratch buffer and copied back. A gather reads
+scattered but writes sequentially, and doing one column at a time means each pass only touches two arrays. The scratch buffer
+is shared by all columns.
+
+Everything is allocated before anything is moved. If an allocation fails, NS_OUT_OF_MEMORY is returned and the columns are left
+untouched. All of these are stable.
+*/
+static void ns_sort_soa_gather(char* pDst, const char* pSrc, size_t stride, const size_t* pIndices, size_t count)
+{
+    size_t i;
+
+    /* The element size is constant in the common cases which lets the compiler turn the copy into a single move. */
+    if (stride == 4) {
+        for (i = 0; i < count; i += 1) {
+            NS_COPY_MEMORY(pDst + i*4, pSrc + pIndices[i]*4, 4);
+        }
+    } else if (stride == 8) {
+        for (i = 0; i < count; i += 1) {
+            NS_COPY_MEMORY(pDst + i*8, pSrc + pIndices[i]*8, 8);
+        }
+    } else {
+        for (i = 0; i < count; i += 1) {
+            NS_COPY_MEMORY(pDst + i*stride, pSrc + pIndices[i]*stride, stride);
+        }
+    }
+}
+
+static ns_result ns_sort_soa_apply(void* pKeys, size_t count, size_t keyStride, void** ppColumns, const size_t* pColumnStrides, size_t columnCount, const size_t* pIndices, const ns_allocation_callbacks* pAllocationCallbacks)
+{
+    size_t maxStride = keyStride;
+    char* pTemp;
+    size_t iColumn;
+
+    for (iColumn = 0; iColumn < columnCount; iColumn += 1) {
+        if (maxStride < pColumnStrides[iColumn]) {
+            maxStride = pColumnStrides[iColumn];
+        }
+    }
+
+    pTemp = (char*)ns_malloc(count * maxStride, pAllocationCallbacks);
+    if (pTemp == NULL) {
+        return NS_OUT_OF_MEMORY;
+    }
+
+    ns_sort_soa_gather(pTemp, (const char*)pKeys, keyStride, pIndices, count);
+    NS_COPY_MEMORY(pKeys, pTemp, count * keyStride);
+
+    for (iColumn = 0; iColumn < columnCount; iColumn += 1) {
+        size_t stride = pColumnStrides[iColumn];
+
+        if (ppColumns[iColumn] == NULL || stride == 0) {
+            continue;
+        }
+
+        ns_sort_soa_gather(pTemp, (const char*)ppColumns[iColumn], stride, pIndices, count);
+        NS_COPY_MEMORY(ppColumns[iColumn], pTemp, count * stride);
+    }
+
+    ns_free(pTemp, pAllocationCallbacks);
+    return NS_SUCCESS;
+}
+
+static ns_result ns_sort_soa_check_args(void* pKeys, size_t keyStride, void** ppColumns, const size_t* pColumnStrides, size_t columnCount)
+{
+    if (pKeys == NULL || keyStride == 0) {
+        return NS_INVALID_ARGS;
+    }
+
+    if (columnCount > 0 && (ppColumns == NULL || pColumnStrides == NULL)) {
+        return NS_INVALID_ARGS;
+    }
+
+    return NS_SUCCESS;
+}
+
+NS_API ns_result ns_sort_soa(void* pKeys, size_t count, size_t keyStride, int (*compareProc)(void*, const void*, const void*), void* pUserData, void** ppColumns, const size_t* pColumnStrides, size_t columnCount, const ns_allocation_callbacks* pAllocationCallbacks)
+{
+    ns_result result;
+    size_t* pIndices;
+
+    result = ns_sort_soa_check_args(pKeys, keyStride, ppColumns, pColumnStrides, columnCount);
+    if (result != NS_SUCCESS || compareProc == NULL) {
+        return NS_INVALID_ARGS;
+    }
+
+    if (count < 2) {
+        return NS_SUCCESS;
+    }
+
+    pIndices = (size_t*)ns_malloc(count * sizeof(*pIndices), pAllocationCallbacks);
+    if (pIndices == NULL) {
+        return NS_OUT_OF_MEMORY;
+    }
+
+    ns_argsort(pKeys, count, keyStride, compareProc, pUserData, pIndices);
+    result = ns_sort_soa_apply(pKeys, count, keyStride, ppColumns, pColumnStrides, columnCount, pIndices, pAllocationCallbacks);
+
+    ns_free(pIndices, pAllocationCallbacks);
+    return result;
+}
+
+/*
+The pairs are 8 bytes when both the key and the index fit in 32 bits, and 16 bytes otherwise. The index comes straight after the
+key. Once sorted, the indices are compacted to the front of the same buffer as size_t's, which never overtakes the pairs still to
+be read since a size_t is never bigger than a pair.
+*/
+static ns_result ns_sort_soa_radix(void* pKeys, size_t count, size_t keyStride, size_t keySize, ns_radix_sort_key_type keyType, int (*fallbackCompareProc)(void*, const void*, const void*), void** ppColumns, const size_t* pColumnStrides, size_t columnCount, const ns_allocation_callbacks* pAllocationCallbacks)
+{
+    ns_result result;
+    size_t indexSize;
+    size_t pairSize;
+    char* pPairs;
+    size_t* pIndices;
+    size_t i;
+
+    result = ns_sort_soa_check_args(pKeys, keyStride, ppColumns, pColumnStrides, columnCount);
+    if (result != NS_SUCCESS || keyStride < keySize) {
+        return NS_INVALID_ARGS;
+    }
+
+    if (count < 2) {
+        return NS_SUCCESS;
+    }
+
+    indexSize = (keySize == 4 && count <= NS_UINT32_MAX) ? 4 : 8;
+    pairSize  = keySize + indexSize;
+    if (pairSize < 8) {
+        pairSize = 8;
+    }
+    if (pairSize == 12) {
+        pairSize = 16;  /* Keeps the 64-bit index aligned. */
+    }
+
+    pPairs = (char*)ns_malloc(count * pairSize, pAllocationCallbacks);
+    if (pPairs == NULL) {
+        return NS_OUT_OF_MEMORY;
+    }
+
+    for (i = 0; i < count; i += 1) {
+        char* pPair = pPairs + i*pairSize;
+
+        NS_COPY_MEMORY(pPair, (const char*)pKeys + i*keyStride, keySize);
+
+        if (indexSize == 4) {
+            ns_uint32 index = (ns_uint32)i;
+            NS_COPY_MEMORY(pPair + pairSize - 4, &index, 4);
+        } else {
+            ns_uint64 index = (ns_uint64)i;
+            NS_COPY_MEMORY(pPair + pairSize - 8, &index, 8);
+        }
+    }
+
+    ns_radix_sort_internal(pPairs, count, pairSize, 0, keySize, keyType, fallbackCompareProc, pAllocationCallbacks);
+
+    pIndices = (size_t*)pPairs;
+    for (i = 0; i < count; i += 1) {
+        const char* pPair = pPairs + i*pairSize;
+
+        if (indexSize == 4) {
+            ns_uint32 index;
+            NS_COPY_MEMORY(&index, pPair + pairSize - 4, 4);
+            pIndices[i] = (size_t)index;
+        } else {
+            ns_uint64 index;
+            NS_COPY_MEMORY(&index, pPair + pairSize - 8, 8);
+            pIndices[i] = (size_t)index;
+        }
+    }
+
+    result = ns_sort_soa_apply(pKeys, count, keyStride, ppColumns, pColumnStrides, columnCount, pIndices, pAllocationCallbacks);
+
+    ns_free(pPairs, pAllocationCallbacks);
+    return result;
+}
+
+NS_API ns_result ns_sort_soa_u32(void* pKeys, size_t count, size_t keyStride, void** ppColumns, const size_t* pColumnStrides, size_t columnCount, const ns_allocation_callbacks* pAllocationCallbacks)
+{
+    return ns_sort_soa_radix(pKeys, count, keyStride, sizeof(ns_uint32), NS_RADIX_SORT_KEY_UNSIGNED, ns_radix_sort_compare_u32, ppColumns, pColumnStrides, columnCount, pAllocationCallbacks);
+}
+
+NS_API ns_result ns_sort_soa_u64(void* pKeys, size_t count, size_t keyStride, void** ppColumns, const size_t* pColumnStrides, size_t columnCount, const ns_allocation_callbacks* pAllocationCallbacks)
+{
+    return ns_sort_soa_radix(pKeys, count, keyStride, sizeof(ns_uint64), NS_RADIX_SORT_KEY_UNSIGNED, ns_radix_sort_compare_u64, ppColumns, pColumnStrides, columnCount, pAllocationCallbacks);
+}
+
+NS_API ns_result ns_sort_soa_i32(void* pKeys, size_t count, size_t keyStride, void** ppColumns, const size_t* pColumnStrides, size_t columnCount, const ns_allocation_callbacks* pAllocationCallbacks)
+{
+    return ns_sort_soa_radix(pKeys, count, keyStride, sizeof(ns_int32), NS_RADIX_SORT_KEY_SIGNED, ns_radix_sort_compare_i32, ppColumns, pColumnStrides, columnCount, pAllocationCallbacks);
+}
+
+NS_API ns_result ns_sort_soa_i64(void* pKeys, size_t count, size_t keyStride, void** ppColumns, const size_t* pColumnStrides, size_t columnCount, const ns_allocation_callbacks* pAllocationCallbacks)
+{
+    return ns_sort_soa_radix(pKeys, count, keyStride, sizeof(ns_int64), NS_RADIX_SORT_KEY_SIGNED, ns_radix_sort_compare_i64, ppColumns, pColumnStrides, columnCount, pAllocationCallbacks);
+}
+
+NS_API ns_result ns_sort_soa_f32(void* pKeys, size_t count, size_t keyStride, void** ppColumns, const size_t* pColumnStrides, size_t columnCount, const ns_allocation_callbacks* pAllocationCallbacks)
+{
+    return ns_sort_soa_radix(pKeys, count, keyStride, sizeof(float), NS_RADIX_SORT_KEY_FLOAT, ns_radix_sort_compare_f32, ppColumns, pColumnStrides, columnCount, pAllocationCallbacks);
+}
+
+NS_API ns_result ns_sort_soa_f64(void* pKeys, size_t count, size_t keyStride, void** ppColumns, const size_t* pColumnStrides, size_t columnCount, const ns_allocation_callbacks* pAllocationCallbacks)
+{
+    return ns_sort_soa_radix(pKeys, count, keyStride, sizeof(double), NS_RADIX_SORT_KEY_FLOAT, ns_radix_sort_compare_f64, ppColumns, pColumnStrides, columnCount, pAllocationCallbacks);
+}
+/* END sort_soa.c */
+
+/* BEG select.c */
+/*
+ns_select_nth() rearranges the array such that the element at index nth is the one that would be there if the array was fully
+sorted, everything before it is not greater than it, and everything after it is not less than it. This is an introselect. It
+uses the same pivot selection and partitioning as ns_sort(), but only continues into the side containing nth which makes it
+linear on average. If too many bad partitions are encountered it falls back to heapsorting what's left, which bounds the worst
+case to O(n log n).
+
+ns_partial_sort() moves the smallest k elements to the front of the array in sorted order. The order of the remaining elements is
+unspecified. When k is small relative to count this is done with a bounded max-heap of k elements, which for the common case
+of a handful of elements out of millions means nearly every element is rejected with a single comparison against the root.
+Otherwise it's a selection followed by a sort of the first k elements.
+*/
+#define NS_PARTIAL_SORT_HEAP_RATIO  1024    /* Use a heap when k is less than count/NS_PARTIAL_SORT_HEAP_RATIO. */
+
+static void ns_select_loop(char* pBegin, char* pEnd, char* pNth, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData, int badAllowed)
+{
+    int leftmost = 1;
+
+    for (;;) {
+        size_t count = (size_t)(pEnd - pBegin) / stride;
+        size_t countL;
+        size_t countR;
+        char* pPivotPos;
+        int alreadyPartitioned;
+
+        if (count < NS_SORT_INSERTION_SORT_THRESHOLD) {
+            ns_sort_insertion(pBegin, pEnd, stride, compareProc, pUserData);
+            return;
+        }
+
+        ns_sort_choose_pivot(pBegin, pEnd, count, stride, compareProc, pUserData);
+
+        /* See ns_sort_loop(). Everything that ends up on the left here is equal to the pivot so if nth is in there we're done. */
+        if (!leftmost && !ns_sort_less(compareProc, pUserData, pBegin - stride, pBegin)) {
+            pPivotPos = ns_sort_partition_left(pBegin, pEnd, stride, compareProc, pUserData);
+            if (pNth <= pPivotPos) {
+                return;
+            }
+
+            pBegin = pPivotPos + stride;
+            continue;
+        }
+
+        pPivotPos = ns_sort_partition_right(pBegin, pEnd, stride, compareProc, pUserData, &alreadyPartitioned);
+        if (pPivotPos == pNth) {
+            return;
+        }
+
+        countL = (size_t)(pPivotPos - pBegin) / stride;
+        countR = (size_t)(pEnd - (pPivotPos + stride)) / stride;
+
+        if (countL < count/8 || countR < count/8) {
+            badAllowed -= 1;
+            if (badAllowed == 0) {
+                ns_sort_heapsort(pBegin, count, stride, compareProc, pUserData);
+                return;
+            }
+
+            ns_sort_break_patterns(pBegin, pPivotPos, countL, stride);
+            ns_sort_break_patterns(pPivotPos + stride, pEnd, countR, stride);
+        }
+
+        if (pNth < pPivotPos) {
+            pEnd = pPivotPos;
+        } else {
+            pBegin   = pPivotPos + stride;
+            leftmost = 0;
+        }
+    }
+}
+
+NS_API void ns_select_nth(void* pBase, size_t count, size_t stride, size_t nth, int (*compareProc)(void*, const void*, const void*), void* pUserData)
+{
+    int badAllowed = 0;
+    size_t n;
+
+    if (pBase == NULL || count < 2 || stride == 0 || compareProc == NULL || nth >= count) {
+        return;
+    }
+
+    for (n = count; n > 1; n >>= 1) {
+        badAllowed += 1;
+    }
+
+    ns_select_loop((char*)pBase, (char*)pBase + count*stride, (char*)pBase + nth*stride, stride, compareProc, pUserData, badAllowed);
+}
+
+NS_API void ns_partial_sort(void* pBase, size_t count, size_t stride, size_t k, int (*compareProc)(void*, const void*, const void*), void* pUserData)
+{
+    char* pHeap = (char*)pBase;
+
+    if (pBase == NULL || k == 0 || stride == 0 || compareProc == NULL) {
+        return;
+    }
+
+    if (k >= count) {
+        ns_sort(pBase, count, stride, compareProc, pUserData);
+        return;
+    }
+
+    if (k < count / NS_PARTIAL_SORT_HEAP_RATIO) {
+        size_t i;
+
+        /* The first k elements become a max-heap holding the smallest k elements seen so far. */
+        for (i = k/2; i > 0; i -= 1) {
+            ns_sort_heap_sift_down(pHeap, i - 1, k, stride, compareProc, pUserData);
+        }
+
+        for (i = k; i < count; i += 1) {
+            char* pElement = pHeap + i*stride;
+
+            if (ns_sort_less(compareProc, pUserData, pElement, pHeap)) {
+                ns_sort_swap(pElement, pHeap, stride);
+                ns_sort_heap_sift_down(pHeap, 0, k, stride, compareProc, pUserData);
+            }
+        }
+
+        ns_sort_heapsort(pHeap, k, stride, compareProc, pUserData);
+    } else {
+        /* The element at k-1 is already in its final position after the selection. */
+        ns_select_nth(pBase, count, stride, k - 1, compareProc, pUserData);
+        ns_sort(pBase, k - 1, stride, compareProc, pUserData);
+    }
+}
+/* END select.c */
+
+/* BEG topk.c */
+/*
+A streaming top-k. This keeps the smallest k records it has been given, as ordered by compareProc, in a bounded max-heap. Records
+can be pushed in batches of any size, and each record that doesn't make the cut costs a single comparison against the root of
+the heap. Use a reversed comparison to keep the largest k instead.
+
+    ns_topk topk;
+    ns_topk_init(100, sizeof(my_row), my_compare, NULL, NULL, &topk);
+
+    while (more rows) {
+        ns_topk_push(&topk, pRows, rowCount);
+    }
+
+    count = ns_topk_get(&topk, pResults);   // pResults is now sorted.
+    ns_topk_uninit(&topk);
+*/
+static void ns_topk_sift_up(char* pHeap, size_t index, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData)
+{
+    while (index > 0) {
+        size_t parent = (index - 1) / 2;
+
+        if (!ns_sort_less(compareProc, pUserData, pHeap + parent*stride, pHeap + index*stride)) {
+            break;
+        }
+
+        ns_sort_swap(pHeap + parent*stride, pHeap + index*stride, stride);
+        index = parent;
+    }
+}
+
+NS_API ns_result ns_topk_init(size_t k, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData, const ns_allocation_callbacks* pAllocationCallbacks, ns_topk* pTopK)
+{
+    if (pTopK == NULL) {
+        return NS_INVALID_ARGS;
+    }
+
+    NS_ZERO_MEMORY(pTopK, sizeof(*pTopK));
+
+    if (k == 0 || stride == 0 || compareProc == NULL) {
+        return NS_INVALID_ARGS;
+    }
+
+    if (k > NS_SIZE_MAX / stride) {
+        return NS_TOO_BIG;
+    }
+
+    pTopK->allocationCallbacks = ns_allocation_callbacks_init_copy(pAllocationCallbacks);
+
+    pTopK->pHeap = (char*)ns_malloc(k * stride, &pTopK->allocationCallbacks);
+    if (pTopK->pHeap == NULL) {
+        return NS_OUT_OF_MEMORY;
+    }
+
+    pTopK->capacity    = k;
+    pTopK->count       = 0;
+    pTopK->stride      = stride;
+    pTopK->compareProc = compareProc;
+    pTopK->pUserData   = pUserData;
+
+    return NS_SUCCESS;
+}
+
+NS_API void ns_topk_uninit(ns_topk* pTopK)
+{
+    if (pTopK == NULL) {
+        return;
+    }
+
+    ns_free(pTopK->pHeap, &pTopK->allocationCallbacks);
+    pTopK->pHeap = NULL;
+}
+
+NS_API void ns_topk_reset(ns_topk* pTopK)
+{
+    if (pTopK == NULL) {
+        return;
+    }
+
+    pTopK->count = 0;
+}
+
+NS_API void ns_topk_push(ns_topk* pTopK, const void* pRecords, size_t count)
+{
+    const char* pRecord = (const char*)pRecords;
+    size_t stride;
+    size_t i;
+
+    if (pTopK == NULL || pTopK->pHeap == NULL || pRecords == NULL) {
+        return;
+    }
+
+    stride = pTopK->stride;
+
+    for (i = 0; i < count; i += 1) {
+        if (pTopK->count < pTopK->capacity) {
+            NS_COPY_MEMORY(pTopK->pHeap + pTopK->count*stride, pRecord, stride);
+            ns_topk_sift_up(pTopK->pHeap, pTopK->count, stride, pTopK->compareProc, pTopK->pUserData);
+            pTopK->count += 1;
+        } else if (ns_sort_less(pTopK->compareProc, pTopK->pUserData, pRecord, pTopK->pHeap)) {
+            NS_COPY_MEMORY(pTopK->pHeap, pRecord, stride);
+            ns_sort_heap_sift_down(pTopK->pHeap, 0, pTopK->count, stride, pTopK->compareProc, pTopK->pUserData);
+        }
+
+        pRecord += stride;
+    }
+}
+
+/* Writes the records currently held to pOut in sorted order and returns how many there are. The top-k itself is not modified. */
+NS_API size_t ns_topk_get(const ns_topk* pTopK, void* pOut)
+{
+    if (pTopK == NULL || pTopK->pHeap == NULL || pOut == NULL) {
+        return 0;
+    }
+
+    NS_COPY_MEMORY(pOut, pTopK->pHeap, pTopK->count * pTopK->stride);
+    ns_sort_heapsort((char*)pOut, pTopK->count, pTopK->stride, pTopK->compareProc, pTopK->pUserData);
+
+    return pTopK->count;
+}
+/* END topk.c */
+
+/* BEG loser_tree.c */
+/*
+A loser tree for merging k sorted runs, used by both ns_merge_k() and the external sort. It's laid out like a heap with the runs as
+the leaves at k..2k-1 and the internal nodes at 1..k-1. Each internal node holds the loser of the match played there, and node 0
+holds the overall winner, so the next record is found with log2(k) comparisons along one path.
+
+The tree only looks at ppHeads, which holds the current record of each run, or NULL once a run is exhausted. After taking the
+winner's record, the caller moves its head along and calls ns_loser_tree_replay(). Ties go to the lower run so merges are stable.
+*/
+typedef struct
+{
+    const char** ppHeads;
+    size_t* pNodes;     /* k entries. */
+    size_t k;
+    int (* compareProc)(void*, const void*, const void*);
+    void* pUserData;
+} ns_loser_tree;
+
+/* Returns non-zero if the head of run a should be output before that of run b. Exhausted runs lose to everything. */
+static int ns_loser_tree_beats(const ns_loser_tree* pTree, size_t a, size_t b)
+{
+    int result;
+
+    if (pTree->ppHeads[a] == NULL) {
+        return 0;
+    }
+    if (pTree->ppHeads[b] == NULL) {
+        return 1;
+    }
+
+    result = pTree->compareProc(pTree->pUserData, pTree->ppHeads[a], pTree->ppHeads[b]);
+    return result < 0 || (result == 0 && a < b);
+}
+
+static size_t ns_loser_tree_build(ns_loser_tree* pTree, size_t node)
+{
+    size_t winnerL;
+    size_t winnerR;
+
+    if (node >= pTree->k) {
+        return node - pTree->k;
+    }
+
+    winnerL = ns_loser_tree_build(pTree, node*2 + 0);
+    winnerR = ns_loser_tree_build(pTree, node*2 + 1);
+
+    if (ns_loser_tree_beats(pTree, winnerL, winnerR)) {
+        pTree->pNodes[node] = winnerR;
+        return winnerL;
+    } else {
+        pTree->pNodes[node] = winnerL;
+        return winnerR;
+    }
+}
+
+static void ns_loser_tree_init(ns_loser_tree* pTree, const char** ppHeads, size_t* pNodes, size_t k, int (*compareProc)(void*, const void*, const void*), void* pUserData)
+{
+    pTree->ppHeads     = ppHeads;
+    pTree->pNodes      = pNodes;
+    pTree->k           = k;
+    pTree->compareProc = compareProc;
+    pTree->pUserData   = pUserData;
+
+    pTree->pNodes[0] = ns_loser_tree_build(pTree, 1);
+}
+
+/* The run whose head goes next. Its head is NULL if every run is exhausted. */
+static NS_INLINE size_t ns_loser_tree_winner(const ns_loser_tree* pTree)
+{
+    return pTree->pNodes[0];
+}
+
+/* Replays the matches on the path from the winner's leaf to the root after its head has changed. */
+static NS_INLINE void ns_loser_tree_replay(ns_loser_tree* pTree)
+{
+    size_t* pNodes = pTree->pNodes;
+    size_t winner = pNodes[0];
+    size_t node;
+
+    for (node = (winner + pTree->k) / 2; node > 0; node /= 2) {
+        if (ns_loser_tree_beats(pTree, pNodes[node], winner)) {
+            size_t temp = pNodes[node];
+            pNodes[node] = winner;
+            winner = temp;
+        }
+    }
+
+    pNodes[0] = winner;
+}
+/* END loser_tree.c */
+
+/* BEG merge_k.c */
+/*
+Merges runCount sorted runs into pOut, which must have room for the sum of pCounts. The runs must not overlap pOut. This is a lot
+cheaper than concatenating the runs and sorting them again.
+
+More than two runs are merged with a loser tree which takes log2(k) comparisons per record. Two runs are merged directly, and the
+choice of which record to take is a select rather than a branch. Empty runs are dropped up front, so merging one busy shard with a
+few empty ones still takes the two-way path. The merge is stable: records that compare equal come out in run order.
+
+ns_merge_k_unique() is the same except only the first of each group of equal records is output, including duplicates within a
+single run. The number of records written is returned in pOutCount.
+
+The loser tree needs some state per run. Up to NS_MERGE_K_STACK_RUNS runs this lives on the stack, otherwise it's allocated, and
+NS_OUT_OF_MEMORY is returned if that fails.
+*/
+#define NS_MERGE_K_STACK_RUNS   64
+
+typedef struct
+{
+    const char* pCursor;
+    const char* pEnd;
+} ns_merge_k_run;
+
+typedef struct
+{
+    size_t stride;
+    int (* compareProc)(void*, const void*, const void*);
+    void* pUserData;
+    int unique;
+    char* pOut;
+    size_t outCount;
+} ns_merge_k_context;
+
+static NS_INLINE void ns_merge_k_emit(ns_merge_k_context* pContext, const char* pRecord)
+{
+    char* pDst = pContext->pOut + pContext->outCount*pContext->stride;
+
+    if (pContext->unique && pContext->outCount > 0 && pContext->compareProc(pContext->pUserData, pDst - pContext->stride, pRecord) == 0) {
+        return;
+    }
+
+    NS_COPY_MEMORY(pDst, pRecord, pContext->stride);
+    pContext->outCount += 1;
+}
+
+static void ns_merge_k_two(ns_merge_k_context* pContext, const char* pA, const char* pEndA, const char* pB, const char* pEndB)
+{
+    size_t stride = pContext->stride;
+
+    while (pA < pEndA && pB < pEndB) {
+        /* The only branch that depends on the data is inside the comparison. Compilers turn the pointer select into a cmov. */
+        size_t takeB = (size_t)(pContext->compareProc(pContext->pUserData, pB, pA) < 0);
+        const char* pSrc = takeB ? pB : pA;
+
+        ns_merge_k_emit(pContext, pSrc);
+        pA += (1 - takeB) * stride;
+        pB += (    takeB) * stride;
+    }
+
+    for (; pA < pEndA; pA += stride) {
+        ns_merge_k_emit(pContext, pA);
+    }
+    for (; pB < pEndB; pB += stride) {
+        ns_merge_k_emit(pContext, pB);
+    }
+}
+
+static void ns_merge_k_tree(ns_merge_k_context* pContext, const ns_merge_k_run* pRuns, const char** ppHeads, size_t* pNodes, size_t k, size_t totalCount)
+{
+    ns_loser_tree tree;
+    size_t i;
+
+    for (i = 0; i < k; i += 1) {
+        ppHeads[i] = pRuns[i].pCursor;
+    }
+
+    ns_loser_tree_init(&tree, ppHeads, pNodes, k, pContext->compareProc, pContext->pUserData);
+
+    for (i = 0; i < totalCount; i += 1) {
+        size_t winner = ns_loser_tree_winner(&tree);
+        const char* pNext = ppHeads[winner] + pContext->stride;
+
+        ns_merge_k_emit(pContext, ppHeads[winner]);
+
+        ppHeads[winner] = (pNext == pRuns[winner].pEnd) ? NULL : pNext;
+        ns_loser_tree_replay(&tree);
+    }
+}
+
+static ns_result ns_merge_k_internal(const void** ppRuns, const size_t* pCounts, size_t runCount, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData, void* pOut, int unique, size_t* pOutCount, const ns_allocation_callbacks* pAllocationCallbacks)
+{
+    ns_merge_k_context context;
+    ns_merge_k_run stackRuns[NS_MERGE_K_STACK_RUNS];
+    const char* stackHeads[NS_MERGE_K_STACK_RUNS];
+    size_t stackTree[NS_MERGE_K_STACK_RUNS];
+    ns_merge_k_run* pRuns = stackRuns;
+    const char** ppHeads = stackHeads;
+    size_t* pTree = stackTree;
+    size_t k = 0;
+    size_t totalCount = 0;
+    size_t i;
+
+    if (pOutCount != NULL) {
+        *pOutCount = 0;
+    }
+
+    if ((ppRuns == NULL && runCount > 0) || pCounts == NULL || stride == 0 || compareProc == NULL || pOut == NULL) {
+        return NS_INVALID_ARGS;
+    }
+
+    for (i = 0; i < runCount; i += 1) {
+        if (pCounts[i] > 0) {
+            k += 1;
+        }
+    }
+
+    if (k > NS_MERGE_K_STACK_RUNS) {
+        pRuns = (ns_merge_k_run*)ns_malloc(k * (sizeof(*pRuns) + sizeof(*ppHeads) + sizeof(*pTree)), pAllocationCallbacks);
+        if (pRuns == NULL) {
+            return NS_OUT_OF_MEMORY;
+        }
+
+        ppHeads = (const char**)(pRuns + k);
+        pTree   = (size_t*)(ppHeads + k);
+    }
+
+    k = 0;
+    for (i = 0; i < runCount; i += 1) {
+        if (pCounts[i] > 0) {
+            pRuns[k].pCursor = (const char*)ppRuns[i];
+            pRuns[k].pEnd    = (const char*)ppRuns[i] + pCounts[i]*stride;
+            totalCount += pCounts[i];
+            k += 1;
+        }
+    }
+
+    context.stride      = stride;
+    context.compareProc = compareProc;
+    context.pUserData   = pUserData;
+    context.unique      = unique;
+    context.pOut        = (char*)pOut;
+    context.outCount    = 0;
+
+    if (k == 1 && !unique) {
+        NS_COPY_MEMORY(pOut, pRuns[0].pCursor, totalCount * stride);
+        context.outCount = totalCount;
+    } else if (k == 1) {
+        ns_merge_k_two(&context, pRuns[0].pCursor, pRuns[0].pEnd, NULL, NULL);
+    } else if (k == 2) {
+        ns_merge_k_two(&context, pRuns[0].pCursor, pRuns[0].pEnd, pRuns[1].pCursor, pRuns[1].pEnd);
+    } else if (k > 2) {
+        ns_merge_k_tree(&context, pRuns, ppHeads, pTree, k, totalCount);
+    }
+
+    if (pRuns != stackRuns) {
+        ns_free(pRuns, pAllocationCallbacks);
+    }
+
+    if (pOutCount != NULL) {
+        *pOutCount = context.outCount;
+    }
+
+    return NS_SUCCESS;
+}
+
+NS_API ns_result ns_merge_k(const void** ppRuns, const size_t* pCounts, size_t runCount, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData, void* pOut, const ns_allocation_callbacks* pAllocationCallbacks)
+{
+    return ns_merge_k_internal(ppRuns, pCounts, runCount, stride, compareProc, pUserData, pOut, 0, NULL, pAllocationCallbacks);
+}
+
+NS_API ns_result ns_merge_k_unique(const void** ppRuns, const size_t* pCounts, size_t runCount, size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData, void* pOut, size_t* pOutCount, const ns_allocation_callbacks* pAllocationCallbacks)
+{
+    return ns_merge_k_internal(ppRuns, pCounts, runCount, stride, compareProc, pUserData, pOut, 1, pOutCount, pAllocationCallbacks);
+}
+/* END merge_k.c */
+
+/* BEG sorted_array.c */
+/*
+A sorted array of unique keys, for lookup tables that also get updated now and then. Re-sorting the whole array after every
+insert is quadratic over time. This container writes inserts and erases to a small unsorted delta buffer instead. When the delta
+fills up, it's sorted and merged into the main array in a single linear pass. Lookups check the delta first, newest change first,
+and then binary search the main array.
+
+Inserting a record whose key is already present replaces the old record, and erasing a key that isn't present does nothing.
+Records are compared with compareProc, and so are the keys passed to ns_sorted_array_erase() and ns_sorted_array_find(), which
+means keys must be laid out like full records, or at least enough of one for compareProc.
+
+    ns_sorted_array table;
+    ns_sorted_array_init(sizeof(my_row), my_compare, NULL, 0, NULL, &table);
+
+    ns_sorted_array_insert(&table, &row, 1);
+    pRow = (my_row*)ns_sorted_array_find(&table, &key);
+
+    ns_sorted_array_flush(&table);  // table.pData is now fully sorted and can be used with ns_sorted_search().
+    ns_sorted_array_uninit(&table);
+
+A larger delta makes updates cheaper but lookups slower, since the delta is scanned linearly. A deltaCapacity of 0 starts at
+NS_SORTED_ARRAY_DEFAULT_DELTA_CAPACITY and grows the delta as the table grows, to about the square root of the record count, which
+balances the two. That makes both an update and a lookup cost O(sqrt(n)) on average. The pointer returned by
+ns_sorted_array_find() is valid until the next insert, erase or flush.
+*/
+#ifndef NS_SORTED_ARRAY_DEFAULT_DELTA_CAPACITY
+#define NS_SORTED_ARRAY_DEFAULT_DELTA_CAPACITY  32
+#endif
+
+#define NS_SORTED_ARRAY_OP_INSERT   1
+#define NS_SORTED_ARRAY_OP_ERASE    2
+
+/* The delta must be empty. On failure the old delta is kept. */
+static ns_result ns_sorted_array_alloc_delta(ns_sorted_array* pArray, size_t deltaCapacity)
+{
+    size_t deltaEntrySize;
+    size_t* pDeltaIndices;
+
+    /* The indices go first so they're aligned, then the records, then the ops. */
+    deltaEntrySize = sizeof(size_t) + pArray->stride + 1;
+    if (deltaCapacity > NS_SIZE_MAX / deltaEntrySize) {
+        return NS_TOO_BIG;
+    }
+
+    pDeltaIndices = (size_t*)ns_malloc(deltaCapacity * deltaEntrySize, &pArray->allocationCallbacks);
+    if (pDeltaIndices == NULL) {
+        return NS_OUT_OF_MEMORY;
+    }
+
+    ns_free(pArray->pDeltaIndices, &pArray->allocationCallbacks);
+
+    pArray->pDeltaIndices = pDeltaIndices;
+    pArray->pDelta        = (char*)(pDeltaIndices + deltaCapacity);
+    pArray->pDeltaOps     = (unsigned char*)(pArray->pDelta + deltaCapacity*pArray->stride);
+    pArray->deltaCapacity = deltaCapacity;
+
+    return NS_SUCCESS;
+}
+
+NS_API ns_result ns_sorted_array_init(size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData, size_t deltaCapacity, const ns_allocation_callbacks* pAllocationCallbacks, ns_sorted_array* pArray)
+{
+    if (pArray == NULL) {
+        return NS_INVALID_ARGS;
+    }
+
+    NS_ZERO_MEMORY(pArray, sizeof(*pArray));
+
+    if (stride == 0 || compareProc == NULL) {
+        return NS_INVALID_ARGS;
+    }
+
+    if (deltaCapacity == 0) {
+        deltaCapacity = NS_SORTED_ARRAY_DEFAULT_DELTA_CAPACITY;
+        pArray->autoDeltaCapacity = 1;
+    }
+
+    pArray->allocationCallbacks = ns_allocation_callbacks_init_copy(pAllocationCallbacks);
+    pArray->stride              = stride;
+    pArray->compareProc         = compareProc;
+    pArray->pUserData           = pUserData;
+
+    return ns_sorted_array_alloc_delta(pArray, deltaCapacity);
+}
+
+NS_API void ns_sorted_array_uninit(ns_sorted_array* pArray)
+{
+    if (pArray == NULL) {
+        return;
+    }
+
+    ns_free(pArray->pData, &pArray->allocationCallbacks);
+    ns_free(pArray->pDeltaIndices, &pArray->allocationCallbacks);
+    pArray->pData         = NULL;
+    pArray->pDeltaIndices = NULL;
+}
+
+/* Returns the index of the first record in the main array that isn't less than pKey. */
+static size_t ns_sorted_array_lower_bound(const ns_sorted_array* pArray, const void* pKey)
+{
+    size_t lo = 0;
+    size_t hi = pArray->count;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo)/2;
+
+        if (pArray->compareProc(pArray->pUserData, pArray->pData + mid*pArray->stride, pKey) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+/*
+Merges the delta into the main array. The delta is sorted by key with the newest change last among equal keys, and only the
+newest change for each key is kept. The main array is then grown by the number of inserts and merged from the back, which never
+overwrites a record that's yet to be read. Erases leave a gap at the front which is closed at the end.
+*/
+NS_API ns_result ns_sorted_array_flush(ns_sorted_array* pArray)
+{
+    size_t stride;
+    size_t insertCount = 0;
+    size_t uniqueCount = 0;
+    size_t iRead;
+    size_t iWrite;
+    size_t iDelta;
+    size_t i;
+
+    if (pArray == NULL) {
+        return NS_INVALID_ARGS;
+    }
+
+    if (pArray->deltaCount == 0) {
+        return NS_SUCCESS;
+    }
+
+    stride = pArray->stride;
+
+    /* ns_argsort() is stable so the last of each group of equal keys is the newest. */
+    ns_argsort(pArray->pDelta, pArray->deltaCount, stride, pArray->compareProc, pArray->pUserData, pArray->pDeltaIndices);
+
+    for (i = 0; i < pArray->deltaCount; i += 1) {
+        size_t index = pArray->pDeltaIndices[i];
+
+        if (i + 1 < pArray->deltaCount && pArray->compareProc(pArray->pUserData, pArray->pDelta + index*stride, pArray->pDelta + pArray->pDeltaIndices[i + 1]*stride) == 0) {
+            continue;
+        }
+
+        pArray->pDeltaIndices[uniqueCount] = index;
+        uniqueCount += 1;
+
+        if (pArray->pDeltaOps[index] == NS_SORTED_ARRAY_OP_INSERT) {
+            insertCount += 1;
+        }
+    }
+
+    if (pArray->count + insertCount > pArray->capacity) {
+        size_t newCapacity = pArray->capacity * 2;
+        char* pNewData;
+
+        if (newCapacity < pArray->count + insertCount) {
+            newCapacity = pArray->count + insertCount;
+        }
+
+        if (newCapacity > NS_SIZE_MAX / stride) {
+            return NS_TOO_BIG;
+        }
+
+        pNewData = (char*)ns_realloc(pArray->pData, newCapacity * stride, &pArray->allocationCallbacks);
+        if (pNewData == NULL) {
+            return NS_OUT_OF_MEMORY;    /* The delta is left as is so nothing is lost. */
+        }
+
+        pArray->pData    = pNewData;
+        pArray->capacity = newCapacity;
+    }
+
+    iRead  = pArray->count;
+    iWrite = pArray->count + insertCount;
+
+    for (iDelta = uniqueCount; iDelta > 0; iDelta -= 1) {
+        size_t index = pArray->pDeltaIndices[iDelta - 1];
+        const char* pRecord = pArray->pDelta + index*stride;
+
+        /* Everything in the main array bigger than the delta record goes first. */
+        while (iRead > 0) {
+            int result = pArray->compareProc(pArray->pUserData, pArray->pData + (iRead - 1)*stride, pRecord);
+            if (result < 0) {
+                break;
+            }
+
+            iRead -= 1;
+
+            if (result == 0) {
+                break;  /* Replaced or erased. */
+            }
+
+            iWrite -= 1;
+            NS_COPY_MEMORY(pArray->pData + iWrite*stride, pArray->pData + iRead*stride, stride);
+        }
+
+        if (pArray->pDeltaOps[index] == NS_SORTED_ARRAY_OP_INSERT) {
+            iWrite -= 1;
+            NS_COPY_MEMORY(pArray->pData + iWrite*stride, pRecord, stride);
+        }
+    }
+
+    /* The untouched records at the front are already in place. Anything that was erased leaves a gap after them. */
+    if (iWrite > iRead) {
+        NS_MOVE_MEMORY(pArray->pData + iRead*stride, pArray->pData + iWrite*stride, (pArray->count + insertCount - iWrite) * stride);
+    }
+
+    pArray->count      = iRead + (pArray->count + insertCount - iWrite);
+    pArray->deltaCount = 0;
+
+    /* Growing the delta is optional so failing to do so isn't an error. */
+    if (pArray->autoDeltaCapacity) {
+        size_t newDeltaCapacity = pArray->deltaCapacity;
+
+        while (newDeltaCapacity*2 <= pArray->count / (newDeltaCapacity*2)) {
+            newDeltaCapacity *= 2;
+        }
+
+        if (newDeltaCapacity > pArray->deltaCapacity) {
+            ns_sorted_array_alloc_delta(pArray, newDeltaCapacity);
+        }
+    }
+
+    return NS_SUCCESS;
+}
+
+static ns_result ns_sorted_array_push(ns_sorted_array* pArray, const void* pRecords, size_t count, unsigned char op)
+{
+    size_t i;
+
+    if (pArray == NULL || (pRecords == NULL && count > 0)) {
+        return NS_INVALID_ARGS;
+    }
+
+    for (i = 0; i < count; i += 1) {
+        if (pArray->deltaCount == pArray->deltaCapacity) {
+            ns_result result = ns_sorted_array_flush(pArray);
+            if (result != NS_SUCCESS) {
+                return result;
+            }
+        }
+
+        NS_COPY_MEMORY(pArray->pDelta + pArray->deltaCount*pArray->stride, (const char*)pRecords + i*pArray->stride, pArray->stride);
+        pArray->pDeltaOps[pArray->deltaCount] = op;
+        pArray->deltaCount += 1;
+    }
+
+    return NS_SUCCESS;
+}
+
+NS_API ns_result ns_sorted_array_insert(ns_sorted_array* pArray, const void* pRecords, size_t count)
+{
+    return ns_sorted_array_push(pArray, pRecords, count, NS_SORTED_ARRAY_OP_INSERT);
+}
+
+NS_API ns_result ns_sorted_array_erase(ns_sorted_array* pArray, const void* pKeys, size_t count)
+{
+    return ns_sorted_array_push(pArray, pKeys, count, NS_SORTED_ARRAY_OP_ERASE);
+}
+
+NS_API void* ns_sorted_array_find(const ns_sorted_array* pArray, const void* pKey)
+{
+    size_t index;
+    size_t i;
+
+    if (pArray == NULL || pKey == NULL) {
+        return NULL;
+    }
+
+    /* The newest change to a key is the one that counts. */
+    for (i = pArray->deltaCount; i > 0; i -= 1) {
+        char* pRecord = pArray->pDelta + (i - 1)*pArray->stride;
+
+        if (pArray->compareProc(pArray->pUserData, pKey, pRecord) == 0) {
+            return (pArray->pDeltaOps[i - 1] == NS_SORTED_ARRAY_OP_INSERT) ? pRecord : NULL;
+        }
+    }
+
+    index = ns_sorted_array_lower_bound(pArray, pKey);
+    if (index < pArray->count && pArray->compareProc(pArray->pUserData, pKey, pArray->pData + index*pArray->stride) == 0) {
+        return pArray->pData + index*pArray->stride;
+    }
+
+    return NULL;
+}
+/* END sorted_array.c */
+
+/* BEG external_sort.c */
+/*
+An external merge sort for data sets that don't fit in memory. Records are read from the input stream and cut into runs the size
+of the memory budget, each of which is sorted with ns_sort() and spilled to a temp file. The runs are then merged with a loser
+tree which finds the next record with a single comparison per level of the tree. Reads from each run and writes to the output are
+done in large sequential blocks, with the memory budget split evenly between the input streams and the output stream.
+
+If there are more runs than can be merged at once, groups of runs are merged into larger runs first. The maximum fan-in is
+limited by NS_EXTERNAL_SORT_MAX_FAN_IN to keep the number of open files reasonable, and by the memory budget so that each stream
+gets a buffer of at least NS_EXTERNAL_SORT_MIN_BUFFER_SIZE bytes. With the defaults, sorting 200GB with 32GB of memory is a single
+run generation pass and a single 7-way merge.
+
+If the input fits in a single run it's sorted in memory and written straight to the output without touching any temp files.
+
+The input is read from the current position of pInput until the end of the stream and must be a whole number of records. The sort
+is not stable. On 32-bit POSIX platforms you'll need to compile with _FILE_OFFSET_BITS=64 for files larger than 2GB.
+*/
+#ifndef NS_EXTERNAL_SORT_DEFAULT_MEMORY_BUDGET
+#define NS_EXTERNAL_SORT_DEFAULT_MEMORY_BUDGET  (256*1024*1024)
+#endif
+
+#ifndef NS_EXTERNAL_SORT_MIN_BUFFER_SIZE
+#define NS_EXTERNAL_SORT_MIN_BUFFER_SIZE        (1024*1024)
+#endif
+
+#ifndef NS_EXTERNAL_SORT_MAX_FAN_IN
+#define NS_EXTERNAL_SORT_MAX_FAN_IN             128
+#endif
+
+typedef struct
+{
+    FILE* pFile;
+    char* pFilePath;        /* Only set when a temp directory is used, in which case the file needs to be deleted when closed. */
+    ns_uint64 recordCount;
+} ns_external_sort_run;
+
+typedef struct
+{
+    size_t stride;
+    int (* compareProc)(void*, const void*, const void*);
+    void* pUserData;
+    const char* pTempDirectory;
+    const ns_allocation_callbacks* pAllocationCallbacks;
+    char* pMemory;
+    size_t memorySize;
+    ns_external_sort_run* pRuns;
+    size_t runCount;
+    size_t runCap;
+    size_t tempFileCounter;
+} ns_external_sort_context;
+
+typedef struct
+{
+    FILE* pFile;
+    char* pBuffer;
+    size_t bufferCap;       /* In bytes. Always a multiple of the stride. */
+    size_t bufferSize;
+    const char* pCurrent;   /* Set to NULL when the run is exhausted. */
+    ns_uint64 remaining;    /* Number of records not yet read into the buffer. */
+} ns_external_sort_reader;
+
+static ns_result ns_external_sort_io_error(void)
+{
+    ns_result result = ns_result_from_errno(errno);
+    if (result == NS_SUCCESS || result == NS_ERROR) {
+        result = NS_IO_ERROR;   /* Not every implementation sets errno on stream errors. */
+    }
+
+    return result;
+}
+
+static ns_result ns_external_sort_write(FILE* pFile, const void* pData, size_t size)
+{
+    if (size == 0) {
+        return NS_SUCCESS;
+    }
+
+    errno = 0;
+    if (fwrite(pData, 1, size, pFile) != size) {
+        return ns_external_sort_io_error();
+    }
+
+    return NS_SUCCESS;
+}
+
+static ns_result ns_external_sort_read(FILE* pFile, void* pData, size_t size, size_t* pBytesRead)
+{
+    errno = 0;
+    *pBytesRead = fread(pData, 1, size, pFile);
+    if (*pBytesRead < size && ferror(pFile)) {
+        return ns_external_sort_io_error();
+    }
+
+    return NS_SUCCESS;
+}
+
+static ns_result ns_external_sort_open_temp(ns_external_sort_context* pContext, ns_external_sort_run* pRun)
+{
+    pRun->pFile       = NULL;
+    pRun->pFilePath   = NULL;
+    pRun->recordCount = 0;
+
+    if (pContext->pTempDirectory == NULL) {
+        errno = 0;
+        pRun->pFile = tmpfile();
+        if (pRun->pFile == NULL) {
+            return ns_external_sort_io_error();
+        }
+    } else {
+        pRun->pFilePath = (char*)ns_malloc(strlen(pContext->pTempDirectory) + 64, pContext->pAllocationCallbacks);
+        if (pRun->pFilePath == NULL) {
+            return NS_OUT_OF_MEMORY;
+        }
+
+        /* Don't clobber anything that happens to be there already. */
+        for (;;) {
+            FILE* pExisting;
+
+            sprintf(pRun->pFilePath, "%s/ns_external_sort_%lx_%lu.tmp", pContext->pTempDirectory, (unsigned long)(size_t)pContext, (unsigned long)pContext->tempFileCounter);
+            pContext->tempFileCounter += 1;
+
+            pExisting = fopen(pRun->pFilePath, "rb");
+            if (pExisting == NULL) {
+                break;
+            }
+
+            fclose(pExisting);
+        }
+
+        errno = 0;
+        pRun->pFile = fopen(pRun->pFilePath, "w+b");
+        if (pRun->pFile == NULL) {
+            ns_result result = ns_external_sort_io_error();
+            ns_free(pRun->pFilePath, pContext->pAllocationCallbacks);
+            pRun->pFilePath = NULL;
+            return result;
+        }
+    }
+
+    return NS_SUCCESS;
+}
+
+static void ns_external_sort_close_temp(ns_external_sort_context* pContext, ns_external_sort_run* pRun)
+{
+    if (pRun->pFile != NULL) {
+        fclose(pRun->pFile);
+        pRun->pFile = NULL;
+    }
+
+    if (pRun->pFilePath != NULL) {
+        remove(pRun->pFilePath);
+        ns_free(pRun->pFilePath, pContext->pAllocationCallbacks);
+        pRun->pFilePath = NULL;
+    }
+}
+
+static ns_result ns_external_sort_push_run(ns_external_sort_context* pContext, const ns_external_sort_run* pRun)
+{
+    if (pContext->runCount == pContext->runCap) {
+        size_t newCap = (pContext->runCap == 0) ? 16 : pContext->runCap*2;
+        ns_external_sort_run* pNewRuns = (ns_external_sort_run*)ns_realloc(pContext->pRuns, newCap * sizeof(*pNewRuns), pContext->pAllocationCallbacks);
+        if (pNewRuns == NULL) {
+            return NS_OUT_OF_MEMORY;
+        }
+
+        pContext->pRuns  = pNewRuns;
+        pContext->runCap = newCap;
+    }
+
+    pContext->pRuns[pContext->runCount] = *pRun;
+    pContext->runCount += 1;
+
+    return NS_SUCCESS;
+}
+
+static ns_result ns_external_sort_reader_fill(ns_external_sort_reader* pReader, size_t stride)
+{
+    ns_result result;
+    size_t bytesToRead;
+    size_t bytesRead;
+
+    if (pReader->remaining == 0) {
+        pReader->pCurrent = NULL;
+        return NS_SUCCESS;
+    }
+
+    bytesToRead = pReader->bufferCap;
+    if (pReader->remaining < bytesToRead / stride) {
+        bytesToRead = (size_t)pReader->remaining * stride;
+    }
+
+    result = ns_external_sort_read(pReader->pFile, pReader->pBuffer, bytesToRead, &bytesRead);
+    if (result != NS_SUCCESS) {
+        return result;
+    }
+
+    if (bytesRead != bytesToRead) {
+        return NS_IO_ERROR; /* The temp file is shorter than what we wrote to it. */
+    }
+
+    pReader->bufferSize = bytesRead;
+    pReader->pCurrent   = pReader->pBuffer;
+    pReader->remaining -= bytesRead / stride;
+
+    return NS_SUCCESS;
+}
+
+/* Merges the first k runs and writes the result to pOutput. */
+static ns_result ns_external_sort_merge(ns_external_sort_context* pContext, size_t k, FILE* pOutput, ns_uint64* pRecordCount)
+{
+    ns_result result = NS_SUCCESS;
+    size_t stride = pContext->stride;
+    size_t bufferSize;
+    ns_external_sort_reader* pReaders;
+    const char** ppHeads;
+    size_t* pNodes;
+    ns_loser_tree tree;
+    char* pOutputBuffer;
+    size_t outputSize = 0;
+    ns_uint64 recordCount = 0;
+    size_t i;
+
+    /* The budget is split evenly between each input stream and the output stream. */
+    bufferSize = (pContext->memorySize / (k + 1)) / stride * stride;
+
+    pReaders = (ns_external_sort_reader*)ns_malloc(k * (sizeof(*pReaders) + sizeof(*ppHeads) + sizeof(*pNodes)), pContext->pAllocationCallbacks);
+    if (pReaders == NULL) {
+        return NS_OUT_OF_MEMORY;
+    }
+
+    ppHeads = (const char**)(pReaders + k);
+    pNodes  = (size_t*)(ppHeads + k);
+
+    for (i = 0; i < k; i += 1) {
+        pReaders[i].pFile      = pContext->pRuns[i].pFile;
+        pReaders[i].pBuffer    = pContext->pMemory + i*bufferSize;
+        pReaders[i].bufferCap  = bufferSize;
+        pReaders[i].bufferSize = 0;
+        pReaders[i].pCurrent   = NULL;
+        pReaders[i].remaining  = pContext->pRuns[i].recordCount;
+
+        errno = 0;
+        if (fseek(pReaders[i].pFile, 0, SEEK_SET) != 0) {
+            result = ns_external_sort_io_error();
+            goto done;
+        }
+
+        result = ns_external_sort_reader_fill(&pReaders[i], stride);
+        if (result != NS_SUCCESS) {
+            goto done;
+        }
+
+        ppHeads[i] = pReaders[i].pCurrent;
+    }
+
+    pOutputBuffer = pContext->pMemory + k*bufferSize;
+
+    ns_loser_tree_init(&tree, ppHeads, pNodes, k, pContext->compareProc, pContext->pUserData);
+
+    while (ppHeads[ns_loser_tree_winner(&tree)] != NULL) {
+        ns_external_sort_reader* pReader = &pReaders[ns_loser_tree_winner(&tree)];
+
+        if (outputSize == bufferSize) {
+            result = ns_external_sort_write(pOutput, pOutputBuffer, outputSize);
+            if (result != NS_SUCCESS) {
+                goto done;
+            }
+
+            outputSize = 0;
+        }
+
+        NS_COPY_MEMORY(pOutputBuffer + outputSize, pReader->pCurrent, stride);
+        outputSize  += stride;
+        recordCount += 1;
+
+        pReader->pCurrent += stride;
+        if (pReader->pCurrent == pReader->pBuffer + pReader->bufferSize) {
+            result = ns_external_sort_reader_fill(pReader, stride);
+            if (result != NS_SUCCESS) {
+                goto done;
+            }
+        }
+
+        ppHeads[ns_loser_tree_winner(&tree)] = pReader->pCurrent;
+        ns_loser_tree_replay(&tree);
+    }
+
+    result = ns_external_sort_write(pOutput, pOutputBuffer, outputSize);
+
+done:
+    ns_free(pReaders, pContext->pAllocationCallbacks);
+
+    if (pRecordCount != NULL) {
+        *pRecordCount = recordCount;
+    }
+
+    return result;
+}
+
+static ns_result ns_external_sort_internal(ns_external_sort_context* pContext, FILE* pInput, FILE* pOutput)
+{
+    ns_result result;
+    size_t stride = pContext->stride;
+    size_t runCapInBytes = pContext->memorySize / stride * stride;
+    size_t streamBufferSize;
+    size_t maxFanIn;
+
+    /* Run generation. */
+    for (;;) {
+        ns_external_sort_run run;
+        size_t bytesRead;
+        size_t recordCount;
+
+        result = ns_external_sort_read(pInput, pContext->pMemory, runCapInBytes, &bytesRead);
+        if (result != NS_SUCCESS) {
+            return result;
+        }
+
+        if ((bytesRead % stride) != 0) {
+            return NS_INVALID_DATA;
+        }
+
+        recordCount = bytesRead / stride;
+        if (recordCount == 0) {
+            break;
+        }
+
+        ns_sort(pContext->pMemory, recordCount, stride, pContext->compareProc, pContext->pUserData);
+
+        /* If everything fit in memory there's no need to go through a temp file. */
+        if (pContext->runCount == 0 && bytesRead < runCapInBytes) {
+            return ns_external_sort_write(pOutput, pContext->pMemory, bytesRead);
+        }
+
+        result = ns_external_sort_open_temp(pContext, &run);
+        if (result != NS_SUCCESS) {
+            return result;
+        }
+
+        run.recordCount = recordCount;
+
+        result = ns_external_sort_push_run(pContext, &run);
+        if (result != NS_SUCCESS) {
+            ns_external_sort_close_temp(pContext, &run);
+            return result;
+        }
+
+        result = ns_external_sort_write(run.pFile, pContext->pMemory, bytesRead);
+        if (result != NS_SUCCESS) {
+            return result;
+        }
+
+        if (bytesRead < runCapInBytes) {
+            break;
+        }
+    }
+
+    if (pContext->runCount == 0) {
+        return NS_SUCCESS;  /* Empty input. */
+    }
+
+    /* Every stream needs a reasonably sized buffer to keep the I/O sequential. */
+    streamBufferSize = (NS_EXTERNAL_SORT_MIN_BUFFER_SIZE > stride) ? NS_EXTERNAL_SORT_MIN_BUFFER_SIZE : stride;
+    maxFanIn = (pContext->memorySize / streamBufferSize);
+    maxFanIn = (maxFanIn > 1) ? maxFanIn - 1 : 1;
+    if (maxFanIn > NS_EXTERNAL_SORT_MAX_FAN_IN) {
+        maxFanIn = NS_EXTERNAL_SORT_MAX_FAN_IN;
+    }
+    if (maxFanIn < 2) {
+        maxFanIn = 2;   /* The budget is guaranteed to hold at least 3 records. */
+    }
+
+    /* Intermediate merge passes for when there are too many runs to merge in one go. */
+    while (pContext->runCount > maxFanIn) {
+        ns_external_sort_run run;
+        size_t i;
+
+        result = ns_external_sort_open_temp(pContext, &run);
+        if (result != NS_SUCCESS) {
+            return result;
+        }
+
+        result = ns_external_sort_merge(pContext, maxFanIn, run.pFile, &run.recordCount);
+        if (result != NS_SUCCESS) {
+            ns_external_sort_close_temp(pContext, &run);
+            return result;
+        }
+
+        for (i = 0; i < maxFanIn; i += 1) {
+            ns_external_sort_close_temp(pContext, &pContext->pRuns[i]);
+        }
+
+        NS_MOVE_MEMORY(pContext->pRuns, pContext->pRuns + maxFanIn, (pContext->runCount - maxFanIn) * sizeof(*pContext->pRuns));
+        pContext->runCount -= maxFanIn;
+
+        /* Can't fail because we just freed up space. */
+        ns_external_sort_push_run(pContext, &run);
+    }
+
+    return ns_external_sort_merge(pContext, pContext->runCount, pOutput, NULL);
+}
+
+NS_API ns_external_sort_config ns_external_sort_config_init(size_t stride, int (*compareProc)(void*, const void*, const void*), void* pUserData)
+{
+    ns_external_sort_config config;
+
+    NS_ZERO_MEMORY(&config, sizeof(config));
+    config.stride         = stride;
+    config.compareProc    = compareProc;
+    config.pUserData      = pUserData;
+    config.memoryBudget   = NS_EXTERNAL_SORT_DEFAULT_MEMORY_BUDGET;
+    config.pTempDirectory = NULL;
+
+    return config;
+}
+
+NS_API ns_result ns_external_sort(const ns_external_sort_config* pConfig, FILE* pInput, FILE* pOutput, const ns_allocation_callbacks* pAllocationCallbacks)
+{
+    ns_result result;
+    ns_external_sort_context context;
+    size_t i;
+
+    if (pConfig == NULL || pInput == NULL || pOutput == NULL || pConfig->stride == 0 || pConfig->compareProc == NULL) {
+        return NS_INVALID_ARGS;
+    }
+
+    /* We need room for at least two input records and one output record for the merge. */
+    if (pConfig->memoryBudget / pConfig->stride < 3) {
+        return NS_INVALID_ARGS;
+    }
+
+    NS_ZERO_MEMORY(&context, sizeof(context));
+    context.stride               = pConfig->stride;
+    context.compareProc          = pConfig->compareProc;
+    context.pUserData            = pConfig->pUserData;
+    context.pTempDirectory       = pConfig->pTempDirectory;
+    context.pAllocationCallbacks = pAllocationCallbacks;
+    context.memorySize           = pConfig->memoryBudget;
+
+    context.pMemory = (char*)ns_malloc(context.memorySize, pAllocationCallbacks);
+    if (context.pMemory == NULL) {
+        return NS_OUT_OF_MEMORY;
+    }
+
+    result = ns_external_sort_internal(&context, pInput, pOutput);
+
+    if (result == NS_SUCCESS) {
+        errno = 0;
+        if (fflush(pOutput) != 0) {
+            result = ns_external_sort_io_error();
+        }
+    }
+
+    for (i = 0; i < context.runCount; i += 1) {
+        ns_external_sort_close_temp(&context, &context.pRuns[i]);
+    }
+
+    ns_free(context.pRuns, pAllocationCallbacks);
+    ns_free(context.pMemory, pAllocationCallbacks);
+
+    return result;
+}
+
+/* The input and output files must be different. */
+NS_API ns_result ns_external_sort_file(const ns_external_sort_config* pConfig, const char* pInputFilePath, const char* pOutputFilePath, const ns_allocation_callbacks* pAllocationCallbacks)
+{
+    ns_result result;
+    FILE* pInput;
+    FILE* pOutput;
+
+    if (pInputFilePath == NULL || pOutputFilePath == NULL) {
+        return NS_INVALID_ARGS;
+    }
+
+    errno = 0;
+    pInput = fopen(pInputFilePath, "rb");
+    if (pInput == NULL) {
+        return ns_external_sort_io_error();
+    }
+
+    errno = 0;
+    pOutput = fopen(pOutputFilePath, "wb");
+    if (pOutput == NULL) {
+        result = ns_external_sort_io_error();
+        fclose(pInput);
+        return result;
+    }
+
+    result = ns_external_sort(pConfig, pInput, pOutput, pAllocationCallbacks);
+
+    fclose(pInput);
+
+    errno = 0;
+    if (fclose(pOutput) != 0 && result == NS_SUCCESS) {
+        result = ns_external_sort_io_error();
+    }
+
+    return result;
+}
+/* END external_sort.c */
+
+/* BEG sort_strings.c */
+/*
+Sorts null terminated strings into the same order as strcmp(). Sorting strings with ns_sort() and strcmp() is wasteful because
+every comparison starts again from the first character, even though the sort has long since established that the strings being
+compared share a prefix. This is a multikey quicksort instead. It partitions on the next few characters into less, equal and
+greater groups, and only the equal group moves on to the following characters.
+
+Two things make this fast in practice. First, characters are consumed 8 at a time as a big-endian integer rather than one at a
+time, so long shared prefixes don't need a partitioning pass per character. Second, those 8 characters are loaded once per string
+per depth into a cache array that gets swapped along with the string pointers. Dereferencing a string pointer is almost always a
+cache miss, and with the cache that happens once per depth rather than once per partitioning pass. Small groups are finished
+with an insertion sort.
+
+The longest common prefix of each string with its predecessor falls out of this for free, so if pLCP is not NULL it will be filled
+with count entries where pLCP[i] is the length of the common prefix of the sorted strings i-1 and i, and pLCP[0] is 0. This is
+what you need for prefix compressed output.
+
+ns_sort_strings_by_key() sorts records by a string pointer stored at keyOffset within each record. The keys are sorted in a
+separate array and the records are permuted into place at the end so each one is only moved once.
+
+If the scratch memory can't be allocated these fall back to ns_sort() with strcmp(). Neither sort is stable.
+*/
+#define NS_SORT_STRINGS_INSERTION_SORT_THRESHOLD    16  /* Groups smaller than this are finished with an insertion sort. */
+
+typedef struct
+{
+    const char** ppStrings;
+    size_t* pIndices;       /* Only used by ns_sort_strings_by_key(). Can be NULL. */
+    ns_uint64* pCache;      /* The 8 characters at the current depth of each string. */
+    size_t* pLCP;           /* Can be NULL. */
+} ns_sort_strings_state;
+
+/*
+Loads the next 8 characters as a big-endian integer so that integer order matches strcmp() order. Anything after the null
+terminator is treated as zero, and nothing past the terminator is read.
+*/
+static NS_INLINE ns_uint64 ns_sort_strings_load_word(const char* pString)
+{
+    ns_uint64 word = 0;
+    int i;
+
+    for (i = 0; i < 8; i += 1) {
+        word = (word << 8) | (unsigned char)pString[i];
+        if (pString[i] == '\0') {
+            return word << ((7 - i) * 8);
+        }
+    }
+
+    return word;
+}
+
+/* The number of leading bytes that are the same in both words. */
+static size_t ns_sort_strings_word_prefix(ns_uint64 a, ns_uint64 b)
+{
+    ns_uint64 diff = a ^ b;
+    size_t length = 0;
+
+    while (length < 8 && (diff & ((ns_uint64)0xFF << 56)) == 0) {
+        diff  <<= 8;
+        length += 1;
+    }
+
+    return length;
+}
+
+/* The number of characters in a word before the null terminator. */
+static size_t ns_sort_strings_word_length(ns_uint64 word)
+{
+    size_t length = 0;
+
+    while (length < 8 && (word & ((ns_uint64)0xFF << 56)) != 0) {
+        word  <<= 8;
+        length += 1;
+    }
+
+    return length;
+}
+
+static size_t ns_sort_strings_common_prefix(const char* pA, const char* pB)
+{
+    size_t length = 0;
+
+    while (pA[length] != '\0' && pA[length] == pB[length]) {
+        length += 1;
+    }
+
+    return length;
+}
+
+static NS_INLINE void ns_sort_strings_swap(ns_sort_strings_state* pState, size_t a, size_t b)
+{
+    const char* pTempString = pState->ppStrings[a];
+    ns_uint64 tempWord = pState->pCache[a];
+
+    pState->ppStrings[a] = pState->ppStrings[b];
+    pState->ppStrings[b] = pTempString;
+    pState->pCache[a] = pState->pCache[b];
+    pState->pCache[b] = tempWord;
+
+    if (pState->pIndices != NULL) {
+        size_t tempIndex = pState->pIndices[a];
+        pState->pIndices[a] = pState->pIndices[b];
+        pState->pIndices[b] = tempIndex;
+    }
+}
+
+static void ns_sort_strings_load(ns_sort_strings_state* pState, size_t first, size_t count, size_t depth)
+{
+    size_t i;
+
+    for (i = first; i < first + count; i += 1) {
+        pState->pCache[i] = ns_sort_strings_load_word(pState->ppStrings[i] + depth);
+    }
+}
+
+/* Compares two strings that share the first depth characters. The words are the cached 8 characters at that depth. */
+static int ns_sort_strings_compare_at(const char* pA, ns_uint64 wordA, const char* pB, ns_uint64 wordB, size_t depth)
+{
+    if (wordA != wordB) {
+        return (wordA < wordB) ? -1 : 1;
+    }
+
+    if ((wordA & 0xFF) == 0) {
+        return 0;   /* Both strings end in this word. */
+    }
+
+    return strcmp(pA + depth + 8, pB + depth + 8);
+}
+
+/* Fills the LCP entries inside a sorted range whose cache holds the 8 characters at depth. */
+static void ns_sort_strings_fill_lcp(ns_sort_strings_state* pState, size_t first, size_t count, size_t depth)
+{
+    const char** ppStrings = pState->ppStrings + first;
+    ns_uint64* pCache = pState->pCache + first;
+    size_t* pLCP;
+    size_t i;
+
+    if (pState->pLCP == NULL) {
+        return;
+    }
+
+    pLCP = pState->pLCP + first;
+
+    for (i = 1; i < count; i += 1) {
+        if (pCache[i - 1] != pCache[i]) {
+            pLCP[i] = depth + ns_sort_strings_word_prefix(pCache[i - 1], pCache[i]);
+        } else if ((pCache[i] & 0xFF) == 0) {
+            pLCP[i] = depth + ns_sort_strings_word_length(pCache[i]);
+        } else {
+            pLCP[i] = depth + 8 + ns_sort_strings_common_prefix(ppStrings[i - 1] + depth + 8, ppStrings[i] + depth + 8);
+        }
+    }
+}
+
+static void ns_sort_strings_insertion(ns_sort_strings_state* pState, size_t first, size_t count, size_t depth)
+{
+    const char** ppStrings = pState->ppStrings + first;
+    ns_uint64* pCache = pState->pCache + first;
+    size_t* pIndices = (pState->pIndices != NULL) ? pState->pIndices + first : NULL;
+    size_t i;
+
+    for (i = 1; i < count; i += 1) {
+        const char* pString = ppStrings[i];
+        ns_uint64 word = pCache[i];
+        size_t index = (pIndices != NULL) ? pIndices[i] : 0;
+        size_t j = i;
+
+        while (j > 0 && ns_sort_strings_compare_at(pString, word, ppStrings[j - 1], pCache[j - 1], depth) < 0) {
+            ppStrings[j] = ppStrings[j - 1];
+            pCache[j]    = pCache[j - 1];
+            if (pIndices != NULL) {
+                pIndices[j] = pIndices[j - 1];
+            }
+
+            j -= 1;
+        }
+
+        ppStrings[j] = pString;
+        pCache[j]    = word;
+        if (pIndices != NULL) {
+            pIndices[j] = index;
+        }
+    }
+
+    ns_sort_strings_fill_lcp(pState, first, count, depth);
+}
+
+static void ns_sort_strings_sift_down(ns_sort_strings_state* pState, size_t first, size_t root, size_t count, size_t depth)
+{
+    const char** ppStrings = pState->ppStrings + first;
+    ns_uint64* pCache = pState->pCache + first;
+
+    for (;;) {
+        size_t child = root*2 + 1;
+        if (child >= count) {
+            break;
+        }
+
+        if (child + 1 < count && ns_sort_strings_compare_at(ppStrings[child], pCache[child], ppStrings[child + 1], pCache[child + 1], depth) < 0) {
+            child += 1;
+        }
+
+        if (ns_sort_strings_compare_at(ppStrings[root], pCache[root], ppStrings[child], pCache[child], depth) >= 0) {
+            break;
+        }
+
+        ns_sort_strings_swap(pState, first + root, first + child);
+        root = child;
+    }
+}
+
+/*
+The fallback for when partitioning keeps going badly, like ns_sort() does. It's a heapsort rather than a call to ns_sort() because
+the cache and indices need to move with the strings.
+*/
+static void ns_sort_strings_heapsort(ns_sort_strings_state* pState, size_t first, size_t count, size_t depth)
+{
+    size_t i;
+
+    for (i = count/2; i > 0; i -= 1) {
+        ns_sort_strings_sift_down(pState, first, i - 1, count, depth);
+    }
+
+    for (i = count - 1; i > 0; i -= 1) {
+        ns_sort_strings_swap(pState, first, first + i);
+        ns_sort_strings_sift_down(pState, first, 0, i, depth);
+    }
+
+    ns_sort_strings_fill_lcp(pState, first, count, depth);
+}
+
+static int ns_sort_strings_bad_allowed(size_t count)
+{
+    int badAllowed = 0;
+
+    /* Allow log2(count) bad partitions before falling back to heapsort, the same as ns_sort(). */
+    while (count > 1) {
+        badAllowed += 1;
+        count >>= 1;
+    }
+
+    return badAllowed;
+}
+
+static NS_INLINE ns_uint64 ns_sort_strings_median3(ns_uint64 a, ns_uint64 b, ns_uint64 c)
+{
+    if (a < b) {
+        return (b < c) ? b : ((a < c) ? c : a);
+    } else {
+        return (a < c) ? a : ((b < c) ? c : b);
+    }
+}
+
+static void ns_sort_strings_mkqs(ns_sort_strings_state* pState, size_t first, size_t count, size_t depth, int badAllowed);
+
+/*
+Moves the equal group of a partition on to the characters after the pivot word. Returns 0 if there's nothing left to do, which
+is when the pivot word has the null terminator in it since the strings are then identical.
+*/
+static int ns_sort_strings_advance(ns_sort_strings_state* pState, size_t first, size_t count, size_t* pDepth, ns_uint64 pivot, int nothingSeparated)
+{
+    size_t depth = *pDepth;
+    size_t i;
+
+    if ((pivot & 0xFF) == 0) {
+        if (pState->pLCP != NULL) {
+            size_t length = depth + ns_sort_strings_word_length(pivot);
+
+            for (i = 1; i < count; i += 1) {
+                pState->pLCP[first + i] = length;
+            }
+        }
+
+        return 0;
+    }
+
+    depth += 8;
+
+    /*
+    If nothing was separated by this word the whole group is likely to share a long prefix, like a path or URL. Reloading the cache
+    for every 8 characters of that would mean a pass over every string each time, so instead find out how much the whole group
+    shares and skip straight past it.
+    */
+    if (nothingSeparated) {
+        const char* pFirst = pState->ppStrings[first] + depth;
+        size_t shared = strlen(pFirst);
+
+        for (i = 1; i < count && shared > 0; i += 1) {
+            size_t length = ns_sort_strings_common_prefix(pFirst, pState->ppStrings[first + i] + depth);
+            if (shared > length) {
+                shared = length;
+            }
+        }
+
+        depth += shared;
+    }
+
+    ns_sort_strings_load(pState, first, count, depth);
+
+    *pDepth = depth;
+    return 1;
+}
+
+/*
+Sorts [first, first+count) where every string shares the first depth characters and the cache holds the next 8 characters of each
+string. The LCP entry at first is the boundary with whatever comes before this range and is the caller's responsibility.
+
+Only the largest of the three groups is looped on. The other two are recursed into, and since they can't be more than half of the
+range the stack depth is O(log n). Partitions where the less or greater group takes up nearly everything are counted against
+badAllowed like in ns_sort(), and once that runs out the range is heapsorted. Moving on to the next characters starts a fresh
+budget since that's a new problem.
+*/
+static void ns_sort_strings_mkqs(ns_sort_strings_state* pState, size_t first, size_t count, size_t depth, int badAllowed)
+{
+    for (;;) {
+        ns_uint64* pCache = pState->pCache + first;
+        ns_uint64 pivot;
+        size_t groupCount;
+        size_t lt;
+        size_t gt;
+        size_t i;
+
+        if (count < NS_SORT_STRINGS_INSERTION_SORT_THRESHOLD) {
+            ns_sort_strings_insertion(pState, first, count, depth);
+            return;
+        }
+
+        if (badAllowed == 0) {
+            ns_sort_strings_heapsort(pState, first, count, depth);
+            return;
+        }
+
+        /* Median of three, or a ninther for bigger groups, where a bad pivot costs more. */
+        if (count > 128) {
+            size_t eighth = count/8;
+
+            pivot = ns_sort_strings_median3(
+                ns_sort_strings_median3(pCache[0],                  pCache[eighth],             pCache[eighth*2]),
+                ns_sort_strings_median3(pCache[count/2 - eighth],   pCache[count/2],            pCache[count/2 + eighth]),
+                ns_sort_strings_median3(pCache[count - 1 - eighth*2], pCache[count - 1 - eighth], pCache[count - 1]));
+        } else {
+            pivot = ns_sort_strings_median3(pCache[0], pCache[count/2], pCache[count - 1]);
+        }
+
+        /* Three way partition. [0, lt) is less than the pivot, [lt, gt) is equal and [gt, count) is greater. */
+        lt = 0;
+        gt = count;
+        i  = 0;
+        while (i < gt) {
+            ns_uint64 word = pCache[i];
+
+            if (word < pivot) {
+                ns_sort_strings_swap(pState, first + lt, first + i);
+                lt += 1;
+                i  += 1;
+            } else if (word > pivot) {
+                gt -= 1;
+                ns_sort_strings_swap(pState, first + i, first + gt);
+            } else {
+                i += 1;
+            }
+        }
+
+        /*
+        Neighbours from different groups share the first depth characters and differ somewhere in the next 8. The strings that
+        end up at the boundaries are the largest of the less group and the smallest of the greater group. This needs to be done
+        before recursing because that will overwrite the cache with characters from further along.
+        */
+        if (pState->pLCP != NULL) {
+            ns_uint64 maxL = 0;
+            ns_uint64 minR = ~(ns_uint64)0;
+
+            for (i = 0; i < lt; i += 1) {
+                maxL = (pCache[i] > maxL) ? pCache[i] : maxL;
+            }
+            for (i = gt; i < count; i += 1) {
+                minR = (pCache[i] < minR) ? pCache[i] : minR;
+            }
+
+            if (lt > 0 && lt < count) {
+                pState->pLCP[first + lt] = depth + ns_sort_strings_word_prefix(maxL, (gt > lt) ? pivot : minR);
+            }
+            if (gt > lt && gt < count) {
+                pState->pLCP[first + gt] = depth + ns_sort_strings_word_prefix(pivot, minR);
+            }
+        }
+
+        groupCount = count;
+
+        if (lt > groupCount - groupCount/8 || groupCount - gt > groupCount - groupCount/8) {
+            badAllowed -= 1;
+        }
+
+        if (gt - lt >= lt && gt - lt >= groupCount - gt) {
+            /* Loop on the equal group rather than recursing since long shared prefixes would otherwise mean deep recursion. */
+            ns_sort_strings_mkqs(pState, first,      lt,              depth, badAllowed);
+            ns_sort_strings_mkqs(pState, first + gt, groupCount - gt, depth, badAllowed);
+
+            first += lt;
+            count  = gt - lt;
+
+            if (!ns_sort_strings_advance(pState, first, count, &depth, pivot, lt == 0 && gt == groupCount)) {
+                return;
+            }
+
+            badAllowed = ns_sort_strings_bad_allowed(count);
+        } else {
+            size_t equalDepth = depth;
+
+            if (ns_sort_strings_advance(pState, first + lt, gt - lt, &equalDepth, pivot, 0)) {
+                ns_sort_strings_mkqs(pState, first + lt, gt - lt, equalDepth, ns_sort_strings_bad_allowed(gt - lt));
+            }
+
+            if (lt < groupCount - gt) {
+                ns_sort_strings_mkqs(pState, first, lt, depth, badAllowed);
+                first += gt;
+                count  = groupCount - gt;
+            } else {
+                ns_sort_strings_mkqs(pState, first + gt, groupCount - gt, depth, badAllowed);
+                count = lt;
+            }
+        }
+    }
+}
+
+static int ns_sort_strings_compare_key(void* pUserData, const void* a, const void* b)
+{
+    size_t keyOffset = *(const size_t*)pUserData;
+    const char* pKeyA;
+    const char* pKeyB;
+
+    NS_COPY_MEMORY(&pKeyA, (const char*)a + keyOffset, sizeof(pKeyA));
+    NS_COPY_MEMORY(&pKeyB, (const char*)b + keyOffset, sizeof(pKeyB));
+
+    return strcmp(pKeyA, pKeyB);
+}
+
+/* Used when we're out of memory. A comparison sort with the prefixes worked out afterwards. */
+static void ns_sort_strings_fallback(void* pBase, size_t count, size_t stride, size_t keyOffset, size_t* pLCP)
+{
+    size_t i;
+
+    ns_sort(pBase, count, stride, ns_sort_strings_compare_key, &keyOffset);
+
+    if (pLCP != NULL) {
+        for (i = 1; i < count; i += 1) {
+            const char* pKeyA;
+            const char* pKeyB;
+
+            NS_COPY_MEMORY(&pKeyA, (const char*)pBase + (i - 1)*stride + keyOffset, sizeof(pKeyA));
+            NS_COPY_MEMORY(&pKeyB, (const char*)pBase + (i - 0)*stride + keyOffset, sizeof(pKeyB));
+
+            pLCP[i] = ns_sort_strings_common_prefix(pKeyA, pKeyB);
+        }
+    }
+}
+
+NS_API void ns_sort_strings(const char** ppStrings, size_t count, size_t* pLCP, const ns_allocation_callbacks* pAllocationCallbacks)
+{
+    ns_sort_strings_state state;
+
+    if (ppStrings == NULL) {
+        return;
+    }
+
+    if (pLCP != NULL && count > 0) {
+        pLCP[0] = 0;
+    }
+
+    if (count < 2) {
+        return;
+    }
+
+    state.ppStrings = ppStrings;
+    state.pIndices  = NULL;
+    state.pLCP      = pLCP;
+    state.pCache    = (ns_uint64*)ns_malloc(count * sizeof(*state.pCache), pAllocationCallbacks);
+    if (state.pCache == NULL) {
+        ns_sort_strings_fallback(ppStrings, count, sizeof(*ppStrings), 0, pLCP);
+        return;
+    }
+
+    ns_sort_strings_load(&state, 0, count, 0);
+    ns_sort_strings_mkqs(&state, 0, count, 0, ns_sort_strings_bad_allowed(count));
+
+    ns_free(state.pCache, pAllocationCallbacks);
+}
+
+NS_API void ns_sort_strings_by_key(void* pBase, size_t count, size_t stride, size_t keyOffset, size_t* pLCP, const ns_allocation_callbacks* pAllocationCallbacks)
+{
+    ns_sort_strings_state state;
+    char stackTemp[NS_SORT_TEMP_BUFFER_SIZE];
+    void* pTemp;
+    size_t i;
+
+    if (pBase == NULL || keyOffset + sizeof(const char*) > stride) {
+        return;
+    }
+
+    if (pLCP != NULL && count > 0) {
+        pLCP[0] = 0;
+    }
+
+    if (count < 2) {
+        return;
+    }
+
+    /* The cache goes first to keep it aligned. */
+    state.pCache = (ns_uint64*)ns_malloc(count * (sizeof(*state.pCache) + sizeof(*state.ppStrings) + sizeof(*state.pIndices)), pAllocationCallbacks);
+    if (state.pCache == NULL) {
+        ns_sort_strings_fallback(pBase, count, stride, keyOffset, pLCP);
+        return;
+    }
+
+    state.ppStrings = (const char**)(state.pCache + count);
+    state.pIndices  = (size_t*)(state.ppStrings + count);
+    state.pLCP      = pLCP;
+
+    if (stride <= sizeof(stackTemp)) {
+        pTemp = stackTemp;
+    } else {
+        pTemp = ns_malloc(stride, pAllocationCallbacks);
+        if (pTemp == NULL) {
+            ns_free(state.pCache, pAllocationCallbacks);
+            ns_sort_strings_fallback(pBase, count, stride, keyOffset, pLCP);
+            return;
+        }
+    }
+
+    for (i = 0; i < count; i += 1) {
+        NS_COPY_MEMORY(&state.ppStrings[i], (const char*)pBase + i*stride + keyOffset, sizeof(state.ppStrings[i]));
+        state.pIndices[i] = i;
+    }
+
+    ns_sort_strings_load(&state, 0, count, 0);
+    ns_sort_strings_mkqs(&state, 0, count, 0, ns_sort_strings_bad_allowed(count));
+    ns_sort_indirect_apply_permutation((char*)pBase, count, stride, state.pIndices, pTemp);
+
+    if (pTemp != stackTemp) {
+        ns_free(pTemp, pAllocationCallbacks);
+    }
+
+    ns_free(state.pCache, pAllocationCallbacks);
+}
+/* END sort_strings.c */
+
+/* BEG sort_small.c */
+/*
+Sorting networks for small arrays of ns_int32, ns_uint32, float and ns_key_value_u32. For small arrays an insertion sort is bound by
+branch mispredictions since every comparison is a coin flip. A sorting network does a fixed sequence of compare-exchanges with no
+data dependent branches, and with SIMD each compare-exchange is done on a whole vector at a time.
+
+The ns_sort_small_*() functions are for arrays of up to NS_SORT_SMALL_MAX_COUNT elements. Anything larger is passed on to the
+matching ns_sort_*() function. Those are pattern-defeating quicksorts generated with NS_SORT_DEFINE_EX() which use the networks
+for their base case.
+
+Every type is mapped to a signed 32-bit key in a padded buffer and sorted with a bitonic network. Unsigned keys have their sign bit
+flipped. Floats have their magnitude bits flipped when negative, which gives a total order where -0.0 comes before +0.0. NaNs are
+moved to the end before sorting. The small float sort keeps them in their original order. For key/value pairs the network sorts
+indices, and the pairs are gathered into place at the end.
+
+The network uses SSE2 on x86/64 and AVX2 when it's detected at runtime. Everything else uses an insertion sort. Define
+NS_NO_SIMD to force the scalar path, or NS_NO_AVX2 to disable only the AVX2 path. None of these are stable.
+*/
+#define NS_SORT_SMALL_MAX_COUNT     64
+
+#if !defined(NS_NO_SIMD) && (defined(__x86_64__) || defined(_M_X64) || ((defined(__i386__) || defined(_M_IX86)) && (defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))))
+    #define NS_SORT_SMALL_SSE2
+    #include <emmintrin.h>
+
+    #if !defined(NS_NO_AVX2) && ((defined(_MSC_VER) && _MSC_VER >= 1700) || defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+        #define NS_SORT_SMALL_AVX2
+        #include <immintrin.h>
+
+        #if defined(_MSC_VER)
+            #include <intrin.h>
+            #define NS_SORT_SMALL_TARGET_AVX2
+        #else
+            #define NS_SORT_SMALL_TARGET_AVX2 __attribute__((target("avx2")))
+        #endif
+    #endif
+#endif
+
+#if defined(NS_SORT_SMALL_AVX2)
+static void ns_sort_small_cpuid(int info[4], int function)
+{
+#if defined(_MSC_VER)
+    __cpuidex(info, function, 0);
+#elif defined(__i386__) && defined(__PIC__)
+    /* ebx is reserved for the GOT pointer with -fPIC so save and restore it manually. */
+    __asm__ __volatile__ (
+        "xchg{l} {%%}ebx, %k1;"
+        "cpuid;"
+        "xchg{l} {%%}ebx, %k1;"
+        : "=a"(info[0]), "=&r"(info[1]), "=c"(info[2]), "=d"(info[3]) : "a"(function), "c"(0)
+    );
+#else
+    __asm__ __volatile__ (
+        "cpuid" : "=a"(info[0]), "=b"(info[1]), "=c"(info[2]), "=d"(info[3]) : "a"(function), "c"(0)
+    );
+#endif
+}
+
+static ns_uint64 ns_sort_small_xgetbv(void)
+{
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    unsigned int lo;
+    unsigned int hi;
+
+    __asm__ __volatile__ (".byte 0x0f, 0x01, 0xd0" : "=a"(lo), "=d"(hi) : "c"(0));   /* xgetbv. Not all assemblers know the mnemonic. */
+    return ((ns_uint64)hi << 32) | lo;
+#endif
+}
+
+/* The result is cached. It's the same on every thread so the race on initialization is harmless. */
+static int ns_sort_small_has_avx2(void)
+{
+    static int s_hasAVX2 = -1;
+
+    if (s_hasAVX2 < 0) {
+        int info[4];
+        int hasAVX2 = 0;
+
+        ns_sort_small_cpuid(info, 0);
+        if (info[0] >= 7) {
+            ns_sort_small_cpuid(info, 1);
+
+            /* The OS needs to be saving the YMM registers, otherwise AVX can't be used even if the CPU supports it. */
+            if ((info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (ns_sort_small_xgetbv() & 6) == 6) {
+                ns_sort_small_cpuid(info, 7);
+                hasAVX2 = (info[1] & (1 << 5)) != 0;
+            }
+        }
+
+        s_hasAVX2 = hasAVX2;
+    }
+
+    return s_hasAVX2;
+}
+#endif
+
+#if defined(NS_SORT_SMALL_SSE2)
+static NS_INLINE __m128i ns_sort_small_select_sse2(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+/*
+A bitonic sort of n keys where n is a power of two of at least 4. Each stage compares every element with the one j positions away.
+When j is at least the vector width the partners are in different vectors and whole vectors are compare-exchanged. Otherwise the
+partners are in the same vector and are brought together with a shuffle. The compare-exchange is done by computing which lanes need
+to swap, and then selecting from the shuffled and unshuffled vectors. If pValues is not NULL it follows the keys around.
+*/
+static void ns_sort_small_network_sse2(ns_int32* pKeys, ns_int32* pValues, size_t n)
+{
+    const __m128i laneIndices = _mm_set_epi32(3, 2, 1, 0);
+    const __m128i zero = _mm_setzero_si128();
+    size_t k;
+    size_t j;
+    size_t i;
+
+    for (k = 2; k <= n; k *= 2) {
+        for (j = k/2; j > 0; j /= 2) {
+            if (j >= 4) {
+                for (i = 0; i < n; i += 4) {
+                    __m128i a;
+                    __m128i b;
+                    __m128i swap;
+
+                    if ((i & j) != 0) {
+                        continue;
+                    }
+
+                    a = _mm_loadu_si128((const __m128i*)(pKeys + i));
+                    b = _mm_loadu_si128((const __m128i*)(pKeys + i + j));
+                    swap = ((i & k) == 0) ? _mm_cmpgt_epi32(a, b) : _mm_cmpgt_epi32(b, a);
+
+                    _mm_storeu_si128((__m128i*)(pKeys + i    ), ns_sort_small_select_sse2(swap, b, a));
+                    _mm_storeu_si128((__m128i*)(pKeys + i + j), ns_sort_small_select_sse2(swap, a, b));
+
+                    if (pValues != NULL) {
+                        a = _mm_loadu_si128((const __m128i*)(pValues + i));
+                        b = _mm_loadu_si128((const __m128i*)(pValues + i + j));
+
+                        _mm_storeu_si128((__m128i*)(pValues + i    ), ns_sort_small_select_sse2(swap, b, a));
+                        _mm_storeu_si128((__m128i*)(pValues + i + j), ns_sort_small_select_sse2(swap, a, b));
+                    }
+                }
+            } else {
+                const __m128i jMask = _mm_set1_epi32((int)j);
+                const __m128i kMask = _mm_set1_epi32((int)k);
+
+                for (i = 0; i < n; i += 4) {
+                    __m128i lanes       = _mm_add_epi32(_mm_set1_epi32((int)i), laneIndices);
+                    __m128i isLower     = _mm_cmpeq_epi32(_mm_and_si128(lanes, jMask), zero);
+                    __m128i isAscending = _mm_cmpeq_epi32(_mm_and_si128(lanes, kMask), zero);
+                    __m128i takeMin     = _mm_cmpeq_epi32(isLower, isAscending);
+                    __m128i v = _mm_loadu_si128((const __m128i*)(pKeys + i));
+                    __m128i p = (j == 1) ? _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)) : _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+                    __m128i swap;
+
+                    /* Both lanes of a pair must agree on whether or not to swap, including when the keys are equal. */
+                    swap = ns_sort_small_select_sse2(takeMin, _mm_cmpgt_epi32(v, p), _mm_cmpgt_epi32(p, v));
+                    _mm_storeu_si128((__m128i*)(pKeys + i), ns_sort_small_select_sse2(swap, p, v));
+
+                    if (pValues != NULL) {
+                        v = _mm_loadu_si128((const __m128i*)(pValues + i));
+                        p = (j == 1) ? _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)) : _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+                        _mm_storeu_si128((__m128i*)(pValues + i), ns_sort_small_select_sse2(swap, p, v));
+                    }
+                }
+            }
+        }
+    }
+}
+#endif
+
+#if defined(NS_SORT_SMALL_AVX2)
+/* Same as ns_sort_small_network_sse2() but with 8 lanes. n must be a power of two of at least 8. */
+NS_SORT_SMALL_TARGET_AVX2
+static void ns_sort_small_network_avx2(ns_int32* pKeys, ns_int32* pValues, size_t n)
+{
+    const __m256i laneIndices = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i zero = _mm256_setzero_si256();
+    size_t k;
+    size_t j;
+    size_t i;
+
+    for (k = 2; k <= n; k *= 2) {
+        for (j = k/2; j > 0; j /= 2) {
+            if (j >= 8) {
+                for (i = 0; i < n; i += 8) {
+                    __m256i a;
+                    __m256i b;
+                    __m256i swap;
+
+                    if ((i & j) != 0) {
+                        continue;
+                    }
+
+                    a = _mm256_loadu_si256((const __m256i*)(pKeys + i));
+                    b = _mm256_loadu_si256((const __m256i*)(pKeys + i + j));
+                    swap = ((i & k) == 0) ? _mm256_cmpgt_epi32(a, b) : _mm256_cmpgt_epi32(b, a);
+
+                    _mm256_storeu_si256((__m256i*)(pKeys + i    ), _mm256_blendv_epi8(a, b, swap));
+                    _mm256_storeu_si256((__m256i*)(pKeys + i + j), _mm256_blendv_epi8(b, a, swap));
+
+                    if (pValues != NULL) {
+                        a = _mm256_loadu_si256((const __m256i*)(pValues + i));
+                        b = _mm256_loadu_si256((const __m256i*)(pValues + i + j));
+
+                        _mm256_storeu_si256((__m256i*)(pValues + i    ), _mm256_blendv_epi8(a, b, swap));
+                        _mm256_storeu_si256((__m256i*)(pValues + i + j), _mm256_blendv_epi8(b, a, swap));
+                    }
+                }
+            } else {
+                const __m256i jMask = _mm256_set1_epi32((int)j);
+                const __m256i kMask = _mm256_set1_epi32((int)k);
+                const __m256i partners = _mm256_xor_si256(laneIndices, jMask);
+
+                for (i = 0; i < n; i += 8) {
+                    __m256i lanes       = _mm256_add_epi32(_mm256_set1_epi32((int)i), laneIndices);
+                    __m256i isLower     = _mm256_cmpeq_epi32(_mm256_and_si256(lanes, jMask), zero);
+                    __m256i isAscending = _mm256_cmpeq_epi32(_mm256_and_si256(lanes, kMask), zero);
+                    __m256i takeMin     = _mm256_cmpeq_epi32(isLower, isAscending);
+                    __m256i v = _mm256_loadu_si256((const __m256i*)(pKeys + i));
+                    __m256i p = _mm256_permutevar8x32_epi32(v, partners);
+                    __m256i swap;
+
+                    swap = _mm256_blendv_epi8(_mm256_cmpgt_epi32(p, v), _mm256_cmpgt_epi32(v, p), takeMin);
+                    _mm256_storeu_si256((__m256i*)(pKeys + i), _mm256_blendv_epi8(v, p, swap));
+
+                    if (pValues != NULL) {
+                        v = _mm256_loadu_si256((const __m256i*)(pValues + i));
+                        p = _mm256_permutevar8x32_epi32(v, partners);
+                        _mm256_storeu_si256((__m256i*)(pValues + i), _mm256_blendv_epi8(v, p, swap));
+                    }
+                }
+            }
+        }
+    }
+}
+#endif
+
+/*
+Sorts the first count keys, with pValues following along if it's not NULL. Both buffers must have room for
+NS_SORT_SMALL_MAX_COUNT elements because the network needs a power of two and pads the end with the largest key. Padding elements
+have values of count and up.
+*/
+static void ns_sort_small_keys(ns_int32* pKeys, ns_int32* pValues, size_t count)
+{
+#if defined(NS_SORT_SMALL_SSE2)
+    size_t n = 4;
+    size_t i;
+
+#if defined(NS_SORT_SMALL_AVX2)
+    if (ns_sort_small_has_avx2()) {
+        n = 8;
+    }
+#endif
+
+    while (n < count) {
+        n *= 2;
+    }
+
+    for (i = count; i < n; i += 1) {
+        pKeys[i] = 0x7FFFFFFF;
+        if (pValues != NULL) {
+            pValues[i] = (ns_int32)i;
+        }
+    }
+
+#if defined(NS_SORT_SMALL_AVX2)
+    if (n >= 8 && ns_sort_small_has_avx2()) {
+        ns_sort_small_network_avx2(pKeys, pValues, n);
+        return;
+    }
+#endif
+
+    ns_sort_small_network_sse2(pKeys, pValues, n);
+#else
+    size_t i;
+
+    for (i = 1; i < count; i += 1) {
+        ns_int32 key = pKeys[i];
+        ns_int32 value = (pValues != NULL) ? pValues[i] : 0;
+        size_t j = i;
+
+        while (j > 0 && key < pKeys[j - 1]) {
+            pKeys[j] = pKeys[j - 1];
+            if (pValues != NULL) {
+                pValues[j] = pValues[j - 1];
+            }
+
+            j -= 1;
+        }
+
+        pKeys[j] = key;
+        if (pValues != NULL) {
+            pValues[j] = value;
+        }
+    }
+#endif
+}
+
+static NS_INLINE ns_int32 ns_sort_small_u32_to_key(ns_uint32 x)
+{
+    return (ns_int32)(x ^ 0x80000000);
+}
+
+/* This mapping is its own inverse. */
+static NS_INLINE ns_uint32 ns_sort_small_f32_bits_to_key(ns_uint32 bits)
+{
+    return bits ^ (((bits & 0x80000000) != 0) ? 0x7FFFFFFF : 0);
+}
+
+static NS_INLINE int ns_sort_small_f32_is_nan(float x)
+{
+    ns_uint32 bits;
+    NS_COPY_MEMORY(&bits, &x, sizeof(bits));
+    return (bits & 0x7FFFFFFF) > 0x7F800000;
+}
+
+static NS_INLINE ns_int32 ns_sort_small_f32_to_key(float x)
+{
+    ns_uint32 bits;
+    NS_COPY_MEMORY(&bits, &x, sizeof(bits));
+    return (ns_int32)ns_sort_small_f32_bits_to_key(bits);
+}
+
+NS_API void ns_sort_small_i32(ns_int32* pData, size_t count)
+{
+    ns_int32 keys[NS_SORT_SMALL_MAX_COUNT];
+
+    if (pData == NULL || count < 2) {
+        return;
+    }
+
+    if (count > NS_SORT_SMALL_MAX_COUNT) {
+        ns_sort_i32(pData, count);
+        return;
+    }
+
+    NS_COPY_MEMORY(keys, pData, count * sizeof(*pData));
+    ns_sort_small_keys(keys, NULL, count);
+    NS_COPY_MEMORY(pData, keys, count * sizeof(*pData));
+}
+
+NS_API void ns_sort_small_u32(ns_uint32* pData, size_t count)
+{
+    ns_int32 keys[NS_SORT_SMALL_MAX_COUNT];
+    size_t i;
+
+    if (pData == NULL || count < 2) {
+        return;
+    }
+
+    if (count > NS_SORT_SMALL_MAX_COUNT) {
+        ns_sort_u32(pData, count);
+        return;
+    }
+
+    for (i = 0; i < count; i += 1) {
+        keys[i] = ns_sort_small_u32_to_key(pData[i]);
+    }
+
+    ns_sort_small_keys(keys, NULL, count);
+
+    for (i = 0; i < count; i += 1) {
+        pData[i] = (ns_uint32)keys[i] ^ 0x80000000;
+    }
+}
+
+NS_API void ns_sort_small_f32(float* pData, size_t count)
+{
+    ns_int32 keys[NS_SORT_SMALL_MAX_COUNT];
+    float nans[NS_SORT_SMALL_MAX_COUNT];
+    size_t keyCount = 0;
+    size_t nanCount = 0;
+    size_t i;
+
+    if (pData == NULL || count < 2) {
+        return;
+    }
+
+    if (count > NS_SORT_SMALL_MAX_COUNT) {
+        ns_sort_f32(pData, count);
+        return;
+    }
+
+    for (i = 0; i < count; i += 1) {
+        if (ns_sort_small_f32_is_nan(pData[i])) {
+            nans[nanCount] = pData[i];
+            nanCount += 1;
+        } else {
+            keys[keyCount] = ns_sort_small_f32_to_key(pData[i]);
+            keyCount += 1;
+        }
+    }
+
+    ns_sort_small_keys(keys, NULL, keyCount);
+
+    for (i = 0; i < keyCount; i += 1) {
+        ns_uint32 bits = ns_sort_small_f32_bits_to_key((ns_uint32)keys[i]);
+        NS_COPY_MEMORY(&pData[i], &bits, sizeof(bits));
+    }
+
+    NS_COPY_MEMORY(pData + keyCount, nans, nanCount * sizeof(*pData));
+}
+
+NS_API void ns_sort_small_kv_u32(ns_key_value_u32* pData, size_t count)
+{
+    ns_int32 keys[NS_SORT_SMALL_MAX_COUNT];
+    ns_int32 indices[NS_SORT_SMALL_MAX_COUNT];
+    ns_key_value_u32 copy[NS_SORT_SMALL_MAX_COUNT];
+    size_t i;
+    size_t j;
+
+    if (pData == NULL || count < 2) {
+        return;
+    }
+
+    if (count > NS_SORT_SMALL_MAX_COUNT) {
+        ns_sort_kv_u32(pData, count);
+        return;
+    }
+
+    for (i = 0; i < count; i += 1) {
+        keys[i]    = ns_sort_small_u32_to_key(pData[i].key);
+        indices[i] = (ns_int32)i;
+    }
+
+    ns_sort_small_keys(keys, indices, count);
+
+    /*
+    Real keys equal to the largest key can get mixed in with the padding. Anything after the first padding element must have the
+    largest key, so any padding that landed in the first count slots can be swapped with real elements from after it.
+    */
+    for (i = 0, j = count; i < count; i += 1) {
+        if ((size_t)indices[i] >= count) {
+            while ((size_t)indices[j] >= count) {
+                j += 1;
+            }
+
+            indices[i] = indices[j];
+            indices[j] = (ns_int32)count;
+        }
+    }
+
+    NS_COPY_MEMORY(copy, pData, count * sizeof(*pData));
+    for (i = 0; i < count; i += 1) {
+        pData[i] = copy[indices[i]];
+    }
+}
+
+/* The larger sorts are pdqsorts that use the networks above for partitions of up to NS_SORT_SMALL_MAX_COUNT elements. */
+#define NS_SORT_SMALL_LESS(a, b)        ((a) < (b))
+#define NS_SORT_SMALL_LESS_F32(a, b)    (ns_sort_small_f32_to_key(a) < ns_sort_small_f32_to_key(b))
+#define NS_SORT_SMALL_LESS_KV(a, b)     ((a).key < (b).key)
+
+NS_SORT_DEFINE_EX(ns_sort_i32_pdq,    ns_int32,         NS_SORT_SMALL_LESS,     ns_sort_small_i32,    NS_SORT_SMALL_MAX_COUNT + 1)
+NS_SORT_DEFINE_EX(ns_sort_u32_pdq,    ns_uint32,        NS_SORT_SMALL_LESS,     ns_sort_small_u32,    NS_SORT_SMALL_MAX_COUNT + 1)
+NS_SORT_DEFINE_EX(ns_sort_f32_pdq,    float,            NS_SORT_SMALL_LESS_F32, ns_sort_small_f32,    NS_SORT_SMALL_MAX_COUNT + 1)
+NS_SORT_DEFINE_EX(ns_sort_kv_u32_pdq, ns_key_value_u32, NS_SORT_SMALL_LESS_KV,  ns_sort_small_kv_u32, NS_SORT_SMALL_MAX_COUNT + 1)
+
+NS_API void ns_sort_i32(ns_int32* pData, size_t count)
+{
+    ns_sort_i32_pdq(pData, count);
+}
+
+NS_API void ns_sort_u32(ns_uint32* pData, size_t count)
+{
+    ns_sort_u32_pdq(pData, count);
+}
+
+NS_API void ns_sort_f32(float* pData, size_t count)
+{
+    size_t nonNanCount = count;
+    size_t i;
+
+    if (pData == NULL) {
+        return;
+    }
+
+    /* NaNs don't have a well defined order so they're moved out of the way first. */
+    for (i = 0; i < nonNanCount; ) {
+        if (ns_sort_small_f32_is_nan(pData[i])) {
+            float temp;
+
+            nonNanCount -= 1;
+            temp = pData[i];
+            pData[i] = pData[nonNanCount];
+            pData[nonNanCount] = temp;
+        } else {
+            i += 1;
+        }
+    }
+
+    ns_sort_f32_pdq(pData, nonNanCount);
+}
+
+NS_API void ns_sort_kv_u32(ns_key_value_u32* pData, size_t count)
+{
+    ns_sort_kv_u32_pdq(pData, count);
+}
+/* END sort_small.c */
+
+
+
+/* BEG Tests */
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct
+{
+    unsigned int key;
+    unsigned int index;
+    char padding[192];  /* To test large strides. */
+} test_record;
+
+static size_t g_compareCount = 0;
+
+static unsigned int test_random(unsigned int* pState)
+{
+    /* xorshift32 */
+    unsigned int x = *pState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *pState = x;
+    return x;
+}
+
+static int compare_uint(void* pUserData, const void* a, const void* b)
+{
+    unsigned int x = *(const unsigned int*)a;
+    unsigned int y = *(const unsigned int*)b;
+
+    (void)pUserData;
+    g_compareCount += 1;
+
+    return (x > y) - (x < y);
+}
+
+/* Same as compare_uint(), but doesn't touch g_compareCount which makes it safe to use from multiple threads. */
+static int compare_uint_no_count(void* pUserData, const void* a, const void* b)
+{
+    unsigned int x = *(const unsigned int*)a;
+    unsigned int y = *(const unsigned int*)b;
+
+    (void)pUserData;
+    return (x > y) - (x < y);
+}
+
+static int compare_record(void* pUserData, const void* a, const void* b)
+{
+    return compare_uint(pUserData, &((const test_record*)a)->key, &((const test_record*)b)->key);
+}
+
+typedef struct
+{
+    unsigned int key;
+    unsigned int index;
+} test_pair;
+
+static int compare_pair(void* pUserData, const void* a, const void* b)
+{
+    return compare_uint(pUserData, &((const test_pair*)a)->key, &((const test_pair*)b)->key);
+}
+
+typedef struct
+{
+    size_t mallocCount;
+    size_t freeCount;
+    int failAllocations;
+} test_allocator_state;
+
+static void* test_malloc(size_t sz, void* pUserData)
+{
+    test_allocator_state* pState = (test_allocator_state*)pUserData;
+
+    if (pState->failAllocations) {
+        return NULL;
+    }
+
+    pState->mallocCount += 1;
+    return malloc(sz);
+}
+
+static void* test_realloc(void* p, size_t sz, void* pUserData)
+{
+    test_allocator_state* pState = (test_allocator_state*)pUserData;
+
+    if (pState->failAllocations) {
+        return NULL;
+    }
+
+    if (p == NULL) {
+        pState->mallocCount += 1;
+    }
+
+    return realloc(p, sz);
+}
+
+static void test_free(void* p, void* pUserData)
+{
+    test_allocator_state* pState = (test_allocator_state*)pUserData;
+
+    if (p == NULL) {
+        return;
+    }
+
+    pState->freeCount += 1;
+    free(p);
+}
+
+static ns_allocation_callbacks test_allocation_callbacks_init(test_allocator_state* pState)
+{
+    ns_allocation_callbacks callbacks;
+
+    memset(pState, 0, sizeof(*pState));
+
+    callbacks.pUserData = pState;
+    callbacks.onMalloc  = test_malloc;
+    callbacks.onRealloc = test_realloc;
+    callbacks.onFree    = test_free;
+
+    return callbacks;
+}
+
+typedef enum
+{
+    test_distribution_random,
+    test_distribution_sorted,
+    test_distribution_reversed,
+    test_distribution_few_unique,
+    test_distribution_all_equal,
+    test_distribution_organ_pipe,
+    test_distribution_sawtooth,
+    test_distribution_count
+} test_distribution;
+
+static const char* test_distribution_name(test_distribution distribution)
+{
+    switch (distribution)
+    {
+        case test_distribution_random:      return "random";
+        case test_distribution_sorted:      return "sorted";
+        case test_distribution_reversed:    return "reversed";
+        case test_distribution_few_unique:  return "few unique";
+        case test_distribution_all_equal:   return "all equal";
+        case test_distribution_organ_pipe:  return "organ pipe";
+        case test_distribution_sawtooth:    return "sawtooth";
+        default:                            return "unknown";
+    }
+}
+
+static unsigned int test_generate_key(test_distribution distribution, size_t i, size_t count, unsigned int* pRandomState)
+{
+    switch (distribution)
+    {
+        case test_distribution_random:      return test_random(pRandomState);
+        case test_distribution_sorted:      return (unsigned int)i;
+        case test_distribution_reversed:    return (unsigned int)(count - i);
+        case test_distribution_few_unique:  return test_random(pRandomState) % 4;
+        case test_distribution_all_equal:   return 42;
+        case test_distribution_organ_pipe:  return (unsigned int)((i < count/2) ? i : count - i);
+        case test_distribution_sawtooth:    return (unsigned int)(i % 100);
+        default:                            return 0;
+    }
+}
+
+/* Returns the maximum number of comparisons we'll accept before considering the sort to have gone quadratic. */
+static size_t test_max_compare_count(size_t count)
+{
+    size_t log2 = 1;
+    size_t n;
+
+    for (n = count; n > 1; n >>= 1) {
+        log2 += 1;
+    }
+
+    return 4 * count * log2;
+}
+
+static int test_sort_uint_distributions(void)
+{
+    size_t count = 100000;
+    unsigned int* pData;
+    int distribution;
+
+    printf("Testing ns_sort() with unsigned int distributions...\n");
+
+    pData = (unsigned int*)malloc(count * sizeof(*pData));
+    if (pData == NULL) {
+        printf("  FAILED: out of memory\n");
+        return 0;
+    }
+
+    for (distribution = 0; distribution < test_distribution_count; distribution += 1) {
+        unsigned int randomState = 12345;
+        unsigned long sumBefore = 0;
+        unsigned long sumAfter = 0;
+        size_t i;
+
+        for (i = 0; i < count; i += 1) {
+            pData[i] = test_generate_key((test_distribution)distribution, i, count, &randomState);
+            sumBefore += pData[i];
+        }
+
+        g_compareCount = 0;
+        ns_sort(pData, count, sizeof(*pData), compare_uint, NULL);
+
+        for (i = 0; i < count; i += 1) {
+            sumAfter += pData[i];
+
+            if (i > 0 && pData[i - 1] > pData[i]) {
+                printf("  FAILED: %s: not sorted at index %lu\n", test_distribution_name((test_distribution)distribution), (unsigned long)i);
+                free(pData);
+                return 0;
+            }
+        }
+
+        if (sumBefore != sumAfter) {
+            printf("  FAILED: %s: elements were lost\n", test_distribution_name((test_distribution)distribution));
+            free(pData);
+            return 0;
+        }
+
+        if (g_compareCount > test_max_compare_count(count)) {
+            printf("  FAILED: %s: too many comparisons (%lu)\n", test_distribution_name((test_distribution)distribution), (unsigned long)g_compareCount);
+            free(pData);
+            return 0;
+        }
+    }
+
+    free(pData);
+
+    printf("  PASSED\n");
+    return 1;
+}
+
+static int test_sort_small_counts(void)
+{
+    unsigned int data[64];
+    size_t count;
+
+    printf("Testing ns_sort() with small counts...\n");
+
+    for (count = 0; count <= 64; count += 1) {
+        unsigned int randomState = (unsigned int)count + 1;
+        size_t i;
+
+        for (i = 0; i < count; i += 1) {
+            data[i] = test_random(&randomState) % 16;
+        }
+
+        ns_sort(data, count, sizeof(data[0]), compare_uint, NULL);
+
+        for (i = 1; i < count; i += 1) {
+            if (data[i - 1] > data[i]) {
+                printf("  FAILED: count %lu not sorted at index %lu\n", (unsigned long)count, (unsigned long)i);
+                return 0;
+            }
+        }
+    }
+
+    printf("  PASSED\n");
+    return 1;
+}
+
+static int test_sort_large_stride(void)
+{
+    size_t count = 5000;
+    test_record* pRecords;
+    unsigned int randomState = 6789;
+    size_t i;
+
+    printf("Testing ns_sort() with a large stride...\n");
+
+    pRecords = (test_record*)malloc(count * sizeof(*pRecords));
+    if (pRecords == NULL) {
+        printf("  FAILED: out of memory\n");
+        return 0;
+    }
+
+    for (i = 0; i < count; i += 1) {
+        pRecords[i].key   = test_random(&randomState) % 1000;
+        pRecords[i].index = (unsigned int)i;
+        memset(pRecords[i].padding, (int)(pRecords[i].key & 0xFF), sizeof(pRecords[i].padding));
+    }
+
+    ns_sort(pRecords, count, sizeof(*pRecords), compare_record, NULL);
+
+    for (i = 0; i < count; i += 1) {
+        if (i > 0 && pRecords[i - 1].key > pRecords[i].key) {
+            printf("  FAILED: not sorted at index %lu\n", (unsigned long)i);
+            free(pRecords);
+            return 0;
+        }
+
+        /* Make sure the records were moved as a whole. */
+        if ((unsigned char)pRecords[i].padding[sizeof(pRecords[i].padding) - 1] != (pRecords[i].key & 0xFF)) {
+            printf("  FAILED: record corrupted at index %lu\n", (unsigned long)i);
+            free(pRecords);
+            return 0;
+        }
+    }
+
+    free(pRecords);
+
+    printf("  PASSED\n");
+    return 1;
+}
+
+/* Checks that the pairs are sorted by key, that equal keys are in their original order, and that no pairs were lost. */
+static int test_check_stable_pairs(const test_pair* pPairs, size_t count, const char* pName)
+{
+    unsigned char* pSeen;
+    size_t i;
+
+    pSeen = (unsigned char*)calloc(count, 1);
+    if (pSeen == NULL) {
+        printf("  FAILED: out of memory\n");
+        return 0;
+    }
+
+    for (i = 0; i < count; i += 1) {
+        if (i > 0) {
+            if (pPairs[i - 1].key > pPairs[i].key) {
+                printf("  FAILED: %s: not sorted at index %lu\n", pName, (unsigned long)i);
+                free(pSeen);
+                return 0;
+            }
+
+            if (pPairs[i - 1].key == pPairs[i].key && pPairs[i - 1].index > pPairs[i].index) {
+                printf("  FAILED: %s: not stable at index %lu\n", pName, (unsigned long)i);
+                free(pSeen);
+                return 0;
+            }
+        }
+
+        if (pPairs[i].index >= count || pSeen[pPairs[i].index]) {
+            printf("  FAILED: %s: elements were lost\n", pName);
+            free(pSeen);
+            return 0;
+        }
+
+        pSeen[pPairs[i].index] = 1;
+    }
+
+    free(pSeen);
+    return 1;
+}
+
+static int test_sort_stable_distributions(void)
+{
+    size_t count = 100000;
+    test_pair* pPairs;
+    test_allocator_state allocatorState;
+    ns_allocation_callbacks allocationCallbacks;
+    int distribution;
+
+    printf("Testing ns_sort_stable() with distributions...\n");
+
+    pPairs = (test_pair*)malloc(count * sizeof(*pPairs));
+    if (pPairs == NULL) {
+        printf("  FAILED: out of memory\n");
+        return 0;
+    }
+
+    allocationCallbacks = test_allocation_callbacks_init(&allocatorState);
+
+    for (distribution = 0; distribution < test_distribution_count; distribution += 1) {
+        unsigned int randomState = 12345;
+        size_t i;
+
+        for (i = 0; i < count; i += 1) {
+            pPairs[i].key   = test_generate_key((test_distribution)distribution, i, count, &randomState);
+            pPairs[i].index = (unsigned int)i;
+        }
+
+        g_compareCount = 0;
+        ns_sort_stable(pPairs, count, sizeof(*pPairs), compare_pair, NULL, &allocationCallbacks);
+
+        if (!test_check_stable_pairs(pPairs, count, test_distribution_name((test_distribution)distribution))) {
+            free(pPairs);
+            return 0;
+        }
+
+        if (g_compareCount > test_max_compare_count(count)) {
+            printf("  FAILED: %s: too many comparisons (%lu)\n", test_distribution_name((test_distribution)distribution), (unsigned long)g_compareCount);
+            free(pPairs);
+            return 0;
+        }
+    }
+
+    free(pPairs);
+
+    if (allocatorState.mallocCount == 0 || allocatorState.mallocCount != allocatorState.freeCount) {
+        printf("  FAILED: mallocCount = %lu, freeCount = %lu\n", (unsigned long)allocatorState.mallocCount, (unsigned long)allocatorState.freeCount);
+        return 0;
+    }
+
+    printf("  PASSED\n");
+    return 1;
+}
+
+static int test_sort_stable_nearly_sorted(void)
+{
+    size_t count = 100000;
+    size_t appendedCount = 100;
+    test_pair* pPairs;
+    unsigned int randomState = 999;
+    size_t i;
+
+    printf("Testing ns_sort_stable() with nearly sorted data...\n");
+
+    pPairs = (test_pair*)malloc(count * sizeof(*pPairs));
+    if (pPairs == NULL) {
+        printf("  FAILED: out of memory\n");
+        return 0;
+    }
+
+    /* Already sorted data should take exactly n-1 comparisons. */
+    for (i = 0; i < count; i += 1) {
+        pPairs[i].key   = (unsigned int)(i / 3);
+        pPairs[i].index = (unsigned int)i;
+    }
+
+    g_compareCount = 0;
+    ns_sort_stable(pPairs, count, sizeof(*pPairs), compare_pair, NULL, NULL);
+
+    if (!test_check_stable_pairs(pPairs, count, "sorted")) {
+        free(pPairs);
+        return 0;
+    }
+
+    if (g_compareCount != count - 1) {
+        printf("  FAILED: sorted: %lu comparisons, expected %lu\n", (unsigned long)g_compareCount, (unsigned long)(count - 1));
+        free(pPairs);
+        return 0;
+    }
+
+    /* A sorted batch with a few random elements appended to the end, like a log that's been appended to. */
+    for (i = count - appendedCount; i < count; i += 1) {
+        pPairs[i].key = test_random(&randomState) % (unsigned int)(count / 3);
+    }
+    for (i = 0; i < count; i += 1) {
+        pPairs[i].index = (unsigned int)i;
+    }
+
+    g_compareCount = 0;
+    ns_sort_stable(pPairs, count, sizeof(*pPairs), compare_pair, NULL, NULL);
+
+    if (!test_check_stable_pairs(pPairs, count, "appended")) {
+        free(pPairs);
+        return 0;
+    }
+
+    if (g_compareCount > count * 2) {
+        printf("  FAILED: appended: too many comparisons (%lu)\n", (unsigned long)g_compareCount);
+        free(pPairs);
+        return 0;
+    }
+
+    free(pPairs);
+
+    printf("  PASSED\n");
+    return 1;
+}
+
+static int test_sort_stable_no_memory(void)
+{
+    size_t count = 20000;
+    test_pair* pPairs;
+    test_allocator_state allocatorState;
+    ns_allocation_callbacks allocationCallbacks;
+    unsigned int randomState = 4321;
+    size_t i;
+
+    printf("Testing ns_sort_stable() when scratch memory is unavailable...\n");
+
+    pPairs = (test_pair*)malloc(count * sizeof(*pPairs));
+    if (pPairs == NULL) {
+        printf("  FAILED: out of memory\n");
+        return 0;
+    }
+
+    for (i = 0; i < count; i += 1) {
+        pPairs[i].key   = test_random(&randomState) % 100;
+        pPairs[i].index = (unsigned int)i;
+    }
+
+    allocationCallbacks = test_allocation_callbacks_init(&allocatorState);
+    allocatorState.failAllocations = 1;
+
+    ns_sort_stable(pPairs, count, sizeof(*pPairs), compare_pair, NULL, &allocationCallbacks);
+
+    if (!test_check_stable_pairs(pPairs, count, "no memory")) {
+        free(pPairs);
+        return 0;
+    }
+
+    free(pPairs);
+
+    printf("  PASSED\n");
+    return 1;
+}
+
+static int test_sort_stable_large_stride(void)
+{
+    size_t count = 5000;
+    test_record* pRecords;
+    unsigned int randomState = 6789;
+    size_t i;
+
+    printf("Testing ns_sort_stable() with a large stride...\n");
+
+    pRecords = (test_record*)malloc(count * sizeof(*pRecords));
+    if (pRecords == NULL) {
+        printf("  FAILED: out of memory\n");
+        return 0;
+    }
+
+    for (i = 0; i < count; i += 1) {
+        pRecords[i].key   = test_random(&randomState) % 50;
+        pRecords[i].index = (unsigned int)i;
+        memset(pRecords[i].padding, (int)(pRecords[i].index & 0xFF), sizeof(pRecords[i].padding));
+    }
+
+    ns_sort_stable(pRecords, count, sizeof(*pRecords), compare_record, NULL, NULL);
+
+    for (i = 0; i < count; i += 1) {
+        if (i > 0 && (pRecords[i - 1].key > pRecords[i].key || (pRecords[i - 1].key == pRecords[i].key && pRecords[i - 1].index > pRecords[i].index))) {
+            printf("  FAILED: not sorted or not stable at index %lu\n", (unsigned long)i);
+            free(pRecords);
+            return 0;
+        }
+
+        if ((unsigned char)pRecords[i].padding[sizeof(pRecords[i].padding) - 1] != (pRecords[i].index & 0xFF)) {
+            printf("  FAILED: record corrupted at index %lu\n", (unsigned long)i);
+            free(pRecords);
+            return 0;
+        }
+    }
+
+    free(pRecords);
+
+    printf("  PASSED\n");
+    return 1;
+}
+
+static int compare_u64(void* pUserData, const void* a, const void* b)
+{
+    ns_uint64 x = *(const ns_uint64*)a;
+    ns_uint64 y = *(const ns_uint64*)b;
+
+    (void)pUserData;
+    return (x > y) - (x < y);
+}
+
+static int compare_i32(void* pUserData, const void* a, const void* b)
+{
+    ns_int32 x = *(const ns_int32*)a;
+    ns_int32 y = *(const ns_int32*)b;
+
+    (void)pUserData;
+    return (x > y) - (x < y);
+}
+
+static int compare_i64(void* pUserData, const void* a, const void* b)
+{
+    ns_int64 x = *(const ns_int64*)a;
+    ns_int64 y = *(const ns_int64*)b;
+
+    (void)pUserData;
+    return (x > y) - (x < y);
+}
+
+static ns_uint64 test_random_u64(unsigned int* pState)
+{
+    ns_uint64 hi = test_random(pState);
+    ns_uint64 lo = test_random(pState);
+    return (hi << 32) | lo;
+}
+
+static int test_radix_sort_integers(void)
+{
+    size_t count = 100000;
+    ns_uint64* pData;
+    ns_uint64* pExpected;
+    unsigned int randomState = 24680;
+    int iType;
+
+    printf("Testing ns_radix_sort_u32/u64/i32/i64()...\n");
+
+    pData     = (ns_uint64*)malloc(count * sizeof(*pData));
+    pExpected = (ns_uint64*)malloc(count * sizeof(*pExpected));
+    if (pData == NULL || pExpected == NULL) {
+        printf("  FAILED: out of memory\n");
+        free(pData);
+        free(pExpected);
+        return 0;
+    }
+
+    for (iType = 0; iType < 4; iType += 1) {
+        static const char* typeNames[] = {"u32", "u64", "i32", "i64"};
+        size_t elementSize = (iType == 0 || iType == 2) ? 4 : 8;
+        size_t i;
+
+        /* Random bits, with a few extremes thrown in. Interpreted as signed, about half of these will be negative. */
+        for (i = 0; i < count; i += 1) {
+            ns_uint64 value = test_random_u64(&randomState);
+
+            if (i % 1000 == 0) {
+                value = 0;
+            } else if (i % 1000 == 1) {
+                value = ~(ns_uint64)0;
+            }
+
+            if (elementSize == 4) {
+                ns_uint32 value32 = (ns_uint32)value;
+                memcpy((char*)pData + i*4, &value32, 4);
+            } else {
+                pData[i] = value;
+            }
+        }
+
+        memcpy(pExpected, pData, count * elementSize);
+
+        switch (iType)
+        {
+            case 0: ns_radix_sort_u32(pData, count, 4, 0, NULL); ns_sort(pExpected, count, 4, compare_uint, NULL); break;
+            case 1: ns_radix_sort_u64(pData, count, 8, 0, NULL); ns_sort(pExpected, count, 8, compare_u64,  NULL); break;
+            case 2: ns_radix_sort_i32(pData, count, 4, 0, NULL); ns_sort(pExpected, count, 4, compare_i32,  NULL); break;
+            case 3: ns_radix_sort_i64(pData, count, 8, 0, NULL); ns_sort(pExpected, count, 8, compare_i64,  NULL); break;
+            default: break;
+        }
+
+        if (memcmp(pData, pExpected, count * elementSize) != 0) {
+            printf("  FAILED: %s: result differs from ns_sort()\n", typeNames[iType]);
+            free(pData);
+            free(pExpected);
+            return 0;
+        }
+    }
+
+    free(pData);
+    free(pExpected);
+
+    printf("  PASSED\n");
+    return 1;
+}
+
+static int test_radix_sort_records(void)
+{
+    size_t count = 50000;
+    test_pair* pPairs;
+    test_allocator_state allocatorState;
+    ns_allocation_callbacks allocationCallbacks;
+    unsigned int randomState = 13579;
+    int failAllocations;
+    size_t i;
+
+    printf("Testing ns_radix_sort_u32() with records...\n");
+
+    pPairs = (test_pair*)malloc(count * sizeof(*pPairs));
+    if (pPairs == NULL) {
+        printf("  FAILED: out of memory\n");
+        return 0;
+    }
+
+    allocationCallbacks = test_allocation_callbacks_init(&allocatorState);
+
+    /* The second time around the scratch buffer can't be allocated which should fall back to a comparison sort. */
+    for (failAllocations = 0; failAllocations < 2; failAllocations += 1) {
+        for (i = 0; i < count; i += 1) {
+            pPairs[i].key   = test_random(&randomState) % 1000;
+            pPairs[i].index = (unsigned int)i;
+        }
+
+        allocatorState.failAllocations = failAllocations;
+        ns_radix_sort_u32(pPairs, count, sizeof(*pPairs), offsetof(test_pair, key), &allocationCallbacks);
+
+        if (!test_check_stable_pairs(pPairs, count, failAllocations ? "fallback" : "radix")) {
+            free(pPairs);
+            return 0;
+        }
+    }
+
+    if (allocatorState.mallocCount != allocatorState.freeCount) {
+        printf("  FAILED: mallocCount = %lu, freeCount = %lu\n", (unsigned long)allocatorState.mallocCount, (unsigned long)allocatorState.freeCount);
+        free(pPairs);
+        return 0;
+    }
+
+    /* If every key is the same there's nothing to do, not even allocate the scratch buffer. */
+    for (i = 0; i < count; i += 1) {
+        pPairs[i].key   = 7;
+        pPairs[i].index = (unsigned int)i;
+    }
+
+    allocationCallbacks = test_allocation_callbacks_init(&allocatorState);
+    ns_radix_sort_u32(pPairs, count, sizeof(*pPairs), offsetof(test_pair, key), &allocationCallbacks);
+
+    if (allocatorState.mallocCount != 0 || !test_check_stable_pairs(pPairs, count, "all equal")) {
+        printf("  FAILED: all equal keys were not skipped\n");
+        free(pPairs);
+        return 0;
+    }
+
+    free(pPairs);
+
+    printf("  PASSED\n");
+    return 1;
+}
+
+typedef struct
+{
+    float key;
+    unsigned int index;
+} test_float_pair;
+
+static float test_float_from_bits(ns_uint32 bits)
+{
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static double test_double_from_bits(ns_uint64 bits)
+{
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static int test_radix_sort_f32(void)
+{
+    size_t count = 20000;
+    test_float_pair* pPairs;
+    unsigned int randomState = 11111;
+    size_t i;
+    size_t nanStart;
+
+    printf("Testing ns_radix_sort_f32()...\n");
+
+    pPairs = (test_float_pair*)malloc(count * sizeof(*pPairs));
+    if (pPairs == NULL) {
+        printf("  FAILED: out of memory\n");
+        return 0;
+    }
+
+    for (i = 0; i < count; i += 1) {
+        switch (i % 10)
+        {
+            case 0:  pPairs[i].key = test_float_from_bits(0x80000000); break;                                   /* -0.0 */
+            case 1:  pPairs[i].key = 0.0f; break;
+            case 2:  pPairs[i].key = test_float_from_bits((i % 20 == 2) ? 0x7FC00000 : 0xFFC00001); break;    /* +NaN and -NaN */
+            case 3:  pPairs[i].key = test_float_from_bits((i % 20 == 3) ? 0x7F800000 : 0xFF800000); break;    /* +inf and -inf */
+            case 4:  pPairs[i].key = test_float_from_bits(0x00000001); break;                                   /* Smallest denormal. */
+            default: pPairs[i].key = ((float)(test_random(&randomState) % 2000000) - 1000000.0f) / 7.0f; break;
+        }
+
+        pPairs[i].index = (unsigned int)i;
+    }
+
+    ns_radix_sort_f32(pPairs, count, sizeof(*pPairs), offsetof(test_float_pair, key), NULL);
+
+    /* NaNs don't compare equal to themselves so they can be found with a self comparison. */
+    nanStart = count;
+    for (i = 0; i < count; i += 1) {
+        if (pPairs[i].key != pPairs[i].key) {
+            nanStart = i;
+            break;
+        }
+    }
+
+    if (nanStart != count - count/10) {
+        printf("  FAILED: NaNs not at the end\n");
+        free(pPairs);
+        return 0;
+    }
+
+    for (i = 1; i < count; i += 1) {
+        if (i < nanStart) {
+            ns_uint32 prevBits;
+            ns_uint32 bits;
+
+            if (pPairs[i - 1].key > pPairs[i].key) {
+                printf("  FAILED: not sorted at index %lu\n", (unsigned long)i);
+                free(pPairs);
+                return 0;
+            }
+
+            /* -0.0 must come before +0.0. */
+            memcpy(&prevBits, &pPairs[i - 1].key, sizeof(prevBits));
+            memcpy(&bits,     &pPairs[i    ].key, sizeof(bits));
+            if (prevBits == 0x00000000 && bits == 0x80000000) {
+                printf("  FAILED: +0.0 before -0.0 at index %lu\n", (unsigned long)i);
+                free(pPairs);
+                return 0;
+            }
+        } else if (i > nanStart) {
+            if (pPairs[i].key == pPairs[i].key || pPairs[i - 1].index > pPairs[i].index) {
+                printf("  FAILED: NaNs not in original order at index %lu\n", (unsigned long)i);
+                free(pPairs);
+                return 0;
+            }
+        }
+    }
+
+    free(pPairs);
+
+    printf("  PASSED\n");
+    return 1;
+}
+
+static int test_radix_sort_f64(void)
+{
+    size_t count = 20000;
+    double* pData;
+    double* pFallbackData;
+    test_allocator_state allocatorState;
+    ns_allocation_callbacks allocationCallbacks;
+    unsigned int randomState = 22222;
+    size_t i;
+
+    printf("Testing ns_radix_sort_f64()...\n");
+
+    pData         = (double*)malloc(count * sizeof(*pData));
+    pFallbackData = (double*)malloc(count * sizeof(*pFallbackData));
+    if (pData == NULL || pFallbackData == NULL) {
+        printf("  FAILED: out of memory\n");
+        free(pData);
+        free(pFallbackData);
+        return 0;
+    }
+
+    for (i = 0; i < count; i += 1) {
+        switch (i % 8)
+        {
+            case 0:  pData[i] = test_double_from_bits((ns_uint64)0x80000000 << 32); break;  /* -0.0 */
+            case 1:  pData[i] = test_double_from_bits((ns_uint64)0x7FF80000 << 32); break;  /* NaN */
+            case 2:  pData[i] = test_double_from_bits((ns_uint64)0xFFF00000 << 32); break;  /* -inf */
+            default: pData[i] = ((double)test_random(&randomState) - 2147483648.0) * 1e-3; break;
+        }
+    }
+
+    memcpy(pFallbackData, pData, count * sizeof(*pData));
+
+    ns_radix_sort_f64(pData, count, sizeof(*pData), 0, NULL);
+
+    for (i = 1; i < count - count/8; i += 1) {
+        if (pData[i - 1] > pData[i] || pData[i] != pData[i]) {
+            printf("  FAILED: not sorted at index %lu\n", (unsigned long)i);
+            free(pData);
+            free(pFallbackData);
+            return 0;
+        }
+    }
+
+    for (i = count - count/8; i < count; i += 1) {
+        if (pData[i] == pData[i]) {
+            printf("  FAILED: NaNs not at the end\n");
+            free(pData);
+            free(pFallbackData);
+            return 0;
+        }
+    }
+
+    /* The comparison sort fallback needs to use the exact same ordering. */
+    allocationCallbacks = test_allocation_callbacks_init(&allocatorState);
+    allocatorState.failAllocations = 1;
+
+    ns_radix_sort_f64(pFallbackData, count, sizeof(*pFallbackData), 0, &allocationCallbacks);
+
+    if (memcmp(pData, pFallbackData, count * sizeof(*pData)) != 0) {
+        printf("  FAILED: fallback ordering differs\n");
+        free(pData);
+        free(pFallbackData);
+        return 0;
+    }
+
+    free(pData);
+    free(pFallbackData);
+
+    printf("  PASSED\n");
+    return 1;
+}
+
+#define TEST_LESS_UINT(a, b) ((a) < (b))
+#define TEST_LESS_PAIR(a, b) ((a).key < (b).key)
+NS_SORT_DEFINE(test_sort_uint, unsigned int, TEST_LESS_UINT)
+NS_SORT_DEFINE(test_sort_pair, test_pair, TEST_LESS_PAIR)
+
+static int test_sort_define(void)
+{
+    size_t count = 100000;
+    unsigned int* pData;
+    unsigned int* pExpected;
+    test_pair* pPairs;
+    int distribution;
+
+    printf("Testing NS_SORT_DEFINE()...\n");
+
+    pData     = (unsigned int*)malloc(count * sizeof(*pData));
+    pExpected = (unsigned int*)malloc(count * sizeof(*pExpected));
+    pPairs    = (test_pair*)malloc(count * sizeof(*pPairs));
+    if (pData == NULL || pExpected == NULL || pPairs == NULL) {
+        printf("  FAILED: out of memory\n");
+        free(pData);
+        free(pExpected);
+        free(pPairs);
+        return 0;
+    }
+
+    for (distribution = 0; distribution < test_distribution_count; distribution += 1) {
+        unsigned int randomState = 8642;
+        size_t i;
+
+        for (i = 0; i < count; i += 1) {
+            pData[i] = test_generate_key((test_distribution)distribution, i, count, &randomState);
+            pPairs[i].key   = pData[i];
+            pPairs[i].index = (unsigned int)i;
+        }
+
+        memcpy(pExpected, pData, count * sizeof(*pData));
+        ns_radix_sort_u32(pExpected, count, sizeof(*pExpected), 0, NULL);
+
+        test_sort_uint(pData, count);
+        test_sort_pair(pPairs, count);
+
+        for (i = 0; i < count; i += 1) {
+            if (pData[i] != pExpected[i] || pPairs[i].key != pExpected[i]) {
+                printf("  FAILED: %s: incorrect result at index %lu\n", test_distribution_name((test_distribution)distribution), (unsigned long)i);
+                free(pData);
+                free(pExpected);
+                free(pPairs);
+                return 0;
+            }
+        }
+    }
+
+    /* Small counts go straight to the insertion sort. */
+    {
+        unsigned int small[5] = {3, 1, 2, 1, 0};
+
+        test_sort_uint(small, 0);
+        test_sort_uint(small, 5);
+
+        if (small[0] != 0 || small[1] != 1 || small[2] != 1 || small[3] != 2 || small[4] != 3) {
+            printf("  FAILED: small array not sorted\n");
+            free(pData);
+            free(pExpected);
+            free(pPairs);
+            return 0;
+        }
+    }
+
+    free(pData);
+    free(pExpected);
+    free(pPairs);
+
+    printf("  PASSED\n");
+    return 1;
+}
+
+static int test_sort_parallel(void)
+{
+    size_t count = 300000;
+    unsigned int* pData;
+    unsigned int* pExpected;
+    test_allocator_state allocatorState;
+    ns_allocation_callbacks allocationCallbacks;
+    size_t threadCounts[] = {0, 1, 2, 3, 4, 7, 16};
+    size_t iThreadCount;
+
+    printf("Testing ns_sort_parallel()...\n");
+
+    pData     = (unsigned int*)malloc(count * sizeof(*pData));
+    pExpected = (unsigned int*)malloc(count * sizeof(*pExpected));
+    if (pData == NULL || pExpected == NULL) {
+        printf("  FAILED: out of memory\n");
+        free(pData);
+        free(pExpected);
+        return 0;
+    }
+
+    allocationCallbacks = test_allocation_callbacks_init(&allocatorState);
+
+    for (iThreadCount = 0; iThreadCount < sizeof(threadCounts)/sizeof(threadCounts[0]); iThreadCount += 1) {
+        int distribution;
+
+        for (distribution = 0; distribution < test_distribution_count; distribution += 1) {
+            unsigned int randomState = 97531;
+            size_t i;
+
+            for (i = 0; i < count; i += 1) {
+                pData[i] = test_generate_key((test_distribution)distribution, i, count, &randomState);
+            }
+
+            memcpy(pExpected, pData, count * sizeof(*pData));
+            ns_radix_sort_u32(pExpected, count, sizeof(*pExpected), 0, NULL);
+
+            /* Every other run has a failing allocator which should fall back to the serial sort. */
+            allocatorState.failAllocations = (distribution & 1);
+            ns_sort_parallel(pData, count, sizeof(*pData), compare_uint_no_count, NULL, threadCounts[iThreadCount], &allocationCallbacks);
+
+            if (memcmp(pData, pExpected, count * sizeof(*pData)) != 0) {
+                printf("  FAILED: %s with %lu threads: incorrect result\n", test_distribution_name((test_distribution)distribution), (unsigned long)threadCounts[iThreadCount]);
+                free(pData);
+                free(pExpected);
+                return 0;
+            }
+        }
+    }
+
+    free(pData);
+    free(pExpected);
+
+    if (allocatorState.mallocCount != allocatorState.freeCount) {
+        printf("  FAILED: mallocCount = %lu, freeCount = %lu\n", (unsigned long)allocatorState.mallocCount, (unsigned long)allocatorState.freeCount);
+        return 0;
+    }
+
+    printf("  PASSED\n");
+    return 1;
+}
+
+static int test_argsort(void)
+{
+    size_t count = 50000;
+    test_pair* pPairs;
+    size_t* pIndices;
+    ns_uint32* pIndices32;
+    unsigned int randomState = 31415;
+    size_t i;
+
+    printf("Testing ns_argsort() and ns_argsort_u32()...\n");
+
+    pPairs     = (test_pair*)malloc(count * sizeof(*pPairs));
+    pIndices   = (size_t*)malloc(count * sizeof(*pIndices));
+    pIndices32 = (ns_uint32*)malloc(count * sizeof(*pIndices32));
+    if (pPairs == NULL || pIndices == NULL || pIndices32 == NULL) {
+        printf("  FAILED: out of memory\n");
+        free(pPairs);
+        free(pIndices);
+        free(pIndices32);
+        return 0;
+    }
+
+    for (i = 0; i < count; i += 1) {
+        pPairs[i].key   = test_random(&randomState) % 500;
+        pPairs[i].index = (unsigned int)i;
+    }
+
+    ns_argsort(pPairs, count, sizeof(*pPairs), compare_pair, NULL, pIndices);
+    ns_argsort_u32(pPairs, count, sizeof(*pPairs), compare_pair, NULL, pIndices32);
+
+    for (i = 0; i < count; i += 1) {
+        if (pPairs[i].index != i) {
+            printf("  FAILED: records were moved\n");
+            break;
+        }
+
+        if (pIndices[i] != pIndices32[i]) {
+            printf("  FAILED: 32- and 64-bit indices differ at %lu\n", (unsigned long)i);
+            break;
+        }
+
+        if (i > 0) {
+            const test_pair* pPrev = &pPairs[pIndices[i - 1]];
+            const test_pair* pCur  = &pPairs[pIndices[i]];
+
+            if (pPrev->key > pCur->key || (pPrev->key == pCur->key && pPrev->index > pCur->index)) {
+                printf("  FAILED: not sorted or not stable at index %lu\n", (unsigned long)i);
+                break;
+            }
+        }
+    }
+
+    free(pPairs);
+    free(pIndices);
+    free(pIndices32);
+
+    if (i != count) {
+        return 0;
+    }
+
+    printf("  PASSED\n");
+    return 1;
+}
+
+static int test_sort_indirect(void)
+{
+    size_t count = 5000;
+    test_record* pRecords;
+    test_record* pExpected;
+    test_allocator_state allocatorState;
+    ns_allocation_callbacks allocationCallbacks;
+    unsigned int randomState = 27182;
+    int failAllocations;
+    size_t i;
+
+    printf("Testing ns_sort_indirect()...\n");
+
+    pRecords  = (test_record*)malloc(count * sizeof(*pRecords));
+    pExpected = (test_record*)malloc(count * sizeof(*pExpected));
+    if (pRecords == NULL || pExpected == NULL) {
+        printf("  FAILED: out of memory\n");
+        free(pRecords);
+        free(pExpected);
+        return 0;
+    }
+
+    allocationCallbacks = test_allocation_callbacks_init(&allocatorState);
+
+    for (failAllocations = 0; failAllocations < 2; failAllocations += 1) {
+        for (i = 0; i < count; i += 1) {
+            pRecords[i].key   = test_random(&randomState) % 100;
+            pRecords[i].index = (unsigned int)i;
+            memset(pRecords[i].padding, (int)(i & 0xFF), sizeof(pRecords[i].padding));
+        }
+
+        /* Both are stable so they must produce identical results. */
+        memcpy(pExpected, pRecords, count * sizeof(*pRecords));
+        ns_sort_stable(pExpected, count, sizeof(*pExpected), compare_record, NULL, NULL);
+
+        allocatorState.failAllocations = failAllocations;
+        ns_sort_indirect(pRecords, count, sizeof(*pRecords), compare_record, NULL, &allocationCallbacks);
+
+        if (memcmp(pRecords, pExpected, count * sizeof(*pRecords)) != 0) {
+            printf("  FAILED: result differs from ns_sort_stable()%s\n", failAllocations ? " when allocations fail" : "");
+            free(pRecords);
+            free(pExpected);
+            return 0;
+        }
+    }
+
+    free(pRecords);
+    free(pExpected);
+
+    if (allocatorState.mallocCount != allocatorState.freeCount) {
+        printf("  FAILED: mallocCount = %lu, freeCount = %lu\n", (unsigned long)allocatorState.mallocCount, (unsigned long)allocatorState.freeCount);
+        return 0;
+    }
+
+    printf("  PASSED\n");
+    return 1;
+}
+
+static int test_select_nth(void)
+{
+    size_t counts[] = {1, 2, 23, 24, 200, 5000, 100000};
+    unsigned int* pData;
+    unsigned int* pSorted;
+    unsigned int randomState = 1234;
+    size_t iCount;
+    int dist;
+
+    printf("Testing ns_select_nth()...\n");
+
+    pData   = (unsigned int*)malloc(100000 * sizeof(*pData));
+    pSorted = (unsigned int*)malloc(100000 * sizeof(*pSorted));
+    if (pData == NULL || pSorted == NULL) {
+        printf("  FAILED: out of memory\n");
+        free(pData);
+        free(pSorted);
+        return 0;
+    }
+
+    for (dist = 0; dist < test_distribution_count; dist += 1) {
+        for (iCount = 0; iCount < sizeof(counts)/sizeof(counts[0]); iCount += 1) {
+            size_t count = counts[iCount];
+            size_t nths[4];
+            size_t iNth;
+            unsigned int dataState;
+            size_t i;
+
+            nths[0] = 0;
+            nths[1] = count - 1;
+            nths[2] = count / 2;
+            nths[3] = test_random(&randomState) % count;
+
+            dataState = randomState;
+            for (i = 0; i < count; i += 1) {
+                pSorted[i] = test_generate_key((test_distribution)dist, i, count, &randomState);
+            }
+            ns_sort(pSorted, count, sizeof(*pSorted), compare_uint, NULL);
+
+            for (iNth = 0; iNth < 4; iNth += 1) {
+                size_t nth = nths[iNth];
+
+                randomState = dataState;
+                for (i = 0; i < count; i += 1) {
+                    pData[i] = test_generate_key((test_distribution)dist, i, count, &randomState);
+                }
+
+                ns_select_nth(pData, count, sizeof(*pData), nth, compare_uint, NULL);
+
+                if (pData[nth] != pSorted[nth]) {
+                    printf("  FAILED: %s, count = %lu, nth = %lu: got %u, expected %u\n", test_distribution_name((test_distribution)dist), (unsigned long)count, (unsigned long)nth, pData[nth], pSorted[nth]);
+                    free(pData);
+                    free(pSorted);
+                    return 0;
+                }
+
+                for (i = 0; i < count; i += 1) {
+                    if ((i < nth && pData[i] > pData[nth]) || (i > nth && pData[i] < pData[nth])) {
+                        printf("  FAILED: %s, count = %lu, nth = %lu: not partitioned at %lu\n", test_distribution_name((test_distribution)dist), (unsigned long)count, (unsigned long)nth, (unsigned long)i);
+                        free(pData);
+                        free(pSorted);
+                        return 0;
+                    }
+                }
+            }
+        }
+    }
+
+    free(pData);
+    free(pSorted);
+
+    printf("  PASSED\n");
+    return 1;
+}
+
+static int test_partial_sort(void)
+{
+    size_t count = 200000;
+    size_t ks[] = {1, 10, 100, 1000, 50000, 199999, 200000};
+    unsigned int* pData;
+    unsigned int* pSorted;
+    unsigned int randomState = 4321;
+    size_t iK;
+    size_t i;
+
+    printf("Testing ns_partial_sort()...\n");
+
+    pData   = (unsigned int*)malloc(count * sizeof(*pData));
+    pSorted = (unsigned int*)malloc(count * sizeof(*pSorted));
+    if (pData == NULL || pSorted == NULL) {
+        printf("  FAILED: out of memory\n");
+        free(pData);
+        free(pSorted);
+        return 0;
+    }
+
+    for (i = 0; i < count; i += 1) {
+        pSorted[i] = test_random(&randomState) % 100000;
+    }
+    ns_sort(pSorted, count, sizeof(*pSorted), compare_uint, NULL);
+
+    for (iK = 0; iK < sizeof(ks)/sizeof(ks[0]); iK += 1) {
+        size_t k = ks[iK];
+
+        /* Same seed as the reference so pData is a permutation of pSorted. */
+        randomState = 4321;
+        for (i = 0; i < count; i += 1) {
+            pData[i] = test_random(&randomState) % 100000;
+        }
+
+        ns_partial_sort(pData, count, sizeof(*pData), k, compare_uint, NULL);
+
+        for (i = 0; i < k; i += 1) {
+            if (pData[i] != pSorted[i]) {
+                printf("  FAILED: k = %lu, mismatch at index %lu\n", (unsigned long)k, (unsigned long)i);
+                free(pData);
+                free(pSorted);
+                return 0;
+            }
+        }
+    }
+
+    free(pData);
+    free(pSorted);
+
+    printf("  PASSED\n");
+    return 1;
+}
+
+static int test_topk(void)
+{
+    size_t count = 100000;
+    size_t k = 100;
+    size_t batchSize = 777;
+    test_pair* pPairs;
+    test_pair* pSorted;
+    test_pair results[100];
+    ns_topk topk;
+    test_allocator_state allocatorState;
+    ns_allocation_callbacks allocationCallbacks;
+    unsigned int randomState = 98765;
+    size_t resultCount;
+    size_t i;
+
+    printf("Testing ns_topk...\n");
+
+    pPairs  = (test_pair*)malloc(count * sizeof(*pPairs));
+    pSorted = (test_pair*)malloc(count * sizeof(*pSorted));
+    if (pPairs == NULL || pSorted == NULL) {
+        printf("  FAILED: out of memory\n");
+        free(pPairs);
+        free(pSorted);
+        return 0;
+    }
+
+    /* Keys are unique so the expected result is unambiguous. */
+    for (i = 0; i < count; i += 1) {
+        pPairs[i].key   = (unsigned int)i;
+        pPairs[i].index = (unsigned int)i;
+    }
+    for (i = count - 1; i > 0; i -= 1) {
+        size_t j = test_random(&randomState) % (i + 1);
+        test_pair temp = pPairs[i];
+        pPairs[i] = pPairs[j];
+        pPairs[j] = temp;
+    }
+
+    memcpy(pSorted, pPairs, count * sizeof(*pPairs));
+    ns_sort(pSorted, count, sizeof(*pSorted), compare_pair, NULL);
+
+    allocationCallbacks = test_allocation_callbacks_init(&allocatorState);
+
+    allocatorState.failAllocations = 1;
+    if (ns_topk_init(k, sizeof(test_pair), compare_pair, NULL, &allocationCallbacks, &topk) != NS_OUT_OF_MEMORY) {
+        printf("  FAILED: expected NS_OUT_OF_MEMORY\n");
+        free(pPairs);
+        free(pSorted);
+        return 0;
+    }
+
+    allocatorState.failAllocations = 0;
+    if (ns_topk_init(k, sizeof(test_pair), compare_pair, NULL, &allocationCallbacks, &topk) != NS_SUCCESS) {
+        printf("  FAILED: ns_topk_init()\n");
+        free(pPairs);
+        free(pSorted);
+        return 0;
+    }
+
+    /* Fewer records than k. */
+    ns_topk_push(&topk, pPairs, 10);
+    resultCount = ns_topk_get(&topk, results);
+    for (i = 1; i < resultCount; i += 1) {
+        if (results[i - 1].key > results[i].key) {
+            break;
+        }
+    }
+    if (resultCount != 10 || i != resultCount) {
+        printf("  FAILED: partial fill\n");
+        ns_topk_uninit(&topk);
+        free(pPairs);
+        free(pSorted);
+        return 0;
+    }
+
+    ns_topk_reset(&topk);
+
+    for (i = 0; i < count; i += batchSize) {
+        size_t thisBatch = (count - i < batchSize) ? count - i : batchSize;
+        ns_topk_push(&topk, pPairs + i, thisBatch);
+    }
+
+    resultCount = ns_topk_get(&topk, results);
+    ns_topk_uninit(&topk);
+
+    if (resultCount != k || memcmp(results, pSorted, k * sizeof(*results)) != 0) {
+        printf("  FAILED: wrong result\n");
+        free(pPairs);
+        free(pSorted);
+        return 0;
+    }
+
+    free(pPairs);
+    free(pSorted);
+
+    if (allocatorState.mallocCount != allocatorState.freeCount) {
+        printf("  FAILED: mallocCount = %lu, freeCount = %lu\n", (unsigned long)allocatorState.mallocCount, (unsigned long)allocatorState.freeCount);
+        return 0;
+    }
+
+    printf("  PASSED\n");
+    return 1;
+}
+
+static ns_result test_external_sort_run(size_t count, size_t memoryBudget, const char* pTempDirectory, size_t trailingBytes, const ns_allocation_callbacks* pAllocationCallbacks)
+{
+    ns_result result;
+    ns_external_sort_config config;
+    FILE* pInput;
+    FILE* pOutput;
+    unsigned int randomState = 55555;
+    size_t i;
+
+    pInput  = tmpfile();
+    pOutput = tmpfile();
+    if (pInput == NULL || pOutput == NULL) {
+        printf("  FAILED: could not create temp files\n");
+        if (pInput  != NULL) fclose(pInput);
+        if (pOutput != NULL) fclose(pOutput);
+        return NS_ERROR;
+    }
+
+    /* A shuffled sequence of unique keys so the output can be checked without a reference copy. */
+    {
+        test_pair* pPairs = (test_pair*)malloc(count * sizeof(*pPairs) + 1);
+        if (pPairs == NULL) {
+            fclose(pInput);
+            fclose(pOutput);
+            return NS_OUT_OF_MEMORY;
+        }
+
+        for (i = 0; i < count; i += 1) {
+            pPairs[i].key   = (unsigned int)i;
+            pPairs[i].index = (unsigned int)i;
+        }
+        for (i = count; i > 1; i -= 1) {
+            size_t j = test_random(&randomState) % i;
+            test_pair temp = pPairs[i - 1];
+            pPairs[i - 1] = pPairs[j];
+            pPairs[j] = temp;
+        }
+
+        fwrite(pPairs, sizeof(*pPairs), count, pInput);
+        fwrite(pPairs, 1, trailingBytes, pInput);
+        rewind(pInput);
+        free(pPairs);
+    }
+
+    config = ns_external_sort_config_init(sizeof(test_pair), compare_pair, NULL);
+    config.memoryBudget   = memoryBudget;
+    config.pTempDirectory = pTempDirectory;
+
+    result = ns_external_sort(&config, pInput, pOutput, pAllocationCallbacks);
+    if (result == NS_SUCCESS) {
+        test_pair pair;
+
+        rewind(pOutput);
+        for (i = 0; i < count; i += 1) {
+            if (fread(&pair, sizeof(pair), 1, pOutput) != 1 || pair.key != i) {
+                printf("  FAILED: wrong output at record %lu\n", (unsigned long)i);
+                result = NS_ERROR;
+                break;
+            }
+        }
+
+        if (result == NS_SUCCESS && fread(&pair, 1, 1, pOutput) != 0) {
+            printf("  FAILED: output is too long\n");
+            result = NS_ERROR;
+        }
+    }
+
+    fclose(pInput);
+    fclose(pOutput);
+
+    return result;
+}
+
+static int test_external_sort(void)
+{
+    test_allocator_state allocatorState;
+    ns_allocation_callbacks allocationCallbacks;
+    ns_result result;
+
+    printf("Testing ns_external_sort()...\n");
+
+    allocationCallbacks = test_allocation_callbacks_init(&allocatorState);
+
+    /* Fits in memory. No temp files. */
+    result = test_external_sort_run(10000, 1024*1024, NULL, 0, &allocationCallbacks);
+    if (result != NS_SUCCESS) {
+        printf("  FAILED: single run: %d\n", (int)result);
+        return 0;
+    }
+
+    /* Many more runs than can be merged at once which forces intermediate merge passes. */
+    result = test_external_sort_run(100000, 64*1024, NULL, 0, &allocationCallbacks);
+    if (result != NS_SUCCESS) {
+        printf("  FAILED: multiple passes: %d\n", (int)result);
+        return 0;
+    }
+
+    /* Run size is an exact divisor of the input size. */
+    result = test_external_sort_run(8192*4, 64*1024, NULL, 0, &allocationCallbacks);
+    if (result != NS_SUCCESS) {
+        printf("  FAILED: exact run size: %d\n", (int)result);
+        return 0;
+    }
+
+    /* Named temp files in the working directory. */
+    result = test_external_sort_run(50000, 128*1024, ".", 0, &allocationCallbacks);
+    if (result != NS_SUCCESS) {
+        printf("  FAILED: temp directory: %d\n", (int)result);
+        return 0;
+    }
+
+    result = test_external_sort_run(0, 64*1024, NULL, 0, &allocationCallbacks);
+    if (result != NS_SUCCESS) {
+        printf("  FAILED: empty input: %d\n", (int)result);
+        return 0;
+    }
+
+    result = test_external_sort_run(100000, 64*1024, NULL, 3, &allocationCallbacks);
+    if (result != NS_INVALID_DATA) {
+        printf("  FAILED: partial record: expected NS_INVALID_DATA, got %d\n", (int)result);
+        return 0;
+    }
+
+    allocatorState.failAllocations = 1;
+    result = test_external_sort_run(1000, 64*1024, NULL, 0, &allocationCallbacks);
+    allocatorState.failAllocations = 0;
+    if (result != NS_OUT_OF_MEMORY) {
+        printf("  FAILED: expected NS_OUT_OF_MEMORY, got %d\n", (int)result);
+        return 0;
+    }
+
+    if (allocatorState.mallocCount != allocatorState.freeCount) {
+        printf("  FAILED: mallocCount = %lu, freeCount = %lu\n", (unsigned long)allocatorState.mallocCount, (unsigned long)allocatorState.freeCount);
+        return 0;
+    }
+
+    printf("  PASSED\n");
+    return 1;
+}
+
+typedef struct
+{
+    const char* pName;
+    unsigned int index;
+    char padding[52];
+} test_named_record;
+
+/* Checks the strings are in strcmp() order and the LCP array is right. */
+static int test_check_sorted_strings(const char** ppStrings, size_t count, const size_t* pLCP, const char* pName)
+{
+    size_t i;
+
+    for (i = 1; i < count; i += 1) {
+        size_t lcp = 0;
+
+        if (strcmp(ppStrings[i - 1], ppStrings[i]) > 0) {
+            printf("  FAILED: %s: not sorted at index %lu\n", pName, (unsigned long)i);
+            return 0;
+        }
+
+        while (ppStrings[i][lcp] != '\0' && ppStrings[i - 1][lcp] == ppStrings[i][lcp]) {
+            lcp += 1;
+        }
+
+        if (pLCP != NULL && pLCP[i] != lcp) {
+            printf("  FAILED: %s: LCP at index %lu is %lu, expected %lu\n", pName, (unsigned long)i, (unsigned long)pLCP[i], (unsigned long)lcp);
+            return 0;
+        }
+    }
+
+    if (pLCP != NULL && count > 0 && pLCP[0] != 0) {
+        printf("  FAILED: %s: LCP at index 0 is not 0\n", pName);
+        return 0;
+    }
+
+    return 1;
+}
+
+static int test_sort_strings(void)
+{
+    const char* pPrefixes[] = {"", "a", "ab", "abc", "https://example.com/", "/home/user/projects/refcode/some/long/shared/path/"};
+    size_t count = 20000;
+    char* pStorage;
+    const char** ppStrings;
+    size_t* pLCP;
+    test_named_record* pRecords;
+    const char** ppRecordNames;
+    test_allocator_state allocatorState;
+    ns_allocation_callbacks allocationCallbacks;
+    unsigned int randomState = 13579;
+    int failAllocations;
+    int result = 1;
+    size_t i;
+
+    printf("Testing ns_sort_strings() and ns_sort_strings_by_key()...\n");
+
+    pStorage      = (char*)malloc(count * 96);
+    ppStrings     = (const char**)malloc(count * sizeof(*ppStrings));
+    pLCP          = (size_t*)malloc(count * sizeof(*pLCP));
+    pRecords      = (test_named_record*)malloc(count * sizeof(*pRecords));
+    ppRecordNames = (const char**)malloc(count * sizeof(*ppRecordNames));
+    if (pStorage == NULL || ppStrings == NULL || pLCP == NULL || pRecords == NULL || ppRecordNames == NULL) {
+        printf("  FAILED: out of memory\n");
+        free(pStorage);
+        free((void*)ppStrings);
+        free(pLCP);
+        free(pRecords);
+        free((void*)ppRecordNames);
+        return 0;
+    }
+
+    /* Lots of shared prefixes, duplicates, empty strings and strings that are prefixes of others. */
+    for (i = 0; i < count; i += 1) {
+        char* pString = pStorage + i*96;
+        size_t suffixLength = test_random(&randomState) % 12;
+        size_t j;
+
+        strcpy(pString, pPrefixes[test_random(&randomState) % (sizeof(pPrefixes)/sizeof(pPrefixes[0]))]);
+        for (j = strlen(pString); suffixLength > 0; suffixLength -= 1, j += 1) {
+            pString[j] = (char)('a' + test_random(&randomState) % 3);
+        }
+        pString[j] = '\0';
+
+        /* Some characters above 127 to make sure they're compared as unsigned. */
+        if ((i % 17) == 0 && j > 0) {
+            pString[j - 1] = (char)0xE9;
+        }
+    }
+
+    allocationCallbacks = test_allocation_callbacks_init(&allocatorState);
+
+    for (failAllocations = 0; failAllocations < 2 && result; failAllocations += 1) {
+        allocatorState.failAllocations = failAllocations;
+
+        for (i = 0; i < count; i += 1) {
+            ppStrings[i] = pStorage + i*96;
+        }
+
+        ns_sort_strings(ppStrings, count, pLCP, &allocationCallbacks);
+        result = test_check_sorted_strings(ppStrings, count, pLCP, failAllocations ? "ns_sort_strings() without memory" : "ns_sort_strings()");
+
+        /* Without an LCP array. */
+        if (result) {
+            for (i = 0; i < count; i += 1) {
+                ppStrings[i] = pStorage + ((i * 7919) % count)*96;
+            }
+
+            ns_sort_strings(ppStrings, count, NULL, &allocationCallbacks);
+            result = test_check_sorted_strings(ppStrings, count, NULL, "ns_sort_strings() without LCP");
+        }
+
+        if (result) {
+            for (i = 0; i < count; i += 1) {
+                pRecords[i].pName = pStorage + i*96;
+                pRecords[i].index = (unsigned int)i;
+                memset(pRecords[i].padding, (int)(i & 0xFF), sizeof(pRecords[i].padding));
+            }
+
+            ns_sort_strings_by_key(pRecords, count, sizeof(*pRecords), offsetof(test_named_record, pName), pLCP, &allocationCallbacks);
+
+            for (i = 0; i < count; i += 1) {
+                ppRecordNames[i] = pRecords[i].pName;
+
+                /* The rest of the record must have moved with the key. */
+                if (pRecords[i].pName != pStorage + pRecords[i].index*96 || pRecords[i].padding[51] != (char)(pRecords[i].index & 0xFF)) {
+                    printf("  FAILED: ns_sort_strings_by_key(): record %lu is corrupt\n", (unsigned long)i);
+                    result = 0;
+                    break;
+                }
+            }
+
+            if (result) {
+                result = test_check_sorted_strings(ppRecordNames, count, pLCP, failAllocations ? "ns_sort_strings_by_key() without memory" : "ns_sort_strings_by_key()");
+            }
+        }
+    }
+
+    /*
+    Zero padded numbers in organ pipe, sawtooth and alternating ends order. The first 8 characters are the same everywhere and a
+    median of three on the rest picks a pivot near the ends every time. These used to take quadratic time and overflow the stack.
+    */
+    if (result) {
+        int pattern;
+
+        for (pattern = 0; pattern < 3 && result; pattern += 1) {
+            const char* pNames[] = {"organ pipe", "sawtooth", "alternating ends"};
+            char name[64];
+
+            for (i = 0; i < count; i += 1) {
+                unsigned long value;
+
+                if (pattern == 0) {
+                    value = (unsigned long)((i < count/2) ? i : count - i);
+                } else if (pattern == 1) {
+                    value = (unsigned long)(i % 1000);
+                } else {
+                    value = (unsigned long)((i % 2) ? i : count - i);
+                }
+
+                sprintf(pStorage + i*96, "%012lu", value);
+                ppStrings[i] = pStorage + i*96;
+            }
+
+            ns_sort_strings(ppStrings, count, pLCP, NULL);
+
+            sprintf(name, "ns_sort_strings() with %s input", pNames[pattern]);
+            result = test_check_sorted_strings(ppStrings, count, pLCP, name);
+        }
+    }
+
+    free(pStorage);
+    free((void*)ppStrings);
+    free(pLCP);
+    free(pRecords);
+    free((void*)ppRecordNames);
+
+    if (!result) {
+        return 0;
+    }
+
+    if (allocatorState.mallocCount != allocatorState.freeCount) {
+        printf("  FAILED: mallocCount = %lu, freeCount = %lu\n", (unsigned long)allocatorState.mallocCount, (unsigned long)allocatorState.freeCount);
+        return 0;
+    }
+
+    printf("  PASSED\n");
+    return 1;
+}
+
+static int test_check_sort_small(const ns_int32* pI32, const ns_uint32* pU32, const ns_key_value_u32* pKV, const ns_uint32* pOriginal, const ns_uint32* pExpected, size_t count, const char* pName)
+{
+    unsigned char seen[1024];
+    size_t i;
+
+    memset(seen, 0, count);
+
+    for (i = 0; i < count; i += 1) {
+        if (pU32[i] != pExpected[i]) {
+            printf("  FAILED: %s: u32 incorrect result at index %lu of %lu\n", pName, (unsigned long)i, (unsigned long)count);
+            return 0;
+        }
+
+        if (i > 0 && pI32[i - 1] > pI32[i]) {
+            printf("  FAILED: %s: i32 not sorted at index %lu of %lu\n", pName, (unsigned long)i, (unsigned long)count);
+            return 0;
+        }
+
+        /* Every pair must be intact and appear exactly once. */
+        if (pKV[i].key != pExpected[i] || pKV[i].value >= count || seen[pKV[i].value] || pOriginal[pKV[i].value] != pKV[i].key) {
+            printf("  FAILED: %s: key/value incorrect result at index %lu of %lu\n", pName, (unsigned long)i, (unsigned long)count);
+            return 0;
+        }
+
+        seen[pKV[i].value] = 1;
+    }
+
+    return 1;
+}
+
+static int test_sort_small(void)
+{
+    ns_uint32 original[1024];
+    ns_uint32 expected[1024];
+    ns_uint32 u32[1024];
+    ns_int32 i32[1024];
+    ns_key_value_u32 kv[1024];
+    float f32[128];
+    unsigned int randomState = 97531;
+    size_t count;
+    size_t i;
+    int pass;
+
+    printf("Testing ns_sort_small_*()...\n");
+
+    /*
+    Every count up to a bit past the maximum, with keys drawn from a small range so there are plenty of ties, and from the extremes
+    of the range so real keys get mixed up with the padding.
+    */
+    for (pass = 0; pass < 3; pass += 1) {
+        for (count = 0; count <= 70; count += 1) {
+            const char* pName = (pass == 0) ? "random" : ((pass == 1) ? "few unique" : "extremes");
+
+            for (i = 0; i < count; i += 1) {
+                if (pass == 0) {
+                    original[i] = test_random(&randomState);
+                } else if (pass == 1) {
+                    original[i] = test_random(&randomState) % 4;
+                } else {
+                    static const ns_uint32 extremes[4] = {0x00000000, 0x7FFFFFFF, 0x80000000, 0xFFFFFFFF};
+                    original[i] = extremes[test_random(&randomState) % 4];
+                }
+
+                u32[i] = original[i];
+                i32[i] = (ns_int32)original[i];
+                kv[i].key   = original[i];
+                kv[i].value = (ns_uint32)i;
+            }
+
+            memcpy(expected, original, count * sizeof(*original));
+            ns_radix_sort_u32(expected, count, sizeof(*expected), 0, NULL);
+
+            ns_sort_small_i32(i32, count);
+            ns_sort_small_u32(u32, count);
+            ns_sort_small_kv_u32(kv, count);
+
+            if (!test_check_sort_small(i32, u32, kv, original, expected, count, pName)) {
+                return 0;
+            }
+        }
+    }
+
+    /* Larger counts go through the typed pdqsorts. */
+    for (count = 100; count <= 1000; count += 300) {
+        int distribution;
+
+        for (distribution = 0; distribution < test_distribution_count; distribution += 1) {
+            for (i = 0; i < count; i += 1) {
+                original[i] = test_generate_key((test_distribution)distribution, i, count, &randomState);
+                u32[i] = original[i];
+                i32[i] = (ns_int32)original[i];
+                kv[i].key   = original[i];
+                kv[i].value = (ns_uint32)i;
+            }
+
+            memcpy(expected, original, count * sizeof(*original));
+            ns_radix_sort_u32(expected, count, sizeof(*expected), 0, NULL);
+
+            ns_sort_i32(i32, count);
+            ns_sort_u32(u32, count);
+            ns_sort_kv_u32(kv, count);
+
+            if (!test_check_sort_small(i32, u32, kv, original, expected, count, test_distribution_name((test_distribution)distribution))) {
+                return 0;
+            }
+        }
+    }
+
+    /* Floats, including signed zeros, infinities and NaNs, through both the small and large paths. */
+    for (count = 0; count <= 128; count += 1) {
+        size_t nanCount = 0;
+        size_t nanStart;
+
+        for (i = 0; i < count; i += 1) {
+            switch (test_random(&randomState) % 8)
+            {
+                case 0:  f32[i] = test_float_from_bits(0x80000000); break;
+                case 1:  f32[i] = 0.0f; break;
+                case 2:  f32[i] = test_float_from_bits(0x7FC00000); nanCount += 1; break;
+                case 3:  f32[i] = test_float_from_bits((i & 1) ? 0x7F800000 : 0xFF800000); break;
+                default: f32[i] = ((float)(test_random(&randomState) % 2000) - 1000.0f) / 7.0f; break;
+            }
+        }
+
+        if (count <= 64) {
+            ns_sort_small_f32(f32, count);
+        } else {
+            ns_sort_f32(f32, count);
+        }
+
+        nanStart = count - nanCount;
+        for (i = 0; i < count; i += 1) {
+            if ((i >= nanStart) != (f32[i] != f32[i])) {
+                printf("  FAILED: f32: NaNs not at the end with count %lu\n", (unsigned long)count);
+                return 0;
+            }
+
+            if (i > 0 && i < nanStart) {
+                ns_uint32 prevBits;
+                ns_uint32 bits;
+
+                memcpy(&prevBits, &f32[i - 1], sizeof(prevBits));
+                memcpy(&bits,     &f32[i    ], sizeof(bits));
+
+                if (f32[i - 1] > f32[i] || (prevBits == 0x00000000 && bits == 0x80000000)) {
+                    printf("  FAILED: f32: not sorted at index %lu of %lu\n", (unsigned long)i, (unsigned long)count);
+                    return 0;
+                }
+            }
+        }
+    }
+
+    printf("  PASSED\n");
+    return 1;
+}
+
+static int test_merge_k(void)
+{
+    static const size_t runCounts[] = {0, 1, 2, 3, 5, 17, 100};
+    size_t maxCount = 20000;
+    test_pair* pInput;
+    test_pair* pExpected;
+    test_pair* pOutput;
+    const void* ppRuns[100];
+    size_t counts[100];
+    test_allocator_state allocatorState;
+    ns_allocation_callbacks allocationCallbacks;
+    unsigned int randomState = 24680;
+    size_t iRunCount;
+    int keyRange;
+
+    printf("Testing ns_merge_k()...\n");
+
+    pInput    = (test_pair*)malloc(maxCount * sizeof(*pInput));
+    pExpected = (test_pair*)malloc(maxCount * sizeof(*pExpected));
+    pOutput   = (test_pair*)malloc(maxCount * sizeof(*pOutput));
+    if (pInput == NULL || pExpected == NULL || pOutput == NULL) {
+        printf("  FAILED: out of memory\n");
+        free(pInput);
+        free(pExpected);
+        free(pOutput);
+        return 0;
+    }
+
+    allocationCallbacks = test_allocation_callbacks_init(&allocatorState);
+
+    /* Lots of duplicate keys to check stability and deduplication, and then mostly unique keys. */
+    for (keyRange = 0; keyRange < 2; keyRange += 1) {
+        for (iRunCount = 0; iRunCount < sizeof(runCounts)/sizeof(runCounts[0]); iRunCount += 1) {
+            size_t runCount = runCounts[iRunCount];
+            size_t totalCount = 0;
+            size_t uniqueCount;
+            size_t outCount;
+            size_t iRun;
+            size_t i;
+            int result = 1;
+
+            /* Every third run is empty. The index records where each pair came from, in run order. */
+            for (iRun = 0; iRun < runCount; iRun += 1) {
+                counts[iRun] = (iRun % 3 == 1) ? 0 : test_random(&randomState) % (maxCount / runCount);
+                ppRuns[iRun] = pInput + totalCount;
+
+                for (i = 0; i < counts[iRun]; i += 1) {
+                    pInput[totalCount + i].key   = (keyRange == 0) ? test_random(&randomState) % 50 : test_random(&randomState);
+                    pInput[totalCount + i].index = (unsigned int)(totalCount + i);
+                }
+
+                ns_sort_stable(pInput + totalCount, counts[iRun], sizeof(*pInput), compare_pair, NULL, NULL);
+                for (i = 0; i < counts[iRun]; i += 1) {
+                    pInput[totalCount + i].index = (unsigned int)(totalCount + i);
+                }
+
+                totalCount += counts[iRun];
+            }
+
+            /* A stable merge gives the same result as a stable sort of all the runs concatenated together. */
+            memcpy(pExpected, pInput, totalCount * sizeof(*pInput));
+            ns_sort_stable(pExpected, totalCount, sizeof(*pExpected), compare_pair, NULL, NULL);
+
+            if (ns_merge_k(ppRuns, counts, runCount, sizeof(test_pair), compare_pair, NULL, pOutput, &allocationCallbacks) != NS_SUCCESS) {
+                printf("  FAILED: ns_merge_k() with %lu runs\n", (unsigned long)runCount);
+                result = 0;
+            }
+
+            for (i = 0; i < totalCount && result; i += 1) {
+                if (pOutput[i].key != pExpected[i].key || pOutput[i].index != pExpected[i].index) {
+                    printf("  FAILED: %lu runs: incorrect result at index %lu\n", (unsigned long)runCount, (unsigned long)i);
+                    result = 0;
+                }
+            }
+
+            /* The unique variant keeps the first of each group of equal keys. */
+            uniqueCount = 0;
+            for (i = 0; i < totalCount; i += 1) {
+                if (uniqueCount == 0 || pExpected[uniqueCount - 1].key != pExpected[i].key) {
+                    pExpected[uniqueCount] = pExpected[i];
+                    uniqueCount += 1;
+                }
+            }
+
+            if (result && ns_merge_k_unique(ppRuns, counts, runCount, sizeof(test_pair), compare_pair, NULL, pOutput, &outCount, &allocationCallbacks) != NS_SUCCESS) {
+                printf("  FAILED: ns_merge_k_unique() with %lu runs\n", (unsigned long)runCount);
+                result = 0;
+            }
+
+            if (result && outCount != uniqueCount) {
+                printf("  FAILED: %lu runs: expected %lu unique records, got %lu\n", (unsigned long)runCount, (unsigned long)uniqueCount, (unsigned long)outCount);
+                result = 0;
+            }
+
+            for (i = 0; i < uniqueCount && result; i += 1) {
+                if (pOutput[i].key != pExpected[i].key || pOutput[i].index != pExpected[i].index) {
+                    printf("  FAILED: %lu runs: incorrect unique result at index %lu\n", (unsigned long)runCount, (unsigned long)i);
+                    result = 0;
+                }
+            }
+
+            if (!result) {
+                free(pInput);
+                free(pExpected);
+                free(pOutput);
+                return 0;
+            }
+        }
+    }
+
+    /* 100 runs needs an allocation. */
+    allocatorState.failAllocations = 1;
+    if (ns_merge_k(ppRuns, counts, 100, sizeof(test_pair), compare_pair, NULL, pOutput, &allocationCallbacks) != NS_OUT_OF_MEMORY) {
+        printf("  FAILED: expected NS_OUT_OF_MEMORY\n");
+        free(pInput);
+        free(pExpected);
+        free(pOutput);
+        return 0;
+    }
+    allocatorState.failAllocations = 0;
+
+    free(pInput);
+    free(pExpected);
+    free(pOutput);
+
+    if (allocatorState.mallocCount != allocatorState.freeCount) {
+        printf("  FAILED: %lu allocations but %lu frees\n", (unsigned long)allocatorState.mallocCount, (unsigned long)allocatorState.freeCount);
+        return 0;
+    }
+
+    printf("  PASSED\n");
+    return 1;
+}
+
+typedef struct
+{
+    unsigned int index;
+    unsigned int check[3];
+} test_soa_wide;
+
+/* The index column says where each element came from. Every other column must agree with it. */
+static int test_check_soa(const unsigned int* pIndices, const test_soa_wide* pWide, const unsigned char* pBytes, const ns_int64* pOriginal, const ns_int64* pKeys, size_t count, const char* pName)
+{
+    size_t i;
+
+    for (i = 0; i < count; i += 1) {
+        unsigned int index = pIndices[i];
+
+        if (pKeys[i] != pOriginal[index] || pWide[i].index != index || pWide[i].check[2] != ~index || pBytes[i] != (unsigned char)index) {
+            printf("  FAILED: %s: columns out of sync at index %lu\n", pName, (unsigned long)i);
+            return 0;
+        }
+
+        if (i > 0 && (pKeys[i - 1] > pKeys[i] || (pKeys[i - 1] == pKeys[i] && pIndices[i - 1] > index))) {
+            printf("  FAILED: %s: not sorted or not stable at index %lu\n", pName, (unsigned long)i);
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static int test_sort_soa(void)
+{
+    size_t count = 50000;
+    ns_int64* pOriginal;
+    ns_int64* pKeys;
+    ns_uint32* pKeys32;
+    unsigned int* pIndices;
+    test_soa_wide* pWide;
+    unsigned char* pBytes;
+    void* ppColumns[3];
+    size_t columnStrides[3];
+    test_allocator_state allocatorState;
+    ns_allocation_callbacks allocationCallbacks;
+    int variant;
+    size_t i;
+    int result = 1;
+
+    printf("Testing ns_sort_soa()...\n");
+
+    pOriginal = (ns_int64*)malloc(count * sizeof(*pOriginal));
+    pKeys     = (ns_int64*)malloc(count * sizeof(*pKeys));
+    pKeys32   = (ns_uint32*)malloc(count * sizeof(*pKeys32));
+    pIndices  = (unsigned int*)malloc(count * sizeof(*pIndices));
+    pWide     = (test_soa_wide*)malloc(count * sizeof(*pWide));
+    pBytes    = (unsigned char*)malloc(count * sizeof(*pBytes));
+    if (pOriginal == NULL || pKeys == NULL || pKeys32 == NULL || pIndices == NULL || pWide == NULL || pBytes == NULL) {
+        printf("  FAILED: out of memory\n");
+        free(pOriginal);
+        free(pKeys);
+        free(pKeys32);
+        free(pIndices);
+        free(pWide);
+        free(pBytes);
+        return 0;
+    }
+
+    ppColumns[0] = pIndices;    columnStrides[0] = sizeof(*pIndices);
+    ppColumns[1] = pWide;       columnStrides[1] = sizeof(*pWide);
+    ppColumns[2] = pBytes;      columnStrides[2] = sizeof(*pBytes);
+
+    allocationCallbacks = test_allocation_callbacks_init(&allocatorState);
+
+    /* Variant 0 is the comparator path, 1 and 2 are the signed 64-bit and unsigned 32-bit radix paths, and 3 is out of memory. */
+    for (variant = 0; variant < 4 && result; variant += 1) {
+        unsigned int randomState = 31337;
+        ns_result soaResult;
+
+        for (i = 0; i < count; i += 1) {
+            /* Plenty of ties, and negative keys for the signed path. */
+            pOriginal[i] = (variant == 2) ? (ns_int64)(test_random(&randomState) % 1000) : (ns_int64)(test_random(&randomState) % 1000) - 500;
+            pKeys[i]     = pOriginal[i];
+            pKeys32[i]   = (ns_uint32)pOriginal[i];
+
+            pIndices[i]       = (unsigned int)i;
+            pWide[i].index    = (unsigned int)i;
+            pWide[i].check[0] = 0;
+            pWide[i].check[1] = 0;
+            pWide[i].check[2] = ~(unsigned int)i;
+            pBytes[i]         = (unsigned char)i;
+        }
+
+        allocatorState.failAllocations = (variant == 3);
+
+        if (variant == 0 || variant == 3) {
+            soaResult = ns_sort_soa(pKeys, count, sizeof(*pKeys), compare_i64, NULL, ppColumns, columnStrides, 3, &allocationCallbacks);
+        } else if (variant == 1) {
+            soaResult = ns_sort_soa_i64(pKeys, count, sizeof(*pKeys), ppColumns, columnStrides, 3, &allocationCallbacks);
+        } else {
+            soaResult = ns_sort_soa_u32(pKeys32, count, sizeof(*pKeys32), ppColumns, columnStrides, 3, &allocationCallbacks);
+            for (i = 0; i < count; i += 1) {
+                pKeys[i] = (ns_int64)pKeys32[i];
+            }
+        }
+
+        if (variant == 3) {
+            /* Nothing should have moved. */
+            if (soaResult != NS_OUT_OF_MEMORY) {
+                printf("  FAILED: expected NS_OUT_OF_MEMORY\n");
+                result = 0;
+            }
+
+            for (i = 0; i < count && result; i += 1) {
+                if (pKeys[i] != pOriginal[i] || pIndices[i] != i) {
+                    printf("  FAILED: columns modified when allocation failed\n");
+                    result = 0;
+                }
+            }
+        } else if (soaResult != NS_SUCCESS) {
+            printf("  FAILED: variant %d returned %d\n", variant, soaResult);
+            result = 0;
+        } else {
+            result = test_check_soa(pIndices, pWide, pBytes, pOriginal, pKeys, count, (variant == 0) ? "comparator" : ((variant == 1) ? "i64" : "u32"));
+        }
+    }
+
+    if (result && allocatorState.mallocCount != allocatorState.freeCount) {
+        printf("  FAILED: %lu allocations but %lu frees\n", (unsigned long)allocatorState.mallocCount, (unsigned long)allocatorState.freeCount);
+        result = 0;
+    }
+
+    free(pOriginal);
+    free(pKeys);
+    free(pKeys32);
+    free(pIndices);
+    free(pWide);
+    free(pBytes);
+
+    if (result) {
+        printf("  PASSED\n");
+    }
+
+    return result;
+}
+
+static int test_sorted_array(void)
+{
+    static const size_t deltaCapacities[] = {1, 7, 0};
+    unsigned int model[10000];  /* The value for each key, or 0 if the key isn't present. Values start at 1. */
+    test_allocator_state allocatorState;
+    ns_allocation_callbacks allocationCallbacks;
+    size_t iCapacity;
+
+    printf("Testing ns_sorted_array...\n");
+
+    allocationCallbacks = test_allocation_callbacks_init(&allocatorState);
+
+    for (iCapacity = 0; iCapacity < sizeof(deltaCapacities)/sizeof(deltaCapacities[0]); iCapacity += 1) {
+        ns_sorted_array table;
+        unsigned int randomState = 4242;
+        unsigned int iOp;
+        size_t expectedCount;
+        size_t i;
+        int result = 1;
+
+        memset(model, 0, sizeof(model));
+
+        if (ns_sorted_array_init(sizeof(test_pair), compare_pair, NULL, deltaCapacities[iCapacity], &allocationCallbacks, &table) != NS_SUCCESS) {
+            printf("  FAILED: ns_sorted_array_init()\n");
+            return 0;
+        }
+
+        /* Random inserts, replacements and erases, mostly inserts so the table grows, checked against a plain array. */
+        for (iOp = 1; iOp <= 60000 && result; iOp += 1) {
+            test_pair pair;
+            const test_pair* pFound;
+
+            pair.key   = test_random(&randomState) % 10000;
+            pair.index = iOp;
+
+            if (test_random(&randomState) % 3 != 0) {
+                result = ns_sorted_array_insert(&table, &pair, 1) == NS_SUCCESS;
+                model[pair.key] = iOp;
+            } else {
+                result = ns_sorted_array_erase(&table, &pair, 1) == NS_SUCCESS;
+                model[pair.key] = 0;
+            }
+
+            if (!result) {
+                printf("  FAILED: insert or erase failed\n");
+                break;
+            }
+
+            pair.key = test_random(&randomState) % 10000;
+            pFound = (const test_pair*)ns_sorted_array_find(&table, &pair);
+            if ((pFound == NULL) != (model[pair.key] == 0) || (pFound != NULL && (pFound->key != pair.key || pFound->index != model[pair.key]))) {
+                printf("  FAILED: delta capacity %lu: wrong lookup result for key %u after %u ops\n", (unsigned long)deltaCapacities[iCapacity], pair.key, iOp);
+                result = 0;
+            }
+        }
+
+        /* The automatic delta capacity should have grown with the table. */
+        if (result && deltaCapacities[iCapacity] == 0 && table.deltaCapacity <= NS_SORTED_ARRAY_DEFAULT_DELTA_CAPACITY) {
+            printf("  FAILED: delta capacity didn't grow\n");
+            result = 0;
+        }
+
+        /* A failed merge must not lose anything. */
+        if (result) {
+            test_pair pair;
+
+            /* Keys outside the model's range so they can be erased again afterwards without affecting it. */
+            ns_sorted_array_flush(&table);
+            for (i = 0; i < table.deltaCapacity; i += 1) {
+                pair.key   = 10000 + (unsigned int)i;
+                pair.index = 1;
+                ns_sorted_array_insert(&table, &pair, 1);
+            }
+
+            allocatorState.failAllocations = 1;
+            table.capacity = table.count;   /* Force the merge to grow the array. */
+            pair.key = 50000;
+            if (ns_sorted_array_insert(&table, &pair, 1) != NS_OUT_OF_MEMORY) {
+                printf("  FAILED: expected NS_OUT_OF_MEMORY\n");
+                result = 0;
+            }
+            allocatorState.failAllocations = 0;
+
+            pair.key = 10000;
+            if (result && ns_sorted_array_find(&table, &pair) == NULL) {
+                printf("  FAILED: pending insert lost after a failed merge\n");
+                result = 0;
+            }
+
+            for (i = 0; i < table.deltaCapacity && result; i += 1) {
+                pair.key = 10000 + (unsigned int)i;
+                ns_sorted_array_erase(&table, &pair, 1);
+            }
+        }
+
+        if (result && ns_sorted_array_flush(&table) != NS_SUCCESS) {
+            printf("  FAILED: ns_sorted_array_flush()\n");
+            result = 0;
+        }
+
+        /* After a flush the main array holds exactly the model. */
+        expectedCount = 0;
+        for (i = 0; i < 10000; i += 1) {
+            if (model[i] != 0) {
+                expectedCount += 1;
+            }
+        }
+
+        if (result && table.count != expectedCount) {
+            printf("  FAILED: delta capacity %lu: expected %lu records, got %lu\n", (unsigned long)deltaCapacities[iCapacity], (unsigned long)expectedCount, (unsigned long)table.count);
+            result = 0;
+        }
+
+        for (i = 0; i < table.count && result; i += 1) {
+            const test_pair* pPair = (const test_pair*)table.pData + i;
+
+            if ((i > 0 && pPair[-1].key >= pPair->key) || pPair->key >= 10000 || model[pPair->key] != pPair->index) {
+                printf("  FAILED: delta capacity %lu: wrong contents at index %lu\n", (unsigned long)deltaCapacities[iCapacity], (unsigned long)i);
+                result = 0;
+            }
+        }
+
+        ns_sorted_array_uninit(&table);
+
+        if (!result) {
+            return 0;
+        }
+    }
+
+    if (allocatorState.mallocCount != allocatorState.freeCount) {
+        printf("  FAILED: %lu allocations but %lu frees\n", (unsigned long)allocatorState.mallocCount, (unsigned long)allocatorState.freeCount);
+        return 0;
+    }
+
+    printf("  PASSED\n");
+    return 1;
+}
+
+#if defined(NS_SORT_BENCHMARK)
+/*
+The sort_bench target is this file built with NS_SORT_BENCHMARK defined. It times each sort against each distribution, count
+and stride, and prints one line per run as CSV or JSON so the output can be diffed across commits:
+
+    sort_bench [--format csv|json] [--sort name] [--min-count n] [--max-count n] [--max-bytes n]
+
+Counts go from 16 up to 10^8, and strides are 4, 8, 16, 64 and 256 bytes with a 32-bit key at the start of each record. Any
+combination where the array would be bigger than --max-bytes (1GB by default) is skipped. Small counts are repeated until enough
+time has passed to measure, and every number is per sort. Comparator calls and the bytes moved by NS_COPY_MEMORY() and
+NS_MOVE_MEMORY() are counted, except for ns_sort_parallel() where the counters would be shared between threads. Every result is
+checked to be sorted and to have the same keys as the input. The counters are compiled into the copies, so compare timings from
+sort_bench against other sort_bench runs rather than against other builds.
+
+Run with --test to run the tests instead.
+*/
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+static size_t g_benchCompareCount = 0;
+
+static double bench_time_in_seconds(void)
+{
+#if defined(_WIN32)
+    LARGE_INTEGER counter;
+    LARGE_INTEGER frequency;
+
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return (double)tv.tv_sec + (double)tv.tv_usec / 1000000.0;
+#endif
+}
+
+static int bench_compare(void* pUserData, const void* a, const void* b)
+{
+    ns_uint32 x;
+    ns_uint32 y;
+
+    (void)pUserData;
+
+    if (g_benchCounting) {
+        g_benchCompareCount += 1;
+    }
+
+    memcpy(&x, a, sizeof(x));
+    memcpy(&y, b, sizeof(y));
+
+    return (x > y) - (x < y);
+}
+
+static void bench_sort(void* pBase, size_t count, size_t stride)
+{
+    ns_sort(pBase, count, stride, bench_compare, NULL);
+}
+
+static void bench_sort_stable(void* pBase, size_t count, size_t stride)
+{
+    ns_sort_stable(pBase, count, stride, bench_compare, NULL, NULL);
+}
+
+static void bench_sort_parallel(void* pBase, size_t count, size_t stride)
+{
+    ns_sort_parallel(pBase, count, stride, bench_compare, NULL, 0, NULL);
+}
+
+static void bench_sort_indirect(void* pBase, size_t count, size_t stride)
+{
+    ns_sort_indirect(pBase, count, stride, bench_compare, NULL, NULL);
+}
+
+static void bench_radix_sort_u32(void* pBase, size_t count, size_t stride)
+{
+    ns_radix_sort_u32(pBase, count, stride, 0, NULL);
+}
+
+typedef struct
+{
+    const char* pName;
+    void (* sortProc)(void* pBase, size_t count, size_t stride);
+    int countable;
+} bench_sort_variant;
+
+static const bench_sort_variant g_benchSorts[] =
+{
+    {"ns_sort",           bench_sort,           1},
+    {"ns_sort_stable",    bench_sort_stable,    1},
+    {"ns_sort_parallel",  bench_sort_parallel,  0},
+    {"ns_sort_indirect",  bench_sort_indirect,  1},
+    {"ns_radix_sort_u32", bench_radix_sort_u32, 1}
+};
+
+static int bench_parse_size(const char* pText, size_t* pValue)
+{
+    char* pEnd;
+    double value = strtod(pText, &pEnd);    /* So things like 1e8 work. */
+
+    if (pEnd == pText || *pEnd != '\0' || value < 0) {
+        return 0;
+    }
+
+    *pValue = (size_t)value;
+    return 1;
+}
+
+/* Checks that the keys are in order and that they add up to the same thing as they did before sorting. */
+static int bench_check_sorted(const char* pData, size_t count, size_t stride, ns_uint64 expectedSum)
+{
+    ns_uint64 sum = 0;
+    ns_uint32 prev = 0;
+    size_t i;
+
+    for (i = 0; i < count; i += 1) {
+        ns_uint32 key;
+        memcpy(&key, pData + i*stride, sizeof(key));
+
+        if (key < prev) {
+            return 0;
+        }
+
+        sum += key;
+        prev = key;
+    }
+
+    return sum == expectedSum;
+}
+
+static int bench_main(int argc, char** argv)
+{
+    static const size_t counts[]  = {16, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000};
+    static const size_t strides[] = {4, 8, 16, 64, 256};
+    const char* pFormat = "csv";
+    const char* pSortName = NULL;
+    size_t minCount = 0;
+    size_t maxCount = NS_SIZE_MAX;
+    size_t maxBytes = (size_t)1 << 30;
+    size_t iCount;
+    size_t iStride;
+    int distribution;
+    int isFirstRecord = 1;
+    int allSorted = 1;
+    int iArg;
+
+    for (iArg = 1; iArg < argc; iArg += 1) {
+        int valid = iArg + 1 < argc;
+
+        if (valid && strcmp(argv[iArg], "--format") == 0) {
+            pFormat = argv[++iArg];
+            valid = strcmp(pFormat, "csv") == 0 || strcmp(pFormat, "json") == 0;
+        } else if (valid && strcmp(argv[iArg], "--sort") == 0) {
+            pSortName = argv[++iArg];
+        } else if (valid && strcmp(argv[iArg], "--min-count") == 0) {
+            valid = bench_parse_size(argv[++iArg], &minCount);
+        } else if (valid && strcmp(argv[iArg], "--max-count") == 0) {
+            valid = bench_parse_size(argv[++iArg], &maxCount);
+        } else if (valid && strcmp(argv[iArg], "--max-bytes") == 0) {
+            valid = bench_parse_size(argv[++iArg], &maxBytes);
+        } else {
+            valid = 0;
+        }
+
+        if (!valid) {
+            fprintf(stderr, "Usage: %s [--test] [--format csv|json] [--sort name] [--min-count n] [--max-count n] [--max-bytes n]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (strcmp(pFormat, "csv") == 0) {
+        printf("sort,distribution,count,stride,ns_per_element,compares,bytes_moved,sorted\n");
+    } else {
+        printf("[\n");
+    }
+
+    for (iCount = 0; iCount < sizeof(counts)/sizeof(counts[0]); iCount += 1) {
+        size_t count = counts[iCount];
+
+        if (count < minCount || count > maxCount) {
+            continue;
+        }
+
+        for (iStride = 0; iStride < sizeof(strides)/sizeof(strides[0]); iStride += 1) {
+            size_t stride = strides[iStride];
+            char* pInput;
+            char* pData;
+
+            if (count > maxBytes / stride) {
+                continue;
+            }
+
+            pInput = (char*)malloc(count * stride);
+            pData  = (char*)malloc(count * stride);
+            if (pInput == NULL || pData == NULL) {
+                fprintf(stderr, "Out of memory at count=%lu stride=%lu. Skipping.\n", (unsigned long)count, (unsigned long)stride);
+                free(pInput);
+                free(pData);
+                continue;
+            }
+
+            for (distribution = 0; distribution < test_distribution_count; distribution += 1) {
+                unsigned int randomState = 12345;
+                ns_uint64 expectedSum = 0;
+                size_t iSort;
+                size_t i;
+
+                memset(pInput, 0, count * stride);
+                for (i = 0; i < count; i += 1) {
+                    ns_uint32 key = test_generate_key((test_distribution)distribution, i, count, &randomState);
+                    memcpy(pInput + i*stride, &key, sizeof(key));
+                    expectedSum += key;
+                }
+
+                for (iSort = 0; iSort < sizeof(g_benchSorts)/sizeof(g_benchSorts[0]); iSort += 1) {
+                    const bench_sort_variant* pSort = &g_benchSorts[iSort];
+                    double elapsed = 0;
+                    size_t reps = 0;
+                    size_t compares;
+                    size_t bytesMoved;
+                    int sorted;
+
+                    if (pSortName != NULL && strcmp(pSortName, pSort->pName) != 0) {
+                        continue;
+                    }
+
+                    /* One counted run which is also the one that gets checked. */
+                    memcpy(pData, pInput, count * stride);
+                    g_benchCompareCount = 0;
+                    g_benchBytesMoved   = 0;
+                    g_benchCounting     = pSort->countable;
+                    pSort->sortProc(pData, count, stride);
+                    g_benchCounting     = 0;
+                    compares   = g_benchCompareCount;
+                    bytesMoved = g_benchBytesMoved;
+                    sorted     = bench_check_sorted(pData, count, stride, expectedSum);
+
+                    /*
+                    Then uncounted runs, doubling the number of them until enough time has passed to measure. Each one needs a
+                    fresh copy of the input, so the time for the copies alone is measured separately and subtracted.
+                    */
+                    for (reps = 1; ; reps *= 2) {
+                        double startTime = bench_time_in_seconds();
+                        double copyTime;
+                        size_t iRep;
+
+                        for (iRep = 0; iRep < reps; iRep += 1) {
+                            memcpy(pData, pInput, count * stride);
+                            pSort->sortProc(pData, count, stride);
+                        }
+
+                        elapsed = bench_time_in_seconds() - startTime;
+                        if (elapsed < 0.05) {
+                            continue;
+                        }
+
+                        startTime = bench_time_in_seconds();
+                        for (iRep = 0; iRep < reps; iRep += 1) {
+                            memcpy(pData, pInput, count * stride);
+                        }
+                        copyTime = bench_time_in_seconds() - startTime;
+
+                        elapsed = (elapsed > copyTime) ? elapsed - copyTime : 0;
+                        break;
+                    }
+
+                    if (!sorted) {
+                        allSorted = 0;
+                    }
+
+                    if (strcmp(pFormat, "csv") == 0) {
+                        printf("%s,%s,%lu,%lu,%.3f,", pSort->pName, test_distribution_name((test_distribution)distribution), (unsigned long)count, (unsigned long)stride, elapsed * 1e9 / ((double)reps * (double)count));
+                        if (pSort->countable) {
+                            printf("%lu,%lu,", (unsigned long)compares, (unsigned long)bytesMoved);
+                        } else {
+                            printf(",,");
+                        }
+                        printf("%s\n", sorted ? "yes" : "no");
+                    } else {
+                        printf("%s  {\"sort\": \"%s\", \"distribution\": \"%s\", \"count\": %lu, \"stride\": %lu, \"ns_per_element\": %.3f, ", isFirstRecord ? "" : ",\n", pSort->pName, test_distribution_name((test_distribution)distribution), (unsigned long)count, (unsigned long)stride, elapsed * 1e9 / ((double)reps * (double)count));
+                        if (pSort->countable) {
+                            printf("\"compares\": %lu, \"bytes_moved\": %lu, ", (unsigned long)compares, (unsigned long)bytesMoved);
+                        } else {
+                            printf("\"compares\": null, \"bytes_moved\": null, ");
+                        }
+                        printf("\"sorted\": %s}", sorted ? "true" : "false");
+                    }
+
+                    isFirstRecord = 0;
+                    fflush(stdout);
+                }
+            }
+
+            free(pInput);
+            free(pData);
+        }
+    }
+
+    if (strcmp(pFormat, "json") == 0) {
+        printf("\n]\n");
+    }
+
+    if (!allSorted) {
+        fprintf(stderr, "FAILED: at least one sort produced unsorted output.\n");
+        return 1;
+    }
+
+    return 0;
+}
+#endif
+
+int main(int argc, char** argv)
+{
+    int passedTests = 0;
+    int totalTests = 0;
+
+    (void)argc;
+    (void)argv;
+
+#if defined(NS_SORT_BENCHMARK)
+    if (argc < 2 || strcmp(argv[1], "--test") != 0) {
+        return bench_main(argc, argv);
+    }
+#endif
+
+    printf("Running sort tests...\n\n");
+
+    totalTests++; if (test_sort_uint_distributions()) passedTests++;
+    totalTests++; if (test_sort_small_counts()) passedTests++;
+    totalTests++; if (test_sort_large_stride()) passedTests++;
+    totalTests++; if (test_sort_stable_distributions()) passedTests++;
+    totalTests++; if (test_sort_stable_nearly_sorted()) passedTests++;
+    totalTests++; if (test_sort_stable_no_memory()) passedTests++;
+    totalTests++; if (test_sort_stable_large_stride()) passedTests++;
+    totalTests++; if (test_radix_sort_integers()) passedTests++;
+    totalTests++; if (test_radix_sort_records()) passedTests++;
+    totalTests++; if (test_radix_sort_f32()) passedTests++;
+    totalTests++; if (test_radix_sort_f64()) passedTests++;
+    totalTests++; if (test_sort_define()) passedTests++;
+    totalTests++; if (test_sort_parallel()) passedTests++;
+    totalTests++; if (test_argsort()) passedTests++;
+    totalTests++; if (test_sort_indirect()) passedTests++;
+    totalTests++; if (test_select_nth()) passedTests++;
+    totalTests++; if (test_partial_sort()) passedTests++;
+    totalTests++; if (test_topk()) passedTests++;
+    totalTests++; if (test_external_sort()) passedTests++;
+    totalTests++; if (test_sort_strings()) passedTests++;
+    totalTests++; if (test_sort_small()) passedTests++;
+    totalTests++; if (test_merge_k()) passedTests++;
+    totalTests++; if (test_sort_soa()) passedTests++;
+    totalTests++; if (test_sorted_array()) passedTests++;
+
+    printf("\n========================================\n");
+    printf("Tests passed: %d/%d\n", passedTests, totalTests);
+    printf("========================================\n");
+
+    if (passedTests == totalTests) {
+        printf("All tests PASSED!\n");
+        return 0;
+    } else {
+        printf("Some tests FAILED!\n");
+        return 1;
+    }
 }
+/* END Tests */